@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""
+Turns the output of the 'capture dump' command (see src/capture/capture.h)
+in to a VCD file, which GTKWave, PulseView and friends can display.
+
+    $ stty -F /dev/ttyACM0 115200 raw
+    $ ./capturedecode.py capture.vcd /dev/ttyACM0
+    (then type 'capture dump' in the other terminal)
+
+or, having saved the dump from a terminal:
+
+    $ ./capturedecode.py capture.vcd < dump.txt
+
+Each pin in the capture becomes a one-bit signal, named after the pin
+(e.g. F4).
+
+Copyright (c) 2014 theJPster (github@thejpster.org.uk)
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+"""
+
+import sys
+
+# VCD identifiers are printable characters from '!' onwards
+FIRST_ID = 33
+
+
+def read_varint(data, pos):
+    """Returns an unsigned LEB128 value and the position after it."""
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def read_dump(stream):
+    """Returns the tick rate, the channels and the record bytes."""
+    rate = None
+    channels = []
+    data = bytearray()
+    for line in stream:
+        line = line.strip()
+        if line.startswith("C "):
+            fields = line.split()
+            rate = int(fields[1])
+            channels = [(f[0], int(f[1:], 16)) for f in fields[2:]]
+            data = bytearray()
+        elif line.startswith("D ") and rate is not None:
+            data += bytes.fromhex(line[2:])
+        elif line.startswith("E ") and rate is not None:
+            if int(line[2:]) != len(data):
+                sys.stderr.write("Warning: expected %s bytes, got %d\n" % (line[2:], len(data)))
+            break
+    if rate is None:
+        raise ValueError("no capture header ('C ...') found")
+    return rate, channels, data
+
+
+def records(data, num_channels):
+    """Yields (time, levels) for each record."""
+    time = 0
+    pos = 0
+    while pos < len(data):
+        delta, pos = read_varint(data, pos)
+        time += delta
+        levels = data[pos:pos + num_channels]
+        pos += num_channels
+        if len(levels) < num_channels:
+            break
+        yield time, levels
+
+
+def write_vcd(out, rate, channels, data):
+    """Writes the records as a VCD file, one wire per captured pin."""
+    signals = []
+    for index, (port, mask) in enumerate(channels):
+        for pin in range(8):
+            if mask & (1 << pin):
+                signals.append((index, 1 << pin, "%s%d" % (port, pin),
+                                chr(FIRST_ID + len(signals))))
+    out.write("$timescale 1 ns $end\n")
+    out.write("$scope module capture $end\n")
+    for _, _, name, ident in signals:
+        out.write("$var wire 1 %s %s $end\n" % (ident, name))
+    out.write("$upscope $end\n$enddefinitions $end\n")
+    last = {}
+    for time, levels in records(data, len(channels)):
+        changes = []
+        for index, bit, _, ident in signals:
+            value = 1 if levels[index] & bit else 0
+            if last.get(ident) != value:
+                changes.append("%d%s" % (value, ident))
+                last[ident] = value
+        # The end record changes nothing, but still needs a timestamp
+        out.write("#%d\n" % (time * 10**9 // rate))
+        for change in changes:
+            out.write(change + "\n")
+
+
+def main(argv):
+    if len(argv) not in (2, 3):
+        sys.stderr.write("Usage: %s <out.vcd> [serial port or file]\n" % argv[0])
+        return 1
+    if len(argv) == 3:
+        with open(argv[2], "r", errors="replace") as stream:
+            rate, channels, data = read_dump(stream)
+    else:
+        rate, channels, data = read_dump(sys.stdin)
+    with open(argv[1], "w") as out:
+        write_vcd(out, rate, channels, data)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
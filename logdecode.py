@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""
+Decodes the binary records written by LOG() (see src/log/log.h), passing
+any ordinary console text straight through.
+
+    $ stty -F /dev/ttyACM0 115200 raw
+    $ ./logdecode.py bin/start.elf /dev/ttyACM0
+
+The format strings are read from the .logstr section of the ELF, using
+objcopy from the same toolchain the build uses. If the raw image
+(bin/start.bin) is alongside the ELF, %s arguments which point in to
+flash are printed too.
+
+Copyright (c) 2014 theJPster (github@thejpster.org.uk)
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+"""
+
+import os
+import re
+import struct
+import subprocess
+import sys
+import tempfile
+
+# Must match src/log/log.h
+LOG_SYNC = 0x1F
+LOG_ID_DROPPED = 0
+LOG_MAX_ARGS = 4
+
+OBJCOPY = "./gcc-arm/bin/arm-none-eabi-objcopy"
+
+# printf conversions, with C length modifiers (which Python doesn't want)
+CONVERSION = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|j|t)?([diuxXcsp%])")
+
+
+def read_section(elf, section):
+    """Returns the contents of a section of the ELF."""
+    objcopy = OBJCOPY if os.path.exists(OBJCOPY) else "arm-none-eabi-objcopy"
+    with tempfile.NamedTemporaryFile() as tmp:
+        subprocess.check_call(
+            [objcopy, "--dump-section", "%s=%s" % (section, tmp.name), elf, os.devnull])
+        return tmp.read()
+
+
+def c_string(blob, offset):
+    """Returns the NUL terminated string at offset, or None."""
+    if offset >= len(blob):
+        return None
+    end = blob.find(b"\0", offset)
+    if end < 0:
+        return None
+    return blob[offset:end].decode("ascii", "replace")
+
+
+def format_record(strings, flash, string_id, args):
+    """Applies a record's arguments to its format string."""
+    if string_id == LOG_ID_DROPPED:
+        return "[log] %u records dropped\n" % args[0]
+    fmt = c_string(strings, string_id)
+    if fmt is None:
+        return "[log] unknown id 0x%08x %r\n" % (string_id, args)
+    out = []
+    pos = 0
+    remaining = list(args)
+    for match in CONVERSION.finditer(fmt):
+        out.append(fmt[pos:match.start()])
+        pos = match.end()
+        flags, _, conv = match.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        value = remaining.pop(0) if remaining else 0
+        if conv in "di":
+            value = struct.unpack("<i", struct.pack("<I", value))[0]
+        elif conv == "u":
+            conv = "d"
+        elif conv == "p":
+            flags, conv = "#", "x"
+        elif conv == "s":
+            text = c_string(flash, value) if flash else None
+            value = text if text is not None else "<0x%08x>" % value
+        elif conv == "c":
+            value = chr(value & 0xFF)
+        out.append(("%" + flags + conv) % value)
+    out.append(fmt[pos:])
+    text = "".join(out)
+    # One record per line
+    return text if text.endswith("\n") else text + "\n"
+
+
+def decode(stream, strings, flash, out):
+    """Copies text from stream to out, replacing records with their text."""
+    while True:
+        byte = stream.read(1)
+        if not byte:
+            break
+        if byte[0] != LOG_SYNC:
+            out.write(byte.decode("ascii", "replace"))
+            out.flush()
+            continue
+        header = stream.read(5)
+        if len(header) < 5:
+            break
+        nargs = header[0]
+        if nargs > LOG_MAX_ARGS:
+            # Not really a record - lost sync
+            out.write("[log] bad record\n")
+            continue
+        string_id = struct.unpack("<I", header[1:5])[0]
+        body = stream.read(4 * nargs)
+        if len(body) < 4 * nargs:
+            break
+        args = struct.unpack("<%dI" % nargs, body)
+        out.write(format_record(strings, flash, string_id, args))
+        out.flush()
+
+
+def main(argv):
+    if len(argv) not in (2, 3):
+        sys.stderr.write("Usage: %s <start.elf> [serial port or file]\n" % argv[0])
+        return 1
+    elf = argv[1]
+    strings = read_section(elf, ".logstr")
+    flash = None
+    image = os.path.splitext(elf)[0] + ".bin"
+    if os.path.exists(image):
+        with open(image, "rb") as f:
+            flash = f.read()
+    if len(argv) == 3:
+        with open(argv[2], "rb", buffering=0) as stream:
+            decode(stream, strings, flash, sys.stdout)
+    else:
+        decode(sys.stdin.buffer, strings, flash, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""
+Terminal for firmware built with USE_UART_MUX (see src/mux/mux.h), which
+sends the console, LOG() records and telemetry as separate channels over
+the one UART.
+
+    $ stty -F /dev/ttyACM0 115200 raw
+    $ ./muxterm.py bin/start.elf /dev/ttyACM0 [telemetry.bin]
+
+Console text goes to stdout, log records are decoded as logdecode.py
+does and printed on stderr, and telemetry is appended to the given file
+(or dropped). Lines typed on stdin are sent to the console, unframed.
+
+Copyright (c) 2014 theJPster (github@thejpster.org.uk)
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+"""
+
+import os
+import struct
+import sys
+import threading
+
+import logdecode
+
+# Must match src/mux/mux.h
+MUX_CHANNEL_CONSOLE = 0
+MUX_CHANNEL_LOG = 1
+MUX_CHANNEL_TELEMETRY = 2
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, as frame_crc16()."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    """Returns the decoded frame, or None if it's malformed."""
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        code = data[pos]
+        if code == 0 or pos + code > len(data):
+            return None
+        out += data[pos + 1:pos + code]
+        pos += code
+        if code < 0xFF and pos < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def frames(stream):
+    """Yields (channel, payload) for each good frame in the stream."""
+    pending = bytearray()
+    while True:
+        byte = stream.read(1)
+        if not byte:
+            return
+        if byte[0] != 0:
+            pending += byte
+            continue
+        frame = cobs_decode(bytes(pending)) if pending else None
+        pending = bytearray()
+        if frame is None or len(frame) < 3:
+            continue
+        if crc16(frame[:-2]) != struct.unpack(">H", frame[-2:])[0]:
+            sys.stderr.write("[mux] bad crc\n")
+            continue
+        yield frame[0], frame[1:-2]
+
+
+class LogChannel(object):
+    """Turns the log channel's byte stream back into records."""
+
+    def __init__(self, strings, flash, out):
+        self.strings = strings
+        self.flash = flash
+        self.out = out
+        self.pending = b""
+
+    def feed(self, data):
+        self.pending += data
+        while self.pending:
+            if self.pending[0] != logdecode.LOG_SYNC:
+                # Lost sync - skip to the next record
+                self.pending = self.pending[1:]
+                continue
+            if len(self.pending) < 6:
+                return
+            nargs = self.pending[1]
+            if nargs > logdecode.LOG_MAX_ARGS:
+                self.pending = self.pending[1:]
+                continue
+            length = 6 + 4 * nargs
+            if len(self.pending) < length:
+                return
+            string_id = struct.unpack("<I", self.pending[2:6])[0]
+            args = struct.unpack("<%dI" % nargs, self.pending[6:length])
+            self.pending = self.pending[length:]
+            self.out.write(logdecode.format_record(self.strings, self.flash, string_id, args))
+            self.out.flush()
+
+
+def send_input(port):
+    """Copies lines from stdin to the board."""
+    with open(port, "wb", buffering=0) as f:
+        for line in sys.stdin.buffer:
+            f.write(line.replace(b"\n", b"\r"))
+
+
+def main(argv):
+    if len(argv) not in (3, 4):
+        sys.stderr.write("Usage: %s <start.elf> <serial port or file> [telemetry file]\n" % argv[0])
+        return 1
+    elf, port = argv[1], argv[2]
+    strings = logdecode.read_section(elf, ".logstr")
+    flash = None
+    image = os.path.splitext(elf)[0] + ".bin"
+    if os.path.exists(image):
+        with open(image, "rb") as f:
+            flash = f.read()
+    log = LogChannel(strings, flash, sys.stderr)
+    telemetry = open(argv[3], "ab") if len(argv) == 4 else None
+    if sys.stdin.isatty():
+        threading.Thread(target=send_input, args=(port,), daemon=True).start()
+    with open(port, "rb", buffering=0) as stream:
+        for channel, payload in frames(stream):
+            if channel == MUX_CHANNEL_CONSOLE:
+                sys.stdout.write(payload.decode("ascii", "replace"))
+                sys.stdout.flush()
+            elif channel == MUX_CHANNEL_LOG:
+                log.feed(payload)
+            elif channel == MUX_CHANNEL_TELEMETRY and telemetry:
+                telemetry.write(payload)
+                telemetry.flush()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""
+Calls commands on the board through the binary RPC mode of the command
+shell (see src/command/command.h), for test scripts.
+
+    $ stty -F /dev/ttyACM0 115200 raw
+    $ ./rpcclient.py /dev/ttyACM0 gpio F2 1
+    $ ./rpcclient.py /dev/ttyACM0 gpio A3 i
+
+Or from Python:
+
+    with RpcClient("/dev/ttyACM0") as rpc:
+        status, values = rpc.call("gpio", "A3", "i")
+
+String arguments are sent as strings and integers as 32-bit values.
+
+Copyright (c) 2014 theJPster (github@thejpster.org.uk)
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+"""
+
+import os
+import struct
+import sys
+import time
+
+# Must match src/command/command.h
+COMMAND_RPC_ARG_INT = 0x01
+COMMAND_RPC_ARG_STR = 0x02
+COMMAND_RPC_OP_LOOKUP = 0xFE
+COMMAND_RPC_OP_EXIT = 0xFF
+
+
+class RpcClient(object):
+
+    def __init__(self, port):
+        self.fd = os.open(port, os.O_RDWR | os.O_NOCTTY)
+        self.opcodes = {}
+        # Switch modes, then throw away the text and check we're in step
+        os.write(self.fd, b"\rrpc\r")
+        time.sleep(0.1)
+        os.read(self.fd, 4096)
+        self.request(b"")
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def close(self):
+        self.request(bytes([COMMAND_RPC_OP_EXIT]))
+        os.close(self.fd)
+
+    def _read(self, length):
+        data = b""
+        while len(data) < length:
+            data += os.read(self.fd, length - len(data))
+        return data
+
+    def request(self, body):
+        """Sends a raw request. Returns (status, values)."""
+        os.write(self.fd, bytes([len(body)]) + body)
+        length = self._read(1)[0]
+        reply = self._read(length)
+        status = struct.unpack("b", reply[:1])[0]
+        values = struct.unpack("<%dI" % ((length - 1) // 4), reply[1:])
+        return status, values
+
+    def opcode(self, name):
+        if name not in self.opcodes:
+            status, values = self.request(bytes([COMMAND_RPC_OP_LOOKUP]) + self.encode([name]))
+            if status != 0:
+                raise KeyError(name)
+            self.opcodes[name] = values[0]
+        return self.opcodes[name]
+
+    @staticmethod
+    def encode(args):
+        body = b""
+        for arg in args:
+            if isinstance(arg, int):
+                body += struct.pack("<BI", COMMAND_RPC_ARG_INT, arg & 0xFFFFFFFF)
+            else:
+                arg = arg.encode("ascii")
+                body += struct.pack("BB", COMMAND_RPC_ARG_STR, len(arg)) + arg
+        return body
+
+    def call(self, name, *args):
+        """Calls a command. Returns (status, values)."""
+        return self.request(bytes([self.opcode(name)]) + self.encode(args))
+
+
+def main(argv):
+    if len(argv) < 3:
+        sys.stderr.write("Usage: %s <serial port> <command> [args...]\n" % argv[0])
+        return 1
+    with RpcClient(argv[1]) as rpc:
+        status, values = rpc.call(argv[2], *argv[3:])
+    print("status %d" % status)
+    for value in values:
+        print("0x%08x (%u)" % (value, value))
+    return 0 if status == 0 else 2
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,117 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Micro-benchmarks.
+*
+* Each benchmark is a small kernel (a few calls to the code under test)
+* listed in BENCH_DEFINITIONS in bench.c. bench_run() times it a number
+* of times and reports the fastest, median and slowest run. The fastest
+* is usually the one to compare; the slowest shows what interrupts do.
+*
+* On the chip, times are in CPU cycles from the DWT cycle counter or, if
+* the core hasn't got one, from TIMER_0 (which main.c runs counting up
+* at the system clock). Built for the host, times are in nanoseconds.
+* The cost of taking the timestamps is measured and subtracted.
+*
+*****************************************************/
+
+#ifndef BENCH_BENCH_H
+#define BENCH_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+
+/**************************************************
+* Public Defines
+***************************************************/
+
+#define BENCH_ERROR_INVALID_ID (-1)
+#define BENCH_ERROR_INVALID_RUNS (-2)
+
+#define BENCH_MAX_RUNS 64
+
+/**************************************************
+* Public Data Types
+**************************************************/
+
+typedef struct bench_result_t
+{
+    uint32_t min;
+    uint32_t median;
+    uint32_t max;
+} bench_result_t;
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Public Function Prototypes
+***************************************************/
+
+/*
+ * @return the number of benchmarks. IDs go from 0 to this minus one.
+ */
+extern unsigned int bench_count(void);
+
+/*
+ * @return the benchmark's name, or NULL if the ID is bad
+ */
+extern const char *bench_name(unsigned int id);
+
+/*
+ * @return the ID of the named benchmark or, if -ve, an error
+ */
+extern int bench_find(const char *p_name);
+
+/*
+ * Times runs (1 to BENCH_MAX_RUNS) runs of a benchmark.
+ *
+ * @return 0 or an error
+ */
+extern int bench_run(unsigned int id, unsigned int runs, bench_result_t *p_result);
+
+/*
+ * @return the name of the units bench_run() reports in
+ */
+extern const char *bench_units(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ndef BENCH_BENCH_H */
+
+/**************************************************
+* End of file
+***************************************************/
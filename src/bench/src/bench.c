@@ -0,0 +1,548 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Micro-benchmarks. See bench.h.
+*
+* To add a benchmark, write a kernel (and optionally a setup function,
+* which runs before each timed run but isn't timed) and add it to
+* BENCH_DEFINITIONS. Build with BENCH_LCD to include the LCD and font
+* kernels.
+*
+* References:
+*
+*     [1] - ARMv7-M Architecture Reference Manual, C1.8 (DWT)
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+
+#ifdef __arm__
+#include "drivers/misc/misc.h"
+#include "drivers/timers/timers.h"
+#else
+#include <time.h>
+#endif
+
+#include "circbuffer/circbuffer.h"
+#include "mpscqueue/mpscqueue.h"
+#include "frame/frame.h"
+#include "command/command.h"
+#ifdef BENCH_LCD
+#include "drivers/lcd/lcd.h"
+#include "font/font.h"
+#endif
+
+#include "bench/bench.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+/* See [1] */
+#define DWT_CTRL_R      (*((volatile uint32_t *)0xE0001000))
+#define DWT_CYCCNT_R    (*((volatile uint32_t *)0xE0001004))
+#define DWT_CTRL_CYCCNTENA 0x00000001
+#define DWT_CTRL_NOCYCCNT  0x02000000
+#define NVIC_DBG_INT_TRCENA 0x01000000
+
+#define BLOCK_LEN 64
+
+/*
+ * The dispatch kernels look names up in made up command tables of
+ * various sizes. They're only built for the host, as the tables would
+ * take over 2 KB of RAM on the chip for the sake of a benchmark.
+ */
+#define DISPATCH_MAX_COMMANDS 128
+#define DISPATCH_NAME_LEN 8
+#define DISPATCH_LOOKUPS 16
+
+#ifndef __arm__
+#define DISPATCH_BENCH_DEFINITIONS \
+    X("dispatch_linear_8", setup_dispatch, bench_dispatch_linear_8) \
+    X("dispatch_linear_32", setup_dispatch, bench_dispatch_linear_32) \
+    X("dispatch_linear_128", setup_dispatch, bench_dispatch_linear_128) \
+    X("dispatch_binary_8", setup_dispatch, bench_dispatch_binary_8) \
+    X("dispatch_binary_32", setup_dispatch, bench_dispatch_binary_32) \
+    X("dispatch_binary_128", setup_dispatch, bench_dispatch_binary_128)
+#else
+#define DISPATCH_BENCH_DEFINITIONS
+#endif
+
+#ifdef BENCH_LCD
+#define LCD_BENCH_DEFINITIONS \
+    X("lcd_fill_64x64", NULL, bench_lcd_fill) \
+    X("font_text_small", NULL, bench_font_text)
+#else
+#define LCD_BENCH_DEFINITIONS
+#endif
+
+/*
+ * Name, setup function (or NULL), kernel.
+ */
+#define BENCH_DEFINITIONS \
+    X("circbuffer_write", setup_circbuffer, bench_circbuffer_write) \
+    X("circbuffer_write_block", setup_circbuffer, bench_circbuffer_write_block) \
+    X("circbuffer_read_block", setup_circbuffer_full, bench_circbuffer_read_block) \
+    X("mpscqueue_push_pop", setup_mpscqueue, bench_mpscqueue) \
+    X("frame_crc16", NULL, bench_crc16) \
+    X("frame_encode", NULL, bench_frame_encode) \
+    DISPATCH_BENCH_DEFINITIONS \
+    LCD_BENCH_DEFINITIONS
+
+/**************************************************
+* Data Types
+**************************************************/
+
+typedef void (*bench_fn_t)(void);
+
+struct bench_t
+{
+    const char *p_name;
+    bench_fn_t setup_fn;
+    bench_fn_t fn;
+};
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+static uint32_t now(void);
+static void setup(void);
+static void timer_setup(void);
+static uint32_t time_once(const struct bench_t *p_bench);
+static void sort(uint32_t *p_values, size_t len);
+
+static void bench_nothing(void);
+static void setup_circbuffer(void);
+static void setup_circbuffer_full(void);
+static void setup_mpscqueue(void);
+static void frame_sink(const uint8_t *p_data, size_t len, void *p_context);
+#ifndef __arm__
+static void setup_dispatch(void);
+static void dispatch_linear(unsigned int num_commands);
+static void dispatch_binary(const struct command_table_t *p_table);
+#endif
+
+#define X(name, setup, fun) \
+    static void fun(void);
+BENCH_DEFINITIONS
+#undef X
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Private Data
+**************************************************/
+
+#define X(name, setup, fun) \
+    { name, setup, fun },
+static const struct bench_t benches[] = {
+    BENCH_DEFINITIONS
+};
+#undef X
+
+static const struct bench_t nothing = { "nothing", NULL, bench_nothing };
+
+static bool ready;
+#ifdef __arm__
+static bool use_cycle_counter;
+#endif
+
+/* Cost of now() itself, found by timing an empty kernel */
+static uint32_t overhead;
+
+static uint32_t samples[BENCH_MAX_RUNS];
+
+/* Things for the kernels to chew on */
+static uint8_t block[BLOCK_LEN];
+static uint8_t cb_buffer[2 * BLOCK_LEN];
+static struct circbuffer_t cb;
+static struct mpscqueue_t queue;
+static uint32_t queue_seq[4];
+static uint32_t queue_elems[4];
+static struct frame_encoder_t encoder;
+
+#ifndef __arm__
+/* Commands in the order they're defined, like g_commands */
+static char dispatch_names[DISPATCH_MAX_COMMANDS][DISPATCH_NAME_LEN];
+static struct command_t dispatch_commands[DISPATCH_MAX_COMMANDS];
+/* The first 8, 32 and 128 of those, each with its own index */
+static uint8_t dispatch_sorted_8[8];
+static uint8_t dispatch_sorted_32[32];
+static uint8_t dispatch_sorted_128[128];
+static const struct command_table_t dispatch_table_8 = { dispatch_commands, dispatch_sorted_8, 8 };
+static const struct command_table_t dispatch_table_32 = { dispatch_commands, dispatch_sorted_32, 32 };
+static const struct command_table_t dispatch_table_128 = { dispatch_commands, dispatch_sorted_128, 128 };
+static bool dispatch_ready;
+/* Somewhere to put the answers, so the lookups aren't optimised away */
+static const struct command_t *volatile dispatch_result;
+#endif
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+unsigned int bench_count(void)
+{
+    return NUMELTS(benches);
+}
+
+const char *bench_name(unsigned int id)
+{
+    return (id < NUMELTS(benches)) ? benches[id].p_name : NULL;
+}
+
+int bench_find(const char *p_name)
+{
+    for (unsigned int i = 0; i < NUMELTS(benches); i++)
+    {
+        if (strcmp(p_name, benches[i].p_name) == 0)
+        {
+            return i;
+        }
+    }
+    return BENCH_ERROR_INVALID_ID;
+}
+
+int bench_run(unsigned int id, unsigned int runs, bench_result_t *p_result)
+{
+    if (id >= NUMELTS(benches))
+    {
+        return BENCH_ERROR_INVALID_ID;
+    }
+
+    if ((runs == 0) || (runs > BENCH_MAX_RUNS))
+    {
+        return BENCH_ERROR_INVALID_RUNS;
+    }
+
+    if (!ready)
+    {
+        setup();
+    }
+
+    for (unsigned int i = 0; i < runs; i++)
+    {
+        const uint32_t t = time_once(&benches[id]);
+        samples[i] = (t > overhead) ? (t - overhead) : 0;
+    }
+
+    sort(samples, runs);
+    p_result->min = samples[0];
+    p_result->median = samples[runs / 2];
+    p_result->max = samples[runs - 1];
+
+    return 0;
+}
+
+const char *bench_units(void)
+{
+#ifdef __arm__
+    return "cycles";
+#else
+    return "ns";
+#endif
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+#ifdef __arm__
+
+static uint32_t now(void)
+{
+    return use_cycle_counter ? DWT_CYCCNT_R : timer_get_value(TIMER_0, TIMER_A);
+}
+
+#else
+
+static uint32_t now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+#endif
+
+static void setup(void)
+{
+    /*
+     * Something like a telemetry record: mostly non-zero bytes with the
+     * odd zero. All zeros would make COBS emit a code byte per byte.
+     */
+    uint32_t x = 0x12345678;
+    for (unsigned int i = 0; i < BLOCK_LEN; i++)
+    {
+        x = (x * 1103515245UL) + 12345UL;
+        block[i] = ((i % 16) == 15) ? 0 : (uint8_t) (x >> 16);
+    }
+    timer_setup();
+    ready = true;
+}
+
+static void timer_setup(void)
+{
+#ifdef __arm__
+    /* The DWT is part of the trace unit, which is off until enabled */
+    NVIC_DBG_INT_R |= NVIC_DBG_INT_TRCENA;
+    use_cycle_counter = (DWT_CTRL_R & DWT_CTRL_NOCYCCNT) == 0;
+    if (use_cycle_counter)
+    {
+        DWT_CYCCNT_R = 0;
+        DWT_CTRL_R |= DWT_CTRL_CYCCNTENA;
+    }
+#endif
+
+    /* The fastest of a few runs of nothing is the timing overhead */
+    overhead = 0;
+    for (unsigned int i = 0; i < 8; i++)
+    {
+        const uint32_t t = time_once(&nothing);
+        if ((i == 0) || (t < overhead))
+        {
+            overhead = t;
+        }
+    }
+}
+
+static uint32_t time_once(const struct bench_t *p_bench)
+{
+    uint32_t start;
+    if (p_bench->setup_fn)
+    {
+        p_bench->setup_fn();
+    }
+    start = now();
+    p_bench->fn();
+    /* Unsigned subtraction copes with the counter wrapping */
+    return now() - start;
+}
+
+/*
+ * Insertion sort. There are never many samples.
+ */
+static void sort(uint32_t *p_values, size_t len)
+{
+    for (size_t i = 1; i < len; i++)
+    {
+        const uint32_t value = p_values[i];
+        size_t j = i;
+        while ((j > 0) && (p_values[j - 1] > value))
+        {
+            p_values[j] = p_values[j - 1];
+            j--;
+        }
+        p_values[j] = value;
+    }
+}
+
+/* Kernels */
+
+static void bench_nothing(void)
+{
+}
+
+static void setup_circbuffer(void)
+{
+    circbuffer_init_spsc(&cb, cb_buffer, sizeof(cb_buffer));
+}
+
+static void setup_circbuffer_full(void)
+{
+    setup_circbuffer();
+    circbuffer_write_block(&cb, block, BLOCK_LEN);
+}
+
+/* BLOCK_LEN bytes, one at a time */
+static void bench_circbuffer_write(void)
+{
+    for (unsigned int i = 0; i < BLOCK_LEN; i++)
+    {
+        circbuffer_write(&cb, block[i]);
+    }
+}
+
+/* BLOCK_LEN bytes in one go */
+static void bench_circbuffer_write_block(void)
+{
+    circbuffer_write_block(&cb, block, BLOCK_LEN);
+}
+
+static void bench_circbuffer_read_block(void)
+{
+    uint8_t out[BLOCK_LEN];
+    circbuffer_read_block(&cb, out, BLOCK_LEN);
+}
+
+static void setup_mpscqueue(void)
+{
+    mpscqueue_init(&queue, queue_elems, sizeof(queue_elems[0]), queue_seq, NUMELTS(queue_elems));
+}
+
+static void bench_mpscqueue(void)
+{
+    uint32_t value = 0;
+    mpscqueue_push(&queue, &value);
+    mpscqueue_pop(&queue, &value);
+}
+
+/* CRC of BLOCK_LEN bytes */
+static void bench_crc16(void)
+{
+    (void) frame_crc16(0xFFFF, block, BLOCK_LEN);
+}
+
+/* One BLOCK_LEN byte frame, to a sink which throws it away */
+static void bench_frame_encode(void)
+{
+    frame_encoder_init(&encoder, frame_sink, NULL);
+    frame_encoder_send(&encoder, 0, block, BLOCK_LEN);
+}
+
+static void frame_sink(const uint8_t *p_data, size_t len, void *p_context)
+{
+}
+
+#ifndef __arm__
+
+/*
+ * Names like "cmd042", defined out of order.
+ */
+static void setup_dispatch(void)
+{
+    if (dispatch_ready)
+    {
+        return;
+    }
+    for (unsigned int i = 0; i < DISPATCH_MAX_COMMANDS; i++)
+    {
+        const unsigned int number = (i * 37) % DISPATCH_MAX_COMMANDS;
+        char *const p_name = dispatch_names[i];
+        p_name[0] = 'c';
+        p_name[1] = 'm';
+        p_name[2] = 'd';
+        p_name[3] = (char) ('0' + (number / 100));
+        p_name[4] = (char) ('0' + ((number / 10) % 10));
+        p_name[5] = (char) ('0' + (number % 10));
+        p_name[6] = '\0';
+        dispatch_commands[i].p_command = p_name;
+    }
+    command_table_sort(&dispatch_table_8);
+    command_table_sort(&dispatch_table_32);
+    command_table_sort(&dispatch_table_128);
+    dispatch_ready = true;
+}
+
+/*
+ * How process_command() used to do it, for names spread through the
+ * first num_commands of the table.
+ */
+static void dispatch_linear(unsigned int num_commands)
+{
+    for (unsigned int i = 0; i < DISPATCH_LOOKUPS; i++)
+    {
+        const char *const p_name = dispatch_names[(i * num_commands) / DISPATCH_LOOKUPS];
+        dispatch_result = NULL;
+        for (unsigned int j = 0; j < num_commands; j++)
+        {
+            if (strcmp(p_name, dispatch_commands[j].p_command) == 0)
+            {
+                dispatch_result = &dispatch_commands[j];
+                break;
+            }
+        }
+    }
+}
+
+/*
+ * The same names, looked up the way command.c does it now.
+ */
+static void dispatch_binary(const struct command_table_t *p_table)
+{
+    for (unsigned int i = 0; i < DISPATCH_LOOKUPS; i++)
+    {
+        const char *const p_name = dispatch_names[(i * p_table->num_commands) / DISPATCH_LOOKUPS];
+        dispatch_result = command_table_find(p_table, p_name);
+    }
+}
+
+static void bench_dispatch_linear_8(void)
+{
+    dispatch_linear(8);
+}
+
+static void bench_dispatch_linear_32(void)
+{
+    dispatch_linear(32);
+}
+
+static void bench_dispatch_linear_128(void)
+{
+    dispatch_linear(128);
+}
+
+static void bench_dispatch_binary_8(void)
+{
+    dispatch_binary(&dispatch_table_8);
+}
+
+static void bench_dispatch_binary_32(void)
+{
+    dispatch_binary(&dispatch_table_32);
+}
+
+static void bench_dispatch_binary_128(void)
+{
+    dispatch_binary(&dispatch_table_128);
+}
+
+#endif /* ndef __arm__ */
+
+#ifdef BENCH_LCD
+
+static void bench_lcd_fill(void)
+{
+    lcd_paint_fill_rectangle(LCD_BLUE, 0, 63, 0, 63);
+}
+
+static void bench_font_text(void)
+{
+    font_draw_text_small(0, 0, "Hello, world!", LCD_WHITE, LCD_BLACK, false);
+}
+
+#endif /* def BENCH_LCD */
+
+/**************************************************
+* End of file
+***************************************************/
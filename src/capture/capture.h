@@ -0,0 +1,165 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Logic analyser style capture of GPIO inputs.
+*
+* Up to CAPTURE_MAX_CHANNELS channels (a port and a mask of its pins) are
+* captured, either by sampling them at a fixed rate from the TIMER_2
+* interrupt or by timestamping edges from the GPIO interrupts with
+* TIMER_0 (which main.c runs counting up at the system clock).
+*
+* Only changes are stored, so a quiet signal costs nothing however long
+* it's captured for. The buffer is a list of records, each of which is:
+*
+*     delta    - time since the previous record, as an unsigned LEB128
+*                varint (7 bits per byte, least significant first, top
+*                bit set on all but the last byte)
+*     levels   - one byte per channel, the masked pin levels
+*
+* Times are in samples (CAPTURE_MODE_SAMPLE) or clock ticks
+* (CAPTURE_MODE_EDGE); capture_status_t.tick_rate says how many make a
+* second. The first record (delta 0) holds the starting levels. When the
+* capture stops a final record is added with unchanged levels, marking
+* the end of the capture. Capture stops by itself when the buffer fills.
+*
+*****************************************************/
+
+#ifndef CAPTURE_CAPTURE_H
+#define CAPTURE_CAPTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+#include "drivers/gpio/gpio.h"
+
+/**************************************************
+* Public Defines
+***************************************************/
+
+#define CAPTURE_ERROR_BUSY (-1)
+#define CAPTURE_ERROR_INVALID_CHANNELS (-2)
+#define CAPTURE_ERROR_INVALID_RATE (-3)
+/* Not enough free GPIO interrupt handlers for the channels */
+#define CAPTURE_ERROR_NO_INTERRUPTS (-4)
+
+#define CAPTURE_MAX_CHANNELS 4
+
+#ifndef CAPTURE_BUFFER_LEN
+#define CAPTURE_BUFFER_LEN 8192
+#endif
+
+/* Faster than this and the interrupt starves the main loop */
+#define CAPTURE_MAX_RATE 250000
+
+/**************************************************
+* Public Data Types
+**************************************************/
+
+typedef enum capture_mode_t
+{
+    CAPTURE_MODE_SAMPLE,
+    CAPTURE_MODE_EDGE
+} capture_mode_t;
+
+typedef struct capture_channel_t
+{
+    gpio_port_t port;
+    uint8_t mask;
+} capture_channel_t;
+
+typedef struct capture_config_t
+{
+    capture_mode_t mode;
+    /* Samples per second. Only used in CAPTURE_MODE_SAMPLE. */
+    uint32_t rate;
+    unsigned int num_channels;
+    capture_channel_t channels[CAPTURE_MAX_CHANNELS];
+} capture_config_t;
+
+typedef struct capture_status_t
+{
+    bool running;
+    /* Stopped because the buffer filled up */
+    bool full;
+    /* Record times per second */
+    uint32_t tick_rate;
+    uint32_t records;
+    size_t bytes;
+} capture_status_t;
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Public Function Prototypes
+***************************************************/
+
+/*
+ * Makes the channels' pins inputs, empties the buffer and starts
+ * capturing.
+ *
+ * @return 0 or an error
+ */
+extern int capture_start(const capture_config_t *p_config);
+
+/*
+ * Stops capturing and adds the end record. Does nothing if capture isn't
+ * running.
+ */
+extern void capture_stop(void);
+
+extern void capture_get_status(capture_status_t *p_status);
+
+/*
+ * @return the configuration of the current (or last) capture
+ */
+extern const capture_config_t *capture_get_config(void);
+
+/*
+ * The records captured so far. More may be added while capture is
+ * running, but what's already there won't change.
+ *
+ * @return a pointer to the buffer, with its length in *p_len
+ */
+extern const uint8_t *capture_get_data(size_t *p_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ndef CAPTURE_CAPTURE_H */
+
+/**************************************************
+* End of file
+***************************************************/
+
@@ -0,0 +1,348 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Logic analyser style capture of GPIO inputs. See capture.h.
+*
+* The interrupts append records to the buffer and only then move
+* g_used on, so the main loop can read everything below g_used while a
+* capture is still running.
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+#include "drivers/gpio/gpio.h"
+#include "drivers/timers/timers.h"
+
+#include "capture/capture.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+#define CAPTURE_TIMER TIMER_2
+
+/* TIMER_0 is free-running - see main.c */
+#define TIMESTAMP_TIMER TIMER_0
+
+/* A 32-bit delta takes up to 5 bytes */
+#define MAX_RECORD_LEN (5 + CAPTURE_MAX_CHANNELS)
+
+/**************************************************
+* Data Types
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+static uint32_t read_levels(void);
+static void add_record(uint32_t delta, uint32_t levels);
+static void stop_interrupts(unsigned int num_channels);
+static void sample_handler(timer_module_t timer, timer_ab_t ab, void *p_context, uint32_t n_context);
+static void edge_handler(gpio_io_pin_t pin, void *p_context, uint32_t n_context);
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Private Data
+**************************************************/
+
+static const timer_config_t timer_config = {
+    .type = TIMER_JOINED,
+    .timer_a = {
+        .type = TIMER_SPLIT_PERIODIC,
+        .count_up = false,
+    }
+};
+
+static capture_config_t g_config;
+static uint32_t g_tick_rate;
+
+static uint8_t g_buffer[CAPTURE_BUFFER_LEN];
+
+/* Shared with the interrupts */
+static volatile size_t g_used;
+static volatile uint32_t g_records;
+static volatile bool g_running;
+static volatile bool g_full;
+static uint32_t g_levels;
+/* Samples since the last record, or the time of the last record */
+static uint32_t g_elapsed;
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+int capture_start(const capture_config_t *p_config)
+{
+    if (g_running)
+    {
+        return CAPTURE_ERROR_BUSY;
+    }
+    if ((p_config->num_channels == 0) || (p_config->num_channels > CAPTURE_MAX_CHANNELS))
+    {
+        return CAPTURE_ERROR_INVALID_CHANNELS;
+    }
+    for (unsigned int i = 0; i < p_config->num_channels; i++)
+    {
+        if (((unsigned int) p_config->channels[i].port >= GPIO_NUM_PORTS) ||
+            (p_config->channels[i].mask == 0))
+        {
+            return CAPTURE_ERROR_INVALID_CHANNELS;
+        }
+    }
+    if ((p_config->mode == CAPTURE_MODE_SAMPLE) &&
+        ((p_config->rate == 0) || (p_config->rate > CAPTURE_MAX_RATE)))
+    {
+        return CAPTURE_ERROR_INVALID_RATE;
+    }
+
+    g_config = *p_config;
+    for (unsigned int i = 0; i < g_config.num_channels; i++)
+    {
+        const capture_channel_t *p_channel = &g_config.channels[i];
+        for (unsigned int pin = 0; pin < 8; pin++)
+        {
+            if (p_channel->mask & (1U << pin))
+            {
+                gpio_make_input(GPIO_MAKE_IO_PIN(p_channel->port, pin));
+            }
+        }
+    }
+
+    g_used = 0;
+    g_records = 0;
+    g_full = false;
+    g_levels = read_levels();
+    add_record(0, g_levels);
+    g_running = true;
+
+    if (g_config.mode == CAPTURE_MODE_SAMPLE)
+    {
+        uint32_t period = CLOCK_RATE / g_config.rate;
+        g_tick_rate = CLOCK_RATE / period;
+        g_elapsed = 0;
+        timer_configure(CAPTURE_TIMER, &timer_config);
+        timer_register_handler(CAPTURE_TIMER, TIMER_A, sample_handler, NULL, 0);
+        timer_set_interval_load(CAPTURE_TIMER, TIMER_A, period - 1);
+        timer_interrupt_clear(CAPTURE_TIMER, TIMER_A_INTERRUPT_TIMEOUT);
+        timer_interrupt_enable(CAPTURE_TIMER, TIMER_A_INTERRUPT_TIMEOUT);
+        timer_enable(CAPTURE_TIMER, TIMER_A);
+    }
+    else
+    {
+        g_tick_rate = CLOCK_RATE;
+        g_elapsed = timer_get_value(TIMESTAMP_TIMER, TIMER_A);
+        for (unsigned int i = 0; i < g_config.num_channels; i++)
+        {
+            const capture_channel_t *p_channel = &g_config.channels[i];
+            if (gpio_register_handler(
+                    GPIO_MAKE_IO_PINS(p_channel->port, p_channel->mask),
+                    GPIO_INTERRUPT_MODE_BOTH,
+                    edge_handler, NULL, 0) != 0)
+            {
+                /* Someone else has the handlers, so don't start at all */
+                g_running = false;
+                stop_interrupts(i);
+                g_used = 0;
+                g_records = 0;
+                return CAPTURE_ERROR_NO_INTERRUPTS;
+            }
+        }
+    }
+
+    return 0;
+}
+
+void capture_stop(void)
+{
+    uint32_t delta;
+
+    if (!g_running)
+    {
+        return;
+    }
+
+    /* Already done if the buffer filled, but that doesn't matter */
+    stop_interrupts(g_config.num_channels);
+
+    if (g_config.mode == CAPTURE_MODE_SAMPLE)
+    {
+        /* Counting stops when the buffer fills */
+        delta = g_elapsed;
+    }
+    else
+    {
+        delta = g_full ? 0 : (timer_get_value(TIMESTAMP_TIMER, TIMER_A) - g_elapsed);
+    }
+
+    /* There's always room for this - see add_record() */
+    g_running = false;
+    add_record(delta, g_levels);
+}
+
+void capture_get_status(capture_status_t *p_status)
+{
+    p_status->running = g_running;
+    p_status->full = g_full;
+    p_status->tick_rate = g_tick_rate;
+    p_status->records = g_records;
+    p_status->bytes = g_used;
+}
+
+const capture_config_t *capture_get_config(void)
+{
+    return &g_config;
+}
+
+const uint8_t *capture_get_data(size_t *p_len)
+{
+    *p_len = g_used;
+    MEMORY_BARRIER_ACQUIRE();
+    return g_buffer;
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+static uint32_t read_levels(void)
+{
+    uint32_t levels = 0;
+    for (unsigned int i = 0; i < g_config.num_channels; i++)
+    {
+        const capture_channel_t *p_channel = &g_config.channels[i];
+        levels |= (uint32_t) gpio_read_inputs(p_channel->port, p_channel->mask) << (8 * i);
+    }
+    return levels;
+}
+
+/*
+ * Appends a record. One record's worth of space is kept back for the
+ * end record; when that's all that's left, capture stops.
+ */
+static void add_record(uint32_t delta, uint32_t levels)
+{
+    size_t used = g_used;
+
+    if (g_full && g_running)
+    {
+        return;
+    }
+
+    while (delta >= 0x80)
+    {
+        g_buffer[used++] = (delta & 0x7F) | 0x80;
+        delta >>= 7;
+    }
+    g_buffer[used++] = delta;
+    for (unsigned int i = 0; i < g_config.num_channels; i++)
+    {
+        g_buffer[used++] = levels >> (8 * i);
+    }
+
+    /* Make sure the record is there before anyone can see it */
+    MEMORY_BARRIER_RELEASE();
+    g_used = used;
+    g_records++;
+
+    if (g_running && ((CAPTURE_BUFFER_LEN - used) < (2 * MAX_RECORD_LEN)))
+    {
+        /* We're in the interrupt, so stop it firing for nothing */
+        g_full = true;
+        stop_interrupts(g_config.num_channels);
+    }
+}
+
+/*
+ * Stops the sample timer, or removes the first num_channels channels'
+ * edge handlers.
+ */
+static void stop_interrupts(unsigned int num_channels)
+{
+    if (g_config.mode == CAPTURE_MODE_SAMPLE)
+    {
+        timer_disable(CAPTURE_TIMER, TIMER_A);
+        timer_interrupt_disable(CAPTURE_TIMER, TIMER_A_INTERRUPT_TIMEOUT);
+        timer_interrupt_clear(CAPTURE_TIMER, TIMER_A_INTERRUPT_TIMEOUT);
+    }
+    else
+    {
+        for (unsigned int i = 0; i < num_channels; i++)
+        {
+            const capture_channel_t *p_channel = &g_config.channels[i];
+            gpio_unregister_handler(GPIO_MAKE_IO_PINS(p_channel->port, p_channel->mask));
+        }
+    }
+}
+
+static void sample_handler(timer_module_t timer, timer_ab_t ab, void *p_context, uint32_t n_context)
+{
+    uint32_t levels;
+
+    timer_interrupt_clear(CAPTURE_TIMER, TIMER_A_INTERRUPT_TIMEOUT);
+
+    if (g_full)
+    {
+        return;
+    }
+
+    g_elapsed++;
+    levels = read_levels();
+    if (levels != g_levels)
+    {
+        add_record(g_elapsed, levels);
+        g_levels = levels;
+        g_elapsed = 0;
+    }
+}
+
+static void edge_handler(gpio_io_pin_t pin, void *p_context, uint32_t n_context)
+{
+    uint32_t now = timer_get_value(TIMESTAMP_TIMER, TIMER_A);
+    uint32_t levels = read_levels();
+
+    /* Several pins can change at once, but only the first call sees it */
+    if ((levels != g_levels) && !g_full)
+    {
+        add_record(now - g_elapsed, levels);
+        g_levels = levels;
+        g_elapsed = now;
+    }
+}
+
+/**************************************************
+* End of file
+***************************************************/
+
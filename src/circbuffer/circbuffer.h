@@ -41,19 +41,46 @@ extern "C" {
 * Public Defines
 ***************************************************/
 
-/* None */
+/*
+ * Define CIRCBUFFER_STATS to have every buffer count what goes through it.
+ * Costs a few cycles per write and 20 bytes of RAM per buffer.
+ */
 
 /**************************************************
 * Public Data Types
 **************************************************/
 
-/* Circular buffer object */
+#ifdef CIRCBUFFER_STATS
+struct circbuffer_stats_t
+{
+    size_t   high_water; /* most elements ever waiting to be read   */
+    uint32_t written;    /* elements accepted since the last reset  */
+    uint32_t dropped;    /* elements dropped or overwritten         */
+};
+#endif
+
+/*
+ * Circular buffer object.
+ *
+ * In the default mode, start and end are wrapped indices and one slot is
+ * always kept open. In SPSC mode (see circbuffer_init_spsc) the size is a
+ * power of two, start and end run freely and are masked on access, and the
+ * whole buffer can be used. In SPSC mode only the producer (e.g. an ISR)
+ * writes end and only the consumer (e.g. the main loop) writes start, so
+ * no critical section is required between them.
+ */
 struct circbuffer_t
 {
     size_t    size;   /* maximum number of elements           */
-    size_t    start;  /* index of oldest element              */
-    size_t    end;    /* index at which to write new element  */
+    size_t    mask;   /* size - 1 in SPSC mode, otherwise 0   */
+    volatile size_t start;  /* index of oldest element        */
+    volatile size_t end;    /* index at which to write new element */
     uint8_t   *elems;  /* vector of elements                   */
+#ifdef CIRCBUFFER_STATS
+    struct circbuffer_stats_t stats; /* updated by the producer */
+    const char *p_name; /* set by circbuffer_register()         */
+    struct circbuffer_t *p_next; /* next registered buffer      */
+#endif
 };
 
 /**************************************************
@@ -67,10 +94,38 @@ struct circbuffer_t
 ***************************************************/
 
 void circbuffer_init(struct circbuffer_t *cb, uint8_t *p_buffer, size_t buffer_len);
+bool circbuffer_init_spsc(struct circbuffer_t *cb, uint8_t *p_buffer, size_t buffer_len);
 bool circbuffer_isfull(struct circbuffer_t *cb);
 bool circbuffer_isempty(struct circbuffer_t *cb);
+size_t circbuffer_used(struct circbuffer_t *cb);
+size_t circbuffer_free(struct circbuffer_t *cb);
 void circbuffer_write(struct circbuffer_t *cb, uint8_t elem);
 uint8_t circbuffer_read(struct circbuffer_t *cb);
+size_t circbuffer_write_block(struct circbuffer_t *cb, const uint8_t *p_data, size_t len);
+size_t circbuffer_read_block(struct circbuffer_t *cb, uint8_t *p_data, size_t len);
+uint8_t *circbuffer_get_write_span(struct circbuffer_t *cb, size_t *p_len);
+void circbuffer_commit_write(struct circbuffer_t *cb, size_t len);
+const uint8_t *circbuffer_get_read_span(struct circbuffer_t *cb, size_t *p_len);
+void circbuffer_consume(struct circbuffer_t *cb, size_t len);
+
+#ifdef CIRCBUFFER_STATS
+/*
+ * Add a buffer to the list which circbuffer_next_registered() walks, so
+ * its statistics can be reported by name. Call once, after init.
+ */
+void circbuffer_register(struct circbuffer_t *cb, const char *p_name);
+
+/*
+ * Pass NULL to get the first registered buffer, then the previous
+ * result to get the next. Returns NULL at the end of the list.
+ */
+struct circbuffer_t *circbuffer_next_registered(const struct circbuffer_t *cb);
+
+/*
+ * Zero the counters and set the high water mark to the current fill.
+ */
+void circbuffer_stats_reset(struct circbuffer_t *cb);
+#endif
 
 #ifdef __cplusplus
 }
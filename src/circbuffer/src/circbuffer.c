@@ -25,6 +25,9 @@
 * Circular buffer example from Wikipedia (http://en.wikipedia.org/wiki/Circular_buffer).
 * Keeps one slot open.
 *
+* There is also a single-producer/single-consumer mode for power-of-two
+* sized buffers, which uses free-running indices and needs no slot open.
+*
 *****************************************************/
 
 /**************************************************
@@ -41,6 +44,8 @@
 
 #define INC_AND_WRAP(val, size) (((val) + 1) % (size))
 
+#define IS_SPSC(cb) ((cb)->mask != 0)
+
 /**************************************************
 * Data Types
 **************************************************/
@@ -51,7 +56,12 @@
 * Function Prototypes
 **************************************************/
 
-/* None */
+static size_t write_offset(const struct circbuffer_t *cb);
+static size_t read_offset(const struct circbuffer_t *cb);
+static void advance_end(struct circbuffer_t *cb, size_t len);
+static void advance_start(struct circbuffer_t *cb, size_t len);
+static void record_write(struct circbuffer_t *cb, size_t written, size_t dropped);
+static void clear_stats(struct circbuffer_t *cb);
 
 /**************************************************
 * Public Data
@@ -63,7 +73,9 @@
 * Private Data
 **************************************************/
 
-/* None */
+#ifdef CIRCBUFFER_STATS
+static struct circbuffer_t *p_registered = NULL;
+#endif
 
 /**************************************************
 * Public Functions
@@ -75,13 +87,39 @@
 void circbuffer_init(struct circbuffer_t *cb, uint8_t *p_buffer, size_t buffer_len)
 {
     cb->size  = buffer_len; /* include empty elem */
+    cb->mask  = 0;
+    cb->start = 0;
+    cb->end   = 0;
+    cb->elems = p_buffer;
+    clear_stats(cb);
+}
+
+/*
+ * Single-producer/single-consumer mode. buffer_len must be a power of two
+ * (and at least 2) and all buffer_len characters can be stored. Returns
+ * false if buffer_len is unsuitable.
+ */
+bool circbuffer_init_spsc(struct circbuffer_t *cb, uint8_t *p_buffer, size_t buffer_len)
+{
+    if (!IS_POWER_OF_TWO(buffer_len) || (buffer_len < 2))
+    {
+        return false;
+    }
+    cb->size  = buffer_len;
+    cb->mask  = buffer_len - 1;
     cb->start = 0;
     cb->end   = 0;
     cb->elems = p_buffer;
+    clear_stats(cb);
+    return true;
 }
 
 bool circbuffer_isfull(struct circbuffer_t *cb)
 {
+    if (IS_SPSC(cb))
+    {
+        return (cb->end - cb->start) == cb->size;
+    }
     return INC_AND_WRAP(cb->end, cb->size) == cb->start;
 }
 
@@ -90,31 +128,262 @@ bool circbuffer_isempty(struct circbuffer_t *cb)
     return (cb->end == cb->start);
 }
 
+/* Number of elements waiting to be read */
+size_t circbuffer_used(struct circbuffer_t *cb)
+{
+    size_t start = cb->start;
+    size_t end = cb->end;
+    if (IS_SPSC(cb))
+    {
+        return end - start;
+    }
+    return (end >= start) ? (end - start) : (cb->size - start + end);
+}
+
+/* Number of elements that can be written without overwriting */
+size_t circbuffer_free(struct circbuffer_t *cb)
+{
+    if (IS_SPSC(cb))
+    {
+        return cb->size - circbuffer_used(cb);
+    }
+    return cb->size - 1 - circbuffer_used(cb);
+}
+
 /* Write an element, overwriting oldest element if buffer is full. App can
-   choose to avoid the overwrite by checking circbuffer_isfull(). */
+   choose to avoid the overwrite by checking circbuffer_isfull(). In SPSC
+   mode the producer can't move start, so the new element is dropped
+   instead. */
 void circbuffer_write(struct circbuffer_t *cb, uint8_t elem)
 {
+    if (IS_SPSC(cb))
+    {
+        if (!circbuffer_isfull(cb))
+        {
+            /* Don't write the slot until the consumer has let go of it */
+            MEMORY_BARRIER_ACQUIRE();
+            cb->elems[cb->end & cb->mask] = elem;
+            MEMORY_BARRIER_RELEASE();
+            cb->end++;
+            record_write(cb, 1, 0);
+        }
+        else
+        {
+            record_write(cb, 0, 1);
+        }
+        return;
+    }
     cb->elems[cb->end] = elem;
     cb->end = INC_AND_WRAP(cb->end, cb->size);
     if (cb->end == cb->start)
     {
         cb->start = INC_AND_WRAP(cb->start, cb->size); /* full, overwrite */
+        record_write(cb, 1, 1);
+    }
+    else
+    {
+        record_write(cb, 1, 0);
     }
 }
 
 /* Read oldest element. App must ensure !circbuffer_isempty() first. */
 uint8_t circbuffer_read(struct circbuffer_t *cb)
 {
-    uint8_t elem = cb->elems[cb->start];
+    uint8_t elem;
+    if (IS_SPSC(cb))
+    {
+        /* The app has seen end move past this element */
+        MEMORY_BARRIER_ACQUIRE();
+        elem = cb->elems[cb->start & cb->mask];
+        MEMORY_BARRIER_RELEASE();
+        cb->start++;
+        return elem;
+    }
+    elem = cb->elems[cb->start];
     cb->start = INC_AND_WRAP(cb->start, cb->size);
     return elem;
 }
 
+/*
+ * Copy up to len elements in to the buffer, in at most two runs. Never
+ * overwrites; returns the number of elements actually written.
+ */
+size_t circbuffer_write_block(struct circbuffer_t *cb, const uint8_t *p_data, size_t len)
+{
+    size_t pos = write_offset(cb);
+    size_t first;
+    size_t wanted = len;
+    len = MIN(len, circbuffer_free(cb));
+    MEMORY_BARRIER_ACQUIRE();
+    first = MIN(len, cb->size - pos);
+    memcpy(&cb->elems[pos], p_data, first);
+    memcpy(&cb->elems[0], p_data + first, len - first);
+    MEMORY_BARRIER_RELEASE();
+    advance_end(cb, len);
+    record_write(cb, len, wanted - len);
+    return len;
+}
+
+/*
+ * Copy up to len elements out of the buffer, in at most two runs. Returns
+ * the number of elements actually read.
+ */
+size_t circbuffer_read_block(struct circbuffer_t *cb, uint8_t *p_data, size_t len)
+{
+    size_t pos = read_offset(cb);
+    size_t first;
+    len = MIN(len, circbuffer_used(cb));
+    MEMORY_BARRIER_ACQUIRE();
+    first = MIN(len, cb->size - pos);
+    memcpy(p_data, &cb->elems[pos], first);
+    memcpy(p_data + first, &cb->elems[0], len - first);
+    MEMORY_BARRIER_RELEASE();
+    advance_start(cb, len);
+    return len;
+}
+
+/*
+ * Get the largest contiguous run of free space, so the producer can write
+ * straight in to the buffer. The run is *p_len long (0 if the buffer is
+ * full). Call circbuffer_commit_write() once the data is in place. There may
+ * be a second run at the start of the buffer after committing the first.
+ */
+uint8_t *circbuffer_get_write_span(struct circbuffer_t *cb, size_t *p_len)
+{
+    size_t pos = write_offset(cb);
+    *p_len = MIN(circbuffer_free(cb), cb->size - pos);
+    MEMORY_BARRIER_ACQUIRE();
+    return &cb->elems[pos];
+}
+
+/*
+ * Publish len elements written in to the span from
+ * circbuffer_get_write_span().
+ */
+void circbuffer_commit_write(struct circbuffer_t *cb, size_t len)
+{
+    MEMORY_BARRIER_RELEASE();
+    advance_end(cb, len);
+    record_write(cb, len, 0);
+}
+
+/*
+ * Get the largest contiguous run of unread elements, so the consumer can
+ * use them in place. The run is *p_len long (0 if the buffer is empty).
+ * Call circbuffer_consume() when finished with them.
+ */
+const uint8_t *circbuffer_get_read_span(struct circbuffer_t *cb, size_t *p_len)
+{
+    size_t pos = read_offset(cb);
+    *p_len = MIN(circbuffer_used(cb), cb->size - pos);
+    MEMORY_BARRIER_ACQUIRE();
+    return &cb->elems[pos];
+}
+
+/*
+ * Release len elements from the span from circbuffer_get_read_span(), so
+ * the producer can re-use the space.
+ */
+void circbuffer_consume(struct circbuffer_t *cb, size_t len)
+{
+    MEMORY_BARRIER_RELEASE();
+    advance_start(cb, len);
+}
+
+#ifdef CIRCBUFFER_STATS
+
+void circbuffer_register(struct circbuffer_t *cb, const char *p_name)
+{
+    cb->p_name = p_name;
+    cb->p_next = p_registered;
+    p_registered = cb;
+}
+
+struct circbuffer_t *circbuffer_next_registered(const struct circbuffer_t *cb)
+{
+    return cb ? cb->p_next : p_registered;
+}
+
+/*
+ * Called from the consumer side, so a write which lands mid-reset may
+ * be half counted. That's fine for tuning buffer sizes.
+ */
+void circbuffer_stats_reset(struct circbuffer_t *cb)
+{
+    cb->stats.written = 0;
+    cb->stats.dropped = 0;
+    cb->stats.high_water = circbuffer_used(cb);
+}
+
+#endif /* def CIRCBUFFER_STATS */
+
 /**************************************************
 * Private Functions
 ***************************************************/
 
-/* None */
+static size_t write_offset(const struct circbuffer_t *cb)
+{
+    return IS_SPSC(cb) ? (cb->end & cb->mask) : cb->end;
+}
+
+static size_t read_offset(const struct circbuffer_t *cb)
+{
+    return IS_SPSC(cb) ? (cb->start & cb->mask) : cb->start;
+}
+
+static void advance_end(struct circbuffer_t *cb, size_t len)
+{
+    if (IS_SPSC(cb))
+    {
+        cb->end += len;
+    }
+    else
+    {
+        size_t end = cb->end + len;
+        cb->end = (end >= cb->size) ? (end - cb->size) : end;
+    }
+}
+
+static void advance_start(struct circbuffer_t *cb, size_t len)
+{
+    if (IS_SPSC(cb))
+    {
+        cb->start += len;
+    }
+    else
+    {
+        size_t start = cb->start + len;
+        cb->start = (start >= cb->size) ? (start - cb->size) : start;
+    }
+}
+
+static void record_write(struct circbuffer_t *cb, size_t written, size_t dropped)
+{
+#ifdef CIRCBUFFER_STATS
+    size_t used = circbuffer_used(cb);
+    cb->stats.written += written;
+    cb->stats.dropped += dropped;
+    if (used > cb->stats.high_water)
+    {
+        cb->stats.high_water = used;
+    }
+#else
+    (void) cb;
+    (void) written;
+    (void) dropped;
+#endif
+}
+
+static void clear_stats(struct circbuffer_t *cb)
+{
+#ifdef CIRCBUFFER_STATS
+    cb->stats.high_water = 0;
+    cb->stats.written = 0;
+    cb->stats.dropped = 0;
+#else
+    (void) cb;
+#endif
+}
 
 /**************************************************
 * End of file
@@ -22,6 +22,38 @@
 * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
 * DEALINGS IN THE SOFTWARE.
 *
+* A simple command line harness.
+*
+* A line can hold several commands separated by ';', which run one per
+* pass of the main loop and stop at the first error. 'loop N' ...
+* 'endloop' repeats the commands between them, and 'script record'
+* stores lines to play back later with 'script run'. 'delay' waits
+* (without blocking the main loop) timed off TIMER_0, with consecutive
+* delays in a batch timed from each other so loops don't drift.
+*
+* The 'rpc' command switches to a binary mode for scripts, which calls
+* the same commands without any text. Each request is:
+*
+*   length, opcode, args...
+*
+* where length counts the bytes after it. The opcode is the command's
+* position in the command table (use COMMAND_RPC_OP_LOOKUP to find it)
+* and each arg is either COMMAND_RPC_ARG_INT and a 32-bit value, or
+* COMMAND_RPC_ARG_STR, a length and that many chars. Each reply is:
+*
+*   length, status, values...
+*
+* where status is the command's result (0 is OK) or one of the
+* COMMAND_RPC_ERROR codes, and each value (from command_reply_u32) is 32
+* bits. Multi-byte values are little-endian. A request with length 0 gets
+* an empty reply with status 0, as does the 'rpc' command itself.
+*
+* Commands which take a while can return COMMAND_IN_PROGRESS after
+* calling command_defer(). The poll function is then called from
+* command_poll() in the main loop until it returns something else, which
+* is the command's result. Ctrl-C (or COMMAND_RPC_OP_CANCEL) asks it to
+* stop. Nothing else is accepted until it has finished.
+*
 *****************************************************/
 
 #ifndef COMMAND_H
@@ -41,13 +73,61 @@ extern "C" {
 * Public Defines
 ***************************************************/
 
-/* None */
+#define COMMAND_RPC_ARG_INT 0x01
+#define COMMAND_RPC_ARG_STR 0x02
+
+/* Stops a command that's in progress. Replies when it has stopped. */
+#define COMMAND_RPC_OP_CANCEL 0xFD
+/* Takes the command name as a string. Replies with its opcode. */
+#define COMMAND_RPC_OP_LOOKUP 0xFE
+/* Goes back to the text console */
+#define COMMAND_RPC_OP_EXIT 0xFF
+
+#define COMMAND_RPC_ERROR_BAD_OPCODE (-128)
+#define COMMAND_RPC_ERROR_BAD_ARGS (-127)
+#define COMMAND_RPC_ERROR_NOT_FOUND (-126)
+#define COMMAND_RPC_ERROR_BUSY (-125)
+
+/* Returned by a command that has called command_defer() */
+#define COMMAND_IN_PROGRESS (-1)
+/* Returned by a poll function which has been told to stop */
+#define COMMAND_CANCELLED (-2)
 
 /**************************************************
 * Public Data Types
 **************************************************/
 
-/* None */
+/*
+ * Carries on with a command. If cancel is set, the command should tidy
+ * up and return COMMAND_CANCELLED. Otherwise it returns its result, or
+ * COMMAND_IN_PROGRESS to be called again next time round the main loop.
+ */
+typedef int (*command_poll_fn_t)(void *p_state, bool cancel);
+
+typedef int (*command_fn_t)(unsigned int argc, char* argv[]);
+
+/**
+ * Declares a command that can be called.
+ */
+struct command_t
+{
+    const char* p_command;
+    command_fn_t fn;
+    const char* p_help;
+};
+
+/*
+ * Commands to look up by name. p_sorted has room for num_commands
+ * indices in to p_commands, which command_table_sort() puts in name
+ * order so lookups are a binary search rather than a strcmp against
+ * every command.
+ */
+struct command_table_t
+{
+    const struct command_t *p_commands;
+    uint8_t *p_sorted;
+    unsigned int num_commands;
+};
 
 /**************************************************
 * Public Data
@@ -63,6 +143,39 @@ void command_init(void);
 void command_handle_char(char c);
 void command_handle_chars(const char* p_str, size_t num_chars);
 
+/*
+ * Adds a value to the reply when a command is called in RPC mode. Does
+ * nothing otherwise, so commands call this as well as printing.
+ */
+void command_reply_u32(uint32_t value);
+
+/*
+ * For a command to call before returning COMMAND_IN_PROGRESS. p_state
+ * is passed to poll_fn and must stay valid until the command finishes.
+ */
+void command_defer(command_poll_fn_t poll_fn, void *p_state);
+
+/*
+ * Runs any command in progress. Call this from the main loop.
+ */
+void command_poll(void);
+
+/*
+ * @return true while in binary RPC mode, when anything else written to
+ * the UART would corrupt the replies
+ */
+bool command_rpc_active(void);
+
+/*
+ * Fills in the table's p_sorted. Call it before command_table_find().
+ */
+void command_table_sort(const struct command_table_t *p_table);
+
+/*
+ * @return the command called p_name, or NULL
+ */
+const struct command_t *command_table_find(const struct command_table_t *p_table, const char *p_name);
+
 #ifdef __cplusplus
 }
 #endif
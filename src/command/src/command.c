@@ -23,7 +23,8 @@
 * DEALINGS IN THE SOFTWARE.
 *
 *
-* This module implements a simple command line harness.
+* This module implements a simple command line harness, with a binary
+* RPC mode for scripts. See command.h.
 *
 *****************************************************/
 
@@ -37,6 +38,12 @@
 #include <math.h>
 
 #include "drivers/gpio/gpio.h"
+#include "drivers/uart/uart.h"
+#include "drivers/timers/timers.h"
+#include "circbuffer/circbuffer.h"
+#include "bench/bench.h"
+#include "pattern/pattern.h"
+#include "capture/capture.h"
 
 #include "command/command.h"
 
@@ -47,31 +54,152 @@
 #define MAX_COMMAND_LINE (80)
 #define MAX_ARGS (8)
 
+/* Room for RPC arguments once they've been turned back in to strings */
+#define MAX_RPC_ARG_CHARS (2 * MAX_COMMAND_LINE)
+#define MAX_RPC_VALUES (8)
+
+#define CTRL_C (0x03)
+
+#define DEFAULT_BENCH_RUNS (16)
+
+/* Capture dump output - bytes per line and lines per main loop pass */
+#define DUMP_LINE_BYTES (32)
+#define DUMP_LINES_PER_POLL (8)
+
+/* Statements in a batch are split by either of these */
+#define STATEMENT_SEPARATORS ";\n"
+
+/* Scripts and loops within a command line */
+#define MAX_NESTING (4)
+#define MAX_SCRIPT (512)
+
+/* So the tick count fits in 32 bits */
+#define MAX_DELAY_MS (60000)
+
+/* Internal result for a command that doesn't exist */
+#define COMMAND_NOT_FOUND (-3)
+
+/* Output for people, which is suppressed in RPC mode */
+#define TEXT(...) do { if (!g_rpc.active) { PRINTF(__VA_ARGS__); } } while (0)
+
 /**************************************************
 * Data Types
 **************************************************/
 
-typedef int (*command_fn_t)(unsigned int argc, char* argv[]);
+struct rpc_state_t
+{
+    bool active;
+    bool have_length;
+    size_t length;          /* of the request being received */
+    size_t used;
+    uint8_t request[MAX_COMMAND_LINE];
+    char args[MAX_RPC_ARG_CHARS];
+    uint8_t reply[2 + (4 * MAX_RPC_VALUES)];
+    size_t num_values;
+};
+
+/* A command which has returned COMMAND_IN_PROGRESS */
+struct pending_t
+{
+    command_poll_fn_t poll_fn;
+    void *p_state;
+    bool cancel;
+};
+
+/* A run of statements: a command line, a script or the body of a loop */
+struct frame_t
+{
+    const char *p_start;
+    const char *p_next;
+    const char *p_end;
+    uint32_t repeats;       /* times left to run it, including this one */
+};
 
-/**
- * Declares a command that can be called.
+/*
+ * The statements still to run. Each is run from command_poll(), one per
+ * pass of the main loop, so a long script doesn't stall anything else.
  */
-struct command_t
+struct batch_t
+{
+    struct frame_t frames[MAX_NESTING];
+    unsigned int depth;
+    /*
+     * When the last delay in this batch finished, so that back-to-back
+     * delays (including round the end of a loop) don't drift. Any other
+     * statement clears it.
+     */
+    uint32_t deadline;
+    bool have_deadline;
+};
+
+struct delay_state_t
+{
+    uint32_t start;
+    uint32_t ticks;
+};
+
+struct wait_state_t
+{
+    gpio_io_pin_t pin;
+    uint8_t level;
+};
+
+struct bench_state_t
+{
+    unsigned int next_id;
+    unsigned int runs;
+};
+
+struct dump_state_t
 {
-    const char* p_command;
-    command_fn_t fn;
-    const char* p_help;
+    size_t offset;
 };
 
+#ifdef CIRCBUFFER_STATS
+#define STATS_COMMAND_DEFINITIONS \
+    X("buffers", fn_buffers, "- Show buffer stats ('reset' to clear)")
+#else
+#define STATS_COMMAND_DEFINITIONS
+#endif
+
 #define COMMAND_DEFINITIONS \
     X("help", fn_help, "- Prints help") \
-    X("gpio", fn_gpio, "- Set GPIO")
+    X("gpio", fn_gpio, "- Set GPIO ('pattern' to play timed steps)") \
+    X("wait", fn_wait, "- Wait for a GPIO input level") \
+    X("uart", fn_uart, "- Show UART0 stats ('reset' to clear)") \
+    X("bench", fn_bench, "- Time code ('list', or a name and how many runs)") \
+    X("capture", fn_capture, "- Capture GPIO inputs ('sample', 'edge', 'stop', 'dump')") \
+    X("delay", fn_delay, "- Wait for some milliseconds") \
+    X("loop", fn_loop, "- Run up to 'endloop' N times (in a batch or script)") \
+    X("endloop", fn_endloop, "- End of a loop") \
+    X("script", fn_script, "- 'record' (until 'end'), 'run' [N], 'show' or 'clear'") \
+    X("rpc", fn_rpc, "- Switch to binary RPC mode") \
+    STATS_COMMAND_DEFINITIONS
 
 /**************************************************
 * Function Prototypes
 **************************************************/
 
 static void process_command(void);
+static void record_line(void);
+static void continue_batch(void);
+static bool next_statement(const char **pp_statement, size_t *p_len);
+static void leave_finished_frames(void);
+static const char *statement_end(const char *p, const char *p_end);
+static int statement_word(const char *p, const char *p_end, const char *p_word);
+static bool blank_statements(const char *p, const char *p_end);
+static void execute_statement(const char *p_statement, size_t len);
+static void run_command(const struct command_t *p, unsigned int argc, char* argv[]);
+static void statement_done(int result);
+static void report_result(int result);
+static bool busy(void);
+static void reset_line(void);
+
+static void rpc_handle_byte(uint8_t byte);
+static void rpc_process(void);
+static int rpc_parse_args(const uint8_t *p_data, size_t len, unsigned int *p_argc, char *argv[]);
+static void rpc_send_reply(int status);
+static char *format_u32(char *p_out, uint32_t value);
 static void handle_backspace(void);
 static void handle_char(char c);
 
@@ -80,6 +208,16 @@ static void print_prompt(void);
 static void beep(void);
 
 static uint32_t parse_int(const char* str);
+static int parse_pin(const char* str, gpio_io_pin_t *p_pin);
+
+static int fn_gpio_pattern(unsigned int argc, char* argv[]);
+static int poll_wait(void *p_state, bool cancel);
+static int poll_pattern(void *p_state, bool cancel);
+static int poll_delay(void *p_state, bool cancel);
+static int poll_bench(void *p_state, bool cancel);
+static void print_bench(unsigned int id, const bench_result_t *p_result);
+static int parse_channels(unsigned int argc, char* argv[], capture_config_t *p_config);
+static int poll_dump(void *p_state, bool cancel);
 
 #define X(label, fun, help) \
     static int fun(unsigned int argc, char* argv[]);
@@ -104,7 +242,33 @@ static const struct command_t g_commands[] = {
 * Private Data
 **************************************************/
 
-/* None */
+/*
+ * Indices in to g_commands, in name order, so lookups are a binary
+ * search rather than a strcmp against every command. It's built once by
+ * command_init() so COMMAND_DEFINITIONS can stay in whatever order reads
+ * best.
+ */
+static uint8_t g_sorted[NUMELTS(g_commands)];
+
+/* Fails to compile if there are too many commands for g_sorted */
+typedef char command_count_check[(NUMELTS(g_commands) <= 256) ? 1 : -1];
+
+static const struct command_table_t g_command_table = {
+    g_commands, g_sorted, NUMELTS(g_commands)
+};
+
+static struct rpc_state_t g_rpc;
+
+static struct pending_t g_pending;
+
+static struct batch_t g_batch;
+
+/* The statement being run, split up in to argv */
+static char g_exec_buffer[MAX_COMMAND_LINE];
+
+static char g_script[MAX_SCRIPT];
+static size_t g_script_len;
+static bool g_recording;
 
 /**************************************************
 * Public Functions
@@ -112,14 +276,43 @@ static const struct command_t g_commands[] = {
 
 void command_init(void)
 {
-    print_prompt();
-    g_buffer_used = 0;
-    g_command_buffer[0] = '\0';
+    command_table_sort(&g_command_table);
+    reset_line();
 }
 
 void command_handle_char(char c)
 {
-    if ((c == '\r') || (c == '\n'))
+    if (g_rpc.active)
+    {
+        rpc_handle_byte((uint8_t) c);
+    }
+    else if (c == CTRL_C)
+    {
+        TEXT("^C\n");
+        if (g_pending.poll_fn)
+        {
+            /* command_poll() will print the result */
+            g_pending.cancel = true;
+        }
+        else if (g_batch.depth)
+        {
+            /* Between statements, so just don't run any more */
+            g_batch.depth = 0;
+            report_result(COMMAND_CANCELLED);
+        }
+        else
+        {
+            /* Abandon the line (or the recording) */
+            g_recording = false;
+            reset_line();
+        }
+    }
+    else if (busy())
+    {
+        /* Busy */
+        beep();
+    }
+    else if ((c == '\r') || (c == '\n'))
     {
         process_command();
     }
@@ -147,16 +340,54 @@ void command_handle_chars(const char* p_str, size_t num_chars)
     }
 }
 
+void command_reply_u32(uint32_t value)
+{
+    if (g_rpc.active && (g_rpc.num_values < MAX_RPC_VALUES))
+    {
+        uint8_t *p = &g_rpc.reply[2 + (4 * g_rpc.num_values)];
+        p[0] = value;
+        p[1] = value >> 8;
+        p[2] = value >> 16;
+        p[3] = value >> 24;
+        g_rpc.num_values++;
+    }
+}
+
+void command_defer(command_poll_fn_t poll_fn, void *p_state)
+{
+    g_pending.poll_fn = poll_fn;
+    g_pending.p_state = p_state;
+    g_pending.cancel = false;
+}
+
+void command_poll(void)
+{
+    if (g_pending.poll_fn)
+    {
+        int result = g_pending.poll_fn(g_pending.p_state, g_pending.cancel);
+        if (result != COMMAND_IN_PROGRESS)
+        {
+            g_pending.poll_fn = NULL;
+            statement_done(result);
+        }
+    }
+    else if (g_batch.depth)
+    {
+        continue_batch();
+    }
+}
+
+bool command_rpc_active(void)
+{
+    return g_rpc.active;
+}
+
 /**************************************************
 * Private Functions
 ***************************************************/
 
 static void process_command(void)
 {
-    char* argv[MAX_ARGS];
-    unsigned int argc = 0;
-    bool found = false;
-
     if (!g_buffer_used)
     {
         /* Catch LF after a CR silently */
@@ -165,198 +396,1251 @@ static void process_command(void)
 
     /* If your console is echoing keypresses, you don't need this */
 #ifndef BUFFERED_CONSOLE
-    PRINTF("\n");
+    TEXT("\n");
 #endif
 
     /* Terminate the buffer */
     g_command_buffer[g_buffer_used] = '\0';
 
-    argv[argc] = strtok(g_command_buffer, " ");
-    while(argv[argc] && (argc < MAX_ARGS))
+    if (g_recording)
     {
-        argc++;
-        argv[argc] = strtok(NULL, " ");
+        record_line();
+        return;
     }
 
-    for(unsigned int i = 0; i < NUMELTS(g_commands); i++)
+    /* Run the line as a batch of one or more statements */
+    g_batch.frames[0].p_start = g_command_buffer;
+    g_batch.frames[0].p_next = g_command_buffer;
+    g_batch.frames[0].p_end = g_command_buffer + g_buffer_used;
+    g_batch.frames[0].repeats = 1;
+    g_batch.depth = 1;
+    g_batch.have_deadline = false;
+
+    /* Start straight away, rather than waiting for command_poll() */
+    continue_batch();
+}
+
+/*
+ * Add a line to the script, unless it's the end.
+ */
+static void record_line(void)
+{
+    if (strcmp(g_command_buffer, "end") == 0)
     {
-        const struct command_t * const p = &(g_commands[i]);
-        if (strcmp(argv[0], p->p_command) == 0)
-        {
-            if (p->fn)
-            {
-                int result = p->fn(argc, argv);
-                if (result == 0)
-                {
-                    PRINTF("Command OK\n");
-                }
-                else
-                {
-                    PRINTF("Command error %d\n", result);
-                }
-            }
-            found = true;
-            break;
-        }
+        g_recording = false;
+        TEXT("Recorded %u bytes\n", (unsigned int) g_script_len);
     }
-
-    if (!found)
+    else if ((g_script_len + g_buffer_used + 1) <= sizeof(g_script))
     {
-        PRINTF("Command '%s' not found!\n", argv[0]);
+        memcpy(&g_script[g_script_len], g_command_buffer, g_buffer_used);
+        g_script_len += g_buffer_used;
+        g_script[g_script_len] = '\n';
+        g_script_len++;
     }
-
-    command_init();
+    else
+    {
+        g_recording = false;
+        TEXT("Script full - recorded %u bytes\n", (unsigned int) g_script_len);
+    }
+    reset_line();
 }
 
-static void handle_backspace(void)
+/*
+ * Run the next statement in the batch, or report that it's finished.
+ */
+static void continue_batch(void)
 {
-    if (g_buffer_used)
+    const char *p_statement;
+    size_t len;
+    if (next_statement(&p_statement, &len))
     {
-        /* Erase the previous character and go back one */
-        PRINTF("\b \b");
-        /* One less in the buffer */
-        g_buffer_used--;
+        execute_statement(p_statement, len);
     }
     else
     {
-        beep();
+        report_result(0);
     }
 }
 
-static void handle_char(char c)
+/*
+ * Find the next statement to run, going round loops and leaving loops
+ * and scripts as they finish. Skips empty statements.
+ *
+ * @return false if the batch is finished
+ */
+static bool next_statement(const char **pp_statement, size_t *p_len)
 {
-    if (g_buffer_used != (MAX_COMMAND_LINE-1))
+    leave_finished_frames();
+    while (g_batch.depth)
     {
-        g_command_buffer[g_buffer_used] = c;
-        g_buffer_used++;
-#ifndef BUFFERED_CONSOLE
-        /* If your console is echoing keypresses, you don't need this */
-        PRINTF("%c", c);
-        fflush(stdout);
-#endif
+        struct frame_t *const p_frame = &g_batch.frames[g_batch.depth - 1];
+        const char *p = p_frame->p_next;
+        const char *p_sep = statement_end(p, p_frame->p_end);
+        p_frame->p_next = (p_sep < p_frame->p_end) ? (p_sep + 1) : p_frame->p_end;
+        while ((p < p_sep) && (*p == ' '))
+        {
+            p++;
+        }
+        if (p < p_sep)
+        {
+            *pp_statement = p;
+            *p_len = p_sep - p;
+            return true;
+        }
+        leave_finished_frames();
     }
+    return false;
 }
 
-
-static void print_prompt(void)
+/*
+ * Go round loops which have got to the end, and drop frames which have
+ * finished.
+ */
+static void leave_finished_frames(void)
 {
-    PRINTF("\r> ");
-    fflush(stdout);
+    while (g_batch.depth)
+    {
+        struct frame_t *const p_frame = &g_batch.frames[g_batch.depth - 1];
+        if (p_frame->p_next < p_frame->p_end)
+        {
+            break;
+        }
+        p_frame->repeats--;
+        if (p_frame->repeats)
+        {
+            p_frame->p_next = p_frame->p_start;
+            break;
+        }
+        g_batch.depth--;
+    }
 }
 
-static void beep(void)
+/*
+ * @return the separator at the end of the statement starting at p, or
+ *         p_end if there isn't one
+ */
+static const char *statement_end(const char *p, const char *p_end)
 {
-    PRINTF("\a");
+    while ((p < p_end) && !strchr(STATEMENT_SEPARATORS, *p))
+    {
+        p++;
+    }
+    return p;
 }
 
-static uint32_t parse_int(const char* str)
+/*
+ * @return 1 if the statement starting at p is the command p_word, else 0
+ */
+static int statement_word(const char *p, const char *p_end, const char *p_word)
 {
-    uint32_t result = 0;
-    unsigned int factor = 10;
-    if (strlen(str) >= 2)
+    const size_t len = strlen(p_word);
+    while ((p < p_end) && (*p == ' '))
     {
-        if ((str[0] == '0') && (str[1] == 'x'))
-        {
-            factor = 16;
-            str = str + 2;
-        }
+        p++;
     }
-    while(*str)
+    return ((size_t) (p_end - p) >= len) && (memcmp(p, p_word, len) == 0)
+           && (((size_t) (p_end - p) == len) || (p[len] == ' '));
+}
+
+/*
+ * @return true if there's nothing but spaces and separators from p to p_end
+ */
+static bool blank_statements(const char *p, const char *p_end)
+{
+    while ((p < p_end) && ((*p == ' ') || strchr(STATEMENT_SEPARATORS, *p)))
     {
-        const char c = *str;
-        result *= factor;
-        if (isdigit((int) c))
-        {
-            result += c - '0';
-        }
-        else if ((c >= 'A') && (c <= 'F') && (factor == 16))
-        {
-            result += 10 + (c - 'A');
-        }
-        else if ((c >= 'a') && (c <= 'f') && (factor == 16))
-        {
-            result += 10 + (c - 'a');
-        }
-        else
-        {
-            break;
-        }
-        str++;
+        p++;
     }
-    return result;
+    return p == p_end;
 }
 
-/* Commands */
+/*
+ * Split up a statement and run it.
+ */
+static void execute_statement(const char *p_statement, size_t len)
+{
+    char* argv[MAX_ARGS + 1];
+    unsigned int argc = 0;
+    const struct command_t *p;
 
-static int fn_help(unsigned int argc, char* argv[])
+    /* A copy, as strtok writes to it */
+    len = MIN(len, sizeof(g_exec_buffer) - 1);
+    memcpy(g_exec_buffer, p_statement, len);
+    g_exec_buffer[len] = '\0';
+
+    argv[argc] = strtok(g_exec_buffer, " ");
+    while(argv[argc] && (argc < MAX_ARGS))
+    {
+        argc++;
+        argv[argc] = strtok(NULL, " ");
+    }
+
+    p = command_table_find(&g_command_table, argv[0]);
+    if (!p)
+    {
+        TEXT("Command '%s' not found!\n", argv[0]);
+        statement_done(COMMAND_NOT_FOUND);
+    }
+    else if (!p->fn)
+    {
+        statement_done(0);
+    }
+    else
+    {
+        run_command(p, argc, argv);
+    }
+}
+
+/*
+ * Calls a command, unless it's going to finish later.
+ */
+static void run_command(const struct command_t *p, unsigned int argc, char* argv[])
 {
-    size_t max_len = 0;
-    PRINTF("Command list:\n");
-    /* Find the longest command, so the padding is neat */
-    for(unsigned int i = 0; i < NUMELTS(g_commands); i++)
+    int result;
+    g_pending.poll_fn = NULL;
+    if (p->fn != fn_delay)
     {
-        size_t this_len = strlen(g_commands[i].p_command);
-        if (this_len > max_len)
-        {
-            max_len = this_len;
-        }
+        /* Only a delay straight after a delay keeps to the last one's time */
+        g_batch.have_deadline = false;
     }
-    for(unsigned int i = 0; i < NUMELTS(g_commands); i++)
+    result = p->fn(argc, argv);
+    if ((result != COMMAND_IN_PROGRESS) || !g_pending.poll_fn)
     {
-        const struct command_t * const p = &(g_commands[i]);
-        PRINTF("\t%-*s %s\n", (int) max_len, p->p_command, p->p_help);
+        statement_done(result);
     }
-    /* Help is always successful */
-    return 0;
 }
 
-static int fn_gpio(unsigned int argc, char* argv[])
+/*
+ * A statement has finished. An error stops the whole batch. Otherwise
+ * command_poll() runs the next statement, if there is one.
+ */
+static void statement_done(int result)
 {
-    /* portpin i/0/1 */
-    /* e.g. E1 0 */
-    /* e.g. A3 i */
-    if (argc != 3)
+    if (result != 0)
     {
-        PRINTF("Call %s A3 i to set A3 as input\n", argv[0]);
-        PRINTF("Call %s E1 0 to set E1 as output low\n", argv[0]);
-        PRINTF("Call %s F2 1 to set F2 as output high\n", argv[0]);
-        return 1;
+        g_batch.depth = 0;
     }
     else
     {
-        gpio_port_t port = argv[1][0] - 'A';
-        uint8_t pin_no = argv[1][1] - '0';
-        char mode = argv[2][0];
-        gpio_io_pin_t pin = GPIO_MAKE_IO_PIN(port, pin_no);
-        if (port >= GPIO_NUM_PORTS)
-        {
-            PRINTF("Bad port\n");
-            return 2;
-        }
-        if (pin_no > 7)
-        {
-            PRINTF("Bad pin\n");
-            return 3;
-        }
-        switch(mode)
-        {
-        case 'i':
-            gpio_make_input(pin);
-            PRINTF("%s (0x%04X) is %d\n", argv[1], pin, gpio_read_input(GPIO_MAKE_IO_PIN(port, pin)));
-            break;
-        case '0':
-        case '1':
-            gpio_make_output(pin, mode - '0');
-            PRINTF("%s (0x%04X) set to %d\n", argv[1], pin, mode - '0');
-            break;
-        default:
-            PRINTF("Bad mode\n");
-            return 4;
-        }
-        return 0;
+        /* If that was the last statement, say so now */
+        leave_finished_frames();
+    }
+    if (!g_batch.depth)
+    {
+        report_result(result);
+    }
+}
+
+/*
+ * Tell whoever called the command how it went, and get ready for the
+ * next one.
+ */
+static void report_result(int result)
+{
+    if (g_rpc.active)
+    {
+        /* Keep clear of our own error codes */
+        rpc_send_reply(MIN(MAX(result, COMMAND_RPC_ERROR_BUSY + 1), 127));
+        return;
+    }
+    if (result == 0)
+    {
+        TEXT("Command OK\n");
+    }
+    else if (result == COMMAND_CANCELLED)
+    {
+        TEXT("Command cancelled\n");
+    }
+    else if (result != COMMAND_NOT_FOUND)
+    {
+        TEXT("Command error %d\n", result);
     }
+    reset_line();
+}
+
+/*
+ * @return true if a command or batch is still running
+ */
+static bool busy(void)
+{
+    return g_pending.poll_fn || g_batch.depth;
 }
 
+static void reset_line(void)
+{
+    print_prompt();
+    g_buffer_used = 0;
+    g_command_buffer[0] = '\0';
+}
+
+/*
+ * Collect a request: a length byte, then that many bytes.
+ */
+static void rpc_handle_byte(uint8_t byte)
+{
+    if (!g_rpc.have_length)
+    {
+        g_rpc.length = byte;
+        g_rpc.used = 0;
+        g_rpc.have_length = true;
+    }
+    else if (g_rpc.used < sizeof(g_rpc.request))
+    {
+        g_rpc.request[g_rpc.used] = byte;
+        g_rpc.used++;
+    }
+    else
+    {
+        /* Too long. Swallow the rest and complain at the end. */
+        g_rpc.used++;
+    }
+
+    if (g_rpc.have_length && (g_rpc.used == g_rpc.length))
+    {
+        g_rpc.have_length = false;
+        rpc_process();
+    }
+}
+
+static void rpc_process(void)
+{
+    char* argv[MAX_ARGS + 1];
+    unsigned int argc = 1;
+    unsigned int opcode;
+    int result;
+
+    if ((g_rpc.length > 0) && (g_rpc.request[0] == COMMAND_RPC_OP_CANCEL))
+    {
+        /* The command in progress replies when it stops */
+        if (g_pending.poll_fn)
+        {
+            g_pending.cancel = true;
+        }
+        else
+        {
+            g_rpc.num_values = 0;
+            rpc_send_reply(0);
+        }
+        return;
+    }
+
+    if (busy())
+    {
+        /* Don't touch the reply, it's not finished with */
+        const uint8_t busy[2] = { 1, (uint8_t) (int8_t) COMMAND_RPC_ERROR_BUSY };
+        fwrite(busy, 1, sizeof(busy), stdout);
+        fflush(stdout);
+        return;
+    }
+
+    g_rpc.num_values = 0;
+
+    if (g_rpc.length == 0)
+    {
+        /* Ping */
+        rpc_send_reply(0);
+        return;
+    }
+
+    if (g_rpc.length > sizeof(g_rpc.request))
+    {
+        rpc_send_reply(COMMAND_RPC_ERROR_BAD_ARGS);
+        return;
+    }
+
+    opcode = g_rpc.request[0];
+    result = rpc_parse_args(&g_rpc.request[1], g_rpc.length - 1, &argc, argv);
+    if (result != 0)
+    {
+        rpc_send_reply(result);
+        return;
+    }
+
+    if (opcode == COMMAND_RPC_OP_EXIT)
+    {
+        rpc_send_reply(0);
+        g_rpc.active = false;
+        reset_line();
+    }
+    else if (opcode == COMMAND_RPC_OP_LOOKUP)
+    {
+        const struct command_t *p = (argc == 2) ? command_table_find(&g_command_table, argv[1]) : NULL;
+        if (p)
+        {
+            command_reply_u32(p - g_commands);
+        }
+        rpc_send_reply(p ? 0 : COMMAND_RPC_ERROR_NOT_FOUND);
+    }
+    else if ((opcode < NUMELTS(g_commands)) && g_commands[opcode].fn)
+    {
+        /* Commands don't write to argv[0] */
+        argv[0] = (char*) g_commands[opcode].p_command;
+        run_command(&g_commands[opcode], argc, argv);
+    }
+    else
+    {
+        rpc_send_reply(COMMAND_RPC_ERROR_BAD_OPCODE);
+    }
+}
+
+/*
+ * Turn typed arguments back in to strings for the command to parse.
+ * argv[0] is left for the command name.
+ *
+ * @return 0 or COMMAND_RPC_ERROR_BAD_ARGS
+ */
+static int rpc_parse_args(const uint8_t *p_data, size_t len, unsigned int *p_argc, char *argv[])
+{
+    char *p_out = g_rpc.args;
+    char *const p_end = g_rpc.args + sizeof(g_rpc.args);
+
+    while (len)
+    {
+        if (*p_argc == MAX_ARGS)
+        {
+            return COMMAND_RPC_ERROR_BAD_ARGS;
+        }
+        argv[*p_argc] = p_out;
+        if ((p_data[0] == COMMAND_RPC_ARG_INT) && (len >= 5))
+        {
+            const uint32_t value = p_data[1] | (p_data[2] << 8) | (p_data[3] << 16) | ((uint32_t) p_data[4] << 24);
+            /* Ten digits and a null */
+            if ((p_end - p_out) < 11)
+            {
+                return COMMAND_RPC_ERROR_BAD_ARGS;
+            }
+            p_out = format_u32(p_out, value);
+            p_data += 5;
+            len -= 5;
+        }
+        else if ((p_data[0] == COMMAND_RPC_ARG_STR) && (len >= 2) && (len - 2 >= p_data[1]))
+        {
+            const size_t str_len = p_data[1];
+            if ((size_t) (p_end - p_out) < (str_len + 1))
+            {
+                return COMMAND_RPC_ERROR_BAD_ARGS;
+            }
+            memcpy(p_out, &p_data[2], str_len);
+            p_out[str_len] = '\0';
+            p_out += str_len + 1;
+            p_data += 2 + str_len;
+            len -= 2 + str_len;
+        }
+        else
+        {
+            return COMMAND_RPC_ERROR_BAD_ARGS;
+        }
+        (*p_argc)++;
+    }
+
+    argv[*p_argc] = NULL;
+    return 0;
+}
+
+static void rpc_send_reply(int status)
+{
+    const size_t len = 2 + (4 * g_rpc.num_values);
+    g_rpc.reply[0] = len - 1;
+    g_rpc.reply[1] = (uint8_t) (int8_t) status;
+    fwrite(g_rpc.reply, 1, len, stdout);
+    fflush(stdout);
+}
+
+/*
+ * Writes value in decimal, null terminated.
+ *
+ * @return the char after the null
+ */
+static char *format_u32(char *p_out, uint32_t value)
+{
+    char digits[10];
+    unsigned int num_digits = 0;
+    do
+    {
+        digits[num_digits] = '0' + (value % 10);
+        num_digits++;
+        value /= 10;
+    } while (value);
+    while (num_digits)
+    {
+        num_digits--;
+        *p_out = digits[num_digits];
+        p_out++;
+    }
+    *p_out = '\0';
+    return p_out + 1;
+}
+
+static void handle_backspace(void)
+{
+    if (g_buffer_used)
+    {
+        /* Erase the previous character and go back one */
+        TEXT("\b \b");
+        /* One less in the buffer */
+        g_buffer_used--;
+    }
+    else
+    {
+        beep();
+    }
+}
+
+static void handle_char(char c)
+{
+    if (g_buffer_used != (MAX_COMMAND_LINE-1))
+    {
+        g_command_buffer[g_buffer_used] = c;
+        g_buffer_used++;
+#ifndef BUFFERED_CONSOLE
+        /* If your console is echoing keypresses, you don't need this */
+        putchar(c);
+        fflush(stdout);
+#endif
+    }
+}
+
+
+static void print_prompt(void)
+{
+    TEXT(g_recording ? "\r. " : "\r> ");
+    fflush(stdout);
+}
+
+static void beep(void)
+{
+    TEXT("\a");
+}
+
+static uint32_t parse_int(const char* str)
+{
+    uint32_t result = 0;
+    unsigned int factor = 10;
+    if (strlen(str) >= 2)
+    {
+        if ((str[0] == '0') && (str[1] == 'x'))
+        {
+            factor = 16;
+            str = str + 2;
+        }
+    }
+    while(*str)
+    {
+        const char c = *str;
+        result *= factor;
+        if (isdigit((int) c))
+        {
+            result += c - '0';
+        }
+        else if ((c >= 'A') && (c <= 'F') && (factor == 16))
+        {
+            result += 10 + (c - 'A');
+        }
+        else if ((c >= 'a') && (c <= 'f') && (factor == 16))
+        {
+            result += 10 + (c - 'a');
+        }
+        else
+        {
+            break;
+        }
+        str++;
+    }
+    return result;
+}
+
+/*
+ * Parse a pin name like A3.
+ *
+ * @return 0, or the gpio command's error code
+ */
+static int parse_pin(const char* str, gpio_io_pin_t *p_pin)
+{
+    gpio_port_t port = str[0] - 'A';
+    uint8_t pin_no = str[1] - '0';
+    if (port >= GPIO_NUM_PORTS)
+    {
+        TEXT("Bad port\n");
+        return 2;
+    }
+    if (pin_no > 7)
+    {
+        TEXT("Bad pin\n");
+        return 3;
+    }
+    *p_pin = GPIO_MAKE_IO_PIN(port, pin_no);
+    return 0;
+}
+
+/* Commands */
+
+static int fn_help(unsigned int argc, char* argv[])
+{
+    size_t max_len = 0;
+    TEXT("Command list:\n");
+    /* Find the longest command, so the padding is neat */
+    for(unsigned int i = 0; i < NUMELTS(g_commands); i++)
+    {
+        size_t this_len = strlen(g_commands[i].p_command);
+        if (this_len > max_len)
+        {
+            max_len = this_len;
+        }
+    }
+    for(unsigned int i = 0; i < NUMELTS(g_commands); i++)
+    {
+        const struct command_t * const p = &(g_commands[g_sorted[i]]);
+        TEXT("\t%-*s %s\n", (int) max_len, p->p_command, p->p_help);
+    }
+    /* Help is always successful */
+    return 0;
+}
+
+static int fn_gpio(unsigned int argc, char* argv[])
+{
+    /* portpin i/0/1 */
+    /* e.g. E1 0 */
+    /* e.g. A3 i */
+    if ((argc >= 2) && (strcmp(argv[1], "pattern") == 0))
+    {
+        return fn_gpio_pattern(argc - 1, argv + 1);
+    }
+    if (argc != 3)
+    {
+        TEXT("Call %s A3 i to set A3 as input\n", argv[0]);
+        TEXT("Call %s E1 0 to set E1 as output low\n", argv[0]);
+        TEXT("Call %s F2 1 to set F2 as output high\n", argv[0]);
+        TEXT("Call %s pattern for timed patterns\n", argv[0]);
+        return 1;
+    }
+    else
+    {
+        char mode = argv[2][0];
+        int level;
+        gpio_io_pin_t pin;
+        int result = parse_pin(argv[1], &pin);
+        if (result != 0)
+        {
+            return result;
+        }
+        switch(mode)
+        {
+        case 'i':
+            gpio_make_input(pin);
+            level = gpio_read_input(pin);
+            TEXT("%s (0x%04X) is %d\n", argv[1], pin, level);
+            command_reply_u32(level);
+            break;
+        case '0':
+        case '1':
+            gpio_make_output(pin, mode - '0');
+            TEXT("%s (0x%04X) set to %d\n", argv[1], pin, mode - '0');
+            break;
+        default:
+            TEXT("Bad mode\n");
+            return 4;
+        }
+        return 0;
+    }
+}
+
+/*
+ * gpio pattern add <port> <mask> <value> <us>
+ * gpio pattern clear|show|stop
+ * gpio pattern run [N]
+ */
+static int fn_gpio_pattern(unsigned int argc, char* argv[])
+{
+    if ((argc == 6) && (strcmp(argv[1], "add") == 0))
+    {
+        gpio_port_t port = argv[2][0] - 'A';
+        uint64_t ticks = ((uint64_t) parse_int(argv[5]) * CLOCK_RATE) / 1000000UL;
+        int result;
+        if ((port >= GPIO_NUM_PORTS) || (argv[2][1] != '\0'))
+        {
+            TEXT("Bad port\n");
+            return 2;
+        }
+        if (ticks > UINT32_MAX)
+        {
+            ticks = 0;
+        }
+        result = pattern_add(port, parse_int(argv[3]), parse_int(argv[4]), ticks);
+        if (result == PATTERN_ERROR_INVALID_DELAY)
+        {
+            TEXT("Delay must be 2 us to %" PRIu32 " s\n", (uint32_t) (UINT32_MAX / CLOCK_RATE));
+            return 5;
+        }
+        else if (result == PATTERN_ERROR_FULL)
+        {
+            TEXT("Only room for %u steps\n", PATTERN_MAX_STEPS);
+            return 5;
+        }
+        else if (result < 0)
+        {
+            TEXT("Pattern is running\n");
+            return 6;
+        }
+        command_reply_u32(result);
+        return 0;
+    }
+    else if ((argc == 2) && (strcmp(argv[1], "clear") == 0))
+    {
+        if (pattern_clear() < 0)
+        {
+            TEXT("Pattern is running\n");
+            return 6;
+        }
+        return 0;
+    }
+    else if ((argc == 2) && (strcmp(argv[1], "show") == 0))
+    {
+        for (unsigned int i = 0; i < pattern_count(); i++)
+        {
+            const pattern_step_t *p_step = pattern_get(i);
+            TEXT("%2u: %c mask 0x%02X value 0x%02X for %" PRIu32 " us\n",
+                 i, 'A' + p_step->port, p_step->mask, p_step->value,
+                 (uint32_t) (((uint64_t) p_step->delay * 1000000UL) / CLOCK_RATE));
+        }
+        TEXT("%s, %" PRIu32 " passes\n", pattern_running() ? "Running" : "Stopped", pattern_passes());
+        command_reply_u32(pattern_count());
+        command_reply_u32(pattern_running());
+        command_reply_u32(pattern_passes());
+        return 0;
+    }
+    else if ((argc == 2) && (strcmp(argv[1], "stop") == 0))
+    {
+        pattern_stop();
+        return 0;
+    }
+    else if (((argc == 2) || (argc == 3)) && (strcmp(argv[1], "run") == 0))
+    {
+        unsigned int repeats = (argc == 3) ? parse_int(argv[2]) : 1;
+        int result = pattern_start(repeats);
+        if (result == PATTERN_ERROR_EMPTY)
+        {
+            TEXT("No steps\n");
+            return 5;
+        }
+        else if (result < 0)
+        {
+            TEXT("Pattern is running\n");
+            return 6;
+        }
+        if (repeats == PATTERN_FOREVER)
+        {
+            /* Plays in the background until 'gpio pattern stop' */
+            return 0;
+        }
+        command_defer(poll_pattern, NULL);
+        return COMMAND_IN_PROGRESS;
+    }
+    TEXT("Call gpio pattern add F 0x0E 0x02 500 to set F1..3 to 0, 1, 0 for 500 us\n");
+    TEXT("Call gpio pattern run 3 to play the steps 3 times (0 for ever)\n");
+    TEXT("Call gpio pattern show, stop or clear to see, stop or empty the steps\n");
+    return 1;
+}
+
+static int poll_pattern(void *p_state, bool cancel)
+{
+    if (cancel)
+    {
+        pattern_stop();
+        return COMMAND_CANCELLED;
+    }
+    return pattern_running() ? COMMAND_IN_PROGRESS : 0;
+}
+
+static int fn_wait(unsigned int argc, char* argv[])
+{
+    static struct wait_state_t state;
+    int result;
+    if ((argc != 3) || ((argv[2][0] != '0') && (argv[2][0] != '1')))
+    {
+        TEXT("Call %s A3 1 to wait for A3 to go high (Ctrl-C to give up)\n", argv[0]);
+        return 1;
+    }
+    result = parse_pin(argv[1], &state.pin);
+    if (result != 0)
+    {
+        return result;
+    }
+    state.level = argv[2][0] - '0';
+    gpio_make_input(state.pin);
+    command_defer(poll_wait, &state);
+    return COMMAND_IN_PROGRESS;
+}
+
+static int poll_wait(void *p_state, bool cancel)
+{
+    const struct wait_state_t *p_wait = p_state;
+    if (cancel)
+    {
+        return COMMAND_CANCELLED;
+    }
+    if (gpio_read_input(p_wait->pin) != p_wait->level)
+    {
+        return COMMAND_IN_PROGRESS;
+    }
+    TEXT("Done\n");
+    return 0;
+}
+
+static int fn_uart(unsigned int argc, char* argv[])
+{
+    bool reset = (argc == 2) && (strcmp(argv[1], "reset") == 0);
+    uart_stats_t stats;
+    uart_baud_info_t info;
+    if ((argc > 2) || ((argc == 2) && !reset))
+    {
+        TEXT("Call %s to show stats, %s reset to clear them\n", argv[0], argv[0]);
+        return 1;
+    }
+    if (uart_get_baud_info(UART_ID_0, &info) == UART_OK)
+    {
+        /* Error is in hundredths of a percent */
+        uint32_t error = (info.error < 0) ? -info.error : info.error;
+        TEXT("Baud rate:  %u (%c%" PRIu32 ".%02" PRIu32 "%%%s)\n",
+               info.actual,
+               (info.error < 0) ? '-' : '+',
+               error / 100, error % 100,
+               info.high_speed ? ", HSE" : "");
+    }
+    uart_get_stats(UART_ID_0, &stats);
+    command_reply_u32(stats.interrupts);
+    command_reply_u32(stats.rx_callbacks);
+    command_reply_u32(stats.rx_bytes);
+    command_reply_u32(stats.rx_dropped);
+    TEXT("Interrupts: %" PRIu32 "\n", stats.interrupts);
+    TEXT("Callbacks:  %" PRIu32 "\n", stats.rx_callbacks);
+    TEXT("RX bytes:   %" PRIu32 "\n", stats.rx_bytes);
+    TEXT("RX dropped: %" PRIu32 "\n", stats.rx_dropped);
+    if (stats.interrupts)
+    {
+        /* In hundredths, as we don't print floats */
+        uint32_t per_irq = (uint32_t) (((uint64_t) stats.rx_bytes * 100) / stats.interrupts);
+        TEXT("Bytes/irq:  %" PRIu32 ".%02" PRIu32 "\n", per_irq / 100, per_irq % 100);
+    }
+    if (reset)
+    {
+        uart_reset_stats(UART_ID_0);
+    }
+    return 0;
+}
+
+static int fn_bench(unsigned int argc, char* argv[])
+{
+    static struct bench_state_t state;
+    bench_result_t result;
+    int id;
+    if ((argc == 2) && (strcmp(argv[1], "list") == 0))
+    {
+        for (unsigned int i = 0; i < bench_count(); i++)
+        {
+            TEXT("%s\n", bench_name(i));
+        }
+        return 0;
+    }
+    if (argc > 3)
+    {
+        TEXT("Call %s to run everything, %s list to see what there is\n", argv[0], argv[0]);
+        TEXT("Call %s frame_crc16 32 to run one 32 times\n", argv[0]);
+        return 1;
+    }
+    state.runs = (argc == 3) ? parse_int(argv[2]) : DEFAULT_BENCH_RUNS;
+    if ((state.runs == 0) || (state.runs > BENCH_MAX_RUNS))
+    {
+        TEXT("Runs must be 1 to %u\n", BENCH_MAX_RUNS);
+        return 2;
+    }
+    TEXT("%-24s %8s %8s %8s (%s)\n", "Name", "Min", "Median", "Max", bench_units());
+    if (argc == 1)
+    {
+        /* One benchmark per pass of the main loop */
+        state.next_id = 0;
+        command_defer(poll_bench, &state);
+        return COMMAND_IN_PROGRESS;
+    }
+    id = bench_find(argv[1]);
+    if (id < 0)
+    {
+        TEXT("No benchmark called %s\n", argv[1]);
+        return 3;
+    }
+    bench_run(id, state.runs, &result);
+    print_bench(id, &result);
+    command_reply_u32(result.min);
+    command_reply_u32(result.median);
+    command_reply_u32(result.max);
+    return 0;
+}
+
+static int poll_bench(void *p_state, bool cancel)
+{
+    struct bench_state_t *p_bench = p_state;
+    bench_result_t result;
+    if (cancel)
+    {
+        return COMMAND_CANCELLED;
+    }
+    if (p_bench->next_id >= bench_count())
+    {
+        return 0;
+    }
+    bench_run(p_bench->next_id, p_bench->runs, &result);
+    print_bench(p_bench->next_id, &result);
+    p_bench->next_id++;
+    return COMMAND_IN_PROGRESS;
+}
+
+static void print_bench(unsigned int id, const bench_result_t *p_result)
+{
+    TEXT("%-24s %8" PRIu32 " %8" PRIu32 " %8" PRIu32 "\n",
+         bench_name(id), p_result->min, p_result->median, p_result->max);
+    fflush(stdout);
+}
+
+static int fn_capture(unsigned int argc, char* argv[])
+{
+    static struct dump_state_t state;
+    capture_config_t config;
+    capture_status_t status;
+    int result;
+
+    if ((argc >= 4) && (strcmp(argv[1], "sample") == 0))
+    {
+        config.mode = CAPTURE_MODE_SAMPLE;
+        config.rate = parse_int(argv[2]);
+        result = parse_channels(argc - 3, argv + 3, &config);
+    }
+    else if ((argc >= 3) && (strcmp(argv[1], "edge") == 0))
+    {
+        config.mode = CAPTURE_MODE_EDGE;
+        config.rate = 0;
+        result = parse_channels(argc - 2, argv + 2, &config);
+    }
+    else if ((argc == 2) && (strcmp(argv[1], "stop") == 0))
+    {
+        capture_stop();
+        return 0;
+    }
+    else if ((argc == 2) && (strcmp(argv[1], "dump") == 0))
+    {
+        const capture_config_t *p_config = capture_get_config();
+        capture_get_status(&status);
+        /* A header line for capturedecode.py, then the records in hex */
+        TEXT("C %" PRIu32, status.tick_rate);
+        for (unsigned int i = 0; i < p_config->num_channels; i++)
+        {
+            TEXT(" %c%02X", 'A' + p_config->channels[i].port, p_config->channels[i].mask);
+        }
+        TEXT("\n");
+        state.offset = 0;
+        command_defer(poll_dump, &state);
+        return COMMAND_IN_PROGRESS;
+    }
+    else if (argc == 1)
+    {
+        capture_get_status(&status);
+        TEXT("%s%s, %" PRIu32 " records in %u bytes, %" PRIu32 " ticks/s\n",
+             status.running ? "Running" : "Stopped",
+             status.full ? " (full)" : "",
+             status.records, (unsigned int) status.bytes, status.tick_rate);
+        command_reply_u32(status.running);
+        command_reply_u32(status.full);
+        command_reply_u32(status.records);
+        command_reply_u32(status.bytes);
+        command_reply_u32(status.tick_rate);
+        return 0;
+    }
+    else
+    {
+        TEXT("Call %s sample 100000 F 0x11 B 0xFF to sample F0, F4 and B0..7 at 100 kHz\n", argv[0]);
+        TEXT("Call %s edge F 0x11 to timestamp edges on F0 and F4\n", argv[0]);
+        TEXT("Call %s stop, then %s dump for capturedecode.py\n", argv[0], argv[0]);
+        TEXT("Call %s to see how it's going\n", argv[0]);
+        return 1;
+    }
+
+    if (result != 0)
+    {
+        return result;
+    }
+    result = capture_start(&config);
+    if (result == CAPTURE_ERROR_INVALID_RATE)
+    {
+        TEXT("Rate must be 1 to %u Hz\n", CAPTURE_MAX_RATE);
+        return 4;
+    }
+    else if (result == CAPTURE_ERROR_NO_INTERRUPTS)
+    {
+        TEXT("Not enough free GPIO interrupt handlers\n");
+        return 6;
+    }
+    else if (result < 0)
+    {
+        TEXT("Already capturing\n");
+        return 5;
+    }
+    return 0;
+}
+
+/*
+ * Parse pairs of port letter and pin mask.
+ *
+ * @return 0, or the capture command's error code
+ */
+static int parse_channels(unsigned int argc, char* argv[], capture_config_t *p_config)
+{
+    if ((argc % 2) || (argc / 2 > CAPTURE_MAX_CHANNELS))
+    {
+        TEXT("Give 1 to %u ports, each with a pin mask\n", CAPTURE_MAX_CHANNELS);
+        return 2;
+    }
+    p_config->num_channels = argc / 2;
+    for (unsigned int i = 0; i < p_config->num_channels; i++)
+    {
+        capture_channel_t *p_channel = &p_config->channels[i];
+        p_channel->port = argv[2 * i][0] - 'A';
+        p_channel->mask = parse_int(argv[(2 * i) + 1]);
+        if ((p_channel->port >= GPIO_NUM_PORTS) || (argv[2 * i][1] != '\0') || (p_channel->mask == 0))
+        {
+            TEXT("Bad port or mask\n");
+            return 3;
+        }
+    }
+    return 0;
+}
+
+static int poll_dump(void *p_state, bool cancel)
+{
+    struct dump_state_t *p_dump = p_state;
+    size_t len;
+    const uint8_t *p_data = capture_get_data(&len);
+    if (cancel)
+    {
+        return COMMAND_CANCELLED;
+    }
+    for (unsigned int line = 0; line < DUMP_LINES_PER_POLL; line++)
+    {
+        size_t end = MIN(len, p_dump->offset + DUMP_LINE_BYTES);
+        if (p_dump->offset >= len)
+        {
+            TEXT("E %u\n", (unsigned int) len);
+            return 0;
+        }
+        TEXT("D ");
+        while (p_dump->offset < end)
+        {
+            TEXT("%02X", p_data[p_dump->offset++]);
+        }
+        TEXT("\n");
+    }
+    return COMMAND_IN_PROGRESS;
+}
+
+static int fn_delay(unsigned int argc, char* argv[])
+{
+    static struct delay_state_t state;
+    uint32_t ms;
+    if (argc != 2)
+    {
+        TEXT("Call %s 100 to wait for 100 ms\n", argv[0]);
+        return 1;
+    }
+    ms = parse_int(argv[1]);
+    if ((ms == 0) || (ms > MAX_DELAY_MS))
+    {
+        TEXT("Delay must be 1 to %u ms\n", MAX_DELAY_MS);
+        return 2;
+    }
+    /* TIMER_0 counts up at CLOCK_RATE (see main.c) */
+    state.ticks = ms * (CLOCK_RATE / 1000UL);
+    state.start = g_batch.have_deadline ? g_batch.deadline : timer_get_value(TIMER_0, TIMER_A);
+    command_defer(poll_delay, &state);
+    return COMMAND_IN_PROGRESS;
+}
+
+static int poll_delay(void *p_state, bool cancel)
+{
+    const struct delay_state_t *p_delay = p_state;
+    if (cancel)
+    {
+        return COMMAND_CANCELLED;
+    }
+    if ((timer_get_value(TIMER_0, TIMER_A) - p_delay->start) < p_delay->ticks)
+    {
+        return COMMAND_IN_PROGRESS;
+    }
+    if (g_batch.depth)
+    {
+        /* The next delay in the batch is timed from here */
+        g_batch.deadline = p_delay->start + p_delay->ticks;
+        g_batch.have_deadline = true;
+    }
+    return 0;
+}
+
+static int fn_loop(unsigned int argc, char* argv[])
+{
+    struct frame_t *p_frame;
+    const char *p;
+    unsigned int nesting = 0;
+    uint32_t repeats;
+    if (argc != 2)
+    {
+        TEXT("Call %s 10; gpio F2 1; delay 100; gpio F2 0; delay 100; endloop\n", argv[0]);
+        return 1;
+    }
+    if ((g_batch.depth == 0) || (g_batch.depth == MAX_NESTING))
+    {
+        TEXT("Loops only work in a batch or script, %u deep\n", MAX_NESTING - 1);
+        return 2;
+    }
+    repeats = parse_int(argv[1]);
+    p_frame = &g_batch.frames[g_batch.depth - 1];
+    /* Find the matching endloop */
+    p = p_frame->p_next;
+    while (p < p_frame->p_end)
+    {
+        const char *p_sep = statement_end(p, p_frame->p_end);
+        if (statement_word(p, p_sep, "loop"))
+        {
+            nesting++;
+        }
+        else if (statement_word(p, p_sep, "endloop"))
+        {
+            if (nesting == 0)
+            {
+                if (blank_statements(p_frame->p_next, p))
+                {
+                    /* It would go round and round without running anything */
+                    TEXT("Empty loop\n");
+                    return 4;
+                }
+                if (repeats)
+                {
+                    struct frame_t *const p_body = &g_batch.frames[g_batch.depth];
+                    p_body->p_start = p_frame->p_next;
+                    p_body->p_next = p_frame->p_next;
+                    p_body->p_end = p;
+                    p_body->repeats = repeats;
+                    g_batch.depth++;
+                }
+                /* Carry on after the endloop once the body is done */
+                p_frame->p_next = (p_sep < p_frame->p_end) ? (p_sep + 1) : p_frame->p_end;
+                return 0;
+            }
+            nesting--;
+        }
+        p = (p_sep < p_frame->p_end) ? (p_sep + 1) : p_frame->p_end;
+    }
+    TEXT("No endloop\n");
+    return 3;
+}
+
+static int fn_endloop(unsigned int argc, char* argv[])
+{
+    /* Matched endloops are never run - loop skips over them */
+    TEXT("endloop without loop\n");
+    return 1;
+}
+
+static int fn_script(unsigned int argc, char* argv[])
+{
+    if ((argc == 2) && ((strcmp(argv[1], "record") == 0) || (strcmp(argv[1], "clear") == 0))
+        && (g_batch.depth > 1))
+    {
+        /* A running script (or one of its loops) still points into g_script */
+        TEXT("Can't change the script from inside a loop or script\n");
+        return 3;
+    }
+    if ((argc == 2) && (strcmp(argv[1], "record") == 0))
+    {
+        TEXT("Type commands, then 'end'\n");
+        g_script_len = 0;
+        g_recording = true;
+        return 0;
+    }
+    else if ((argc == 2) && (strcmp(argv[1], "show") == 0))
+    {
+        TEXT("%.*s", (int) g_script_len, g_script);
+        return 0;
+    }
+    else if ((argc == 2) && (strcmp(argv[1], "clear") == 0))
+    {
+        g_script_len = 0;
+        return 0;
+    }
+    else if (((argc == 2) || (argc == 3)) && (strcmp(argv[1], "run") == 0))
+    {
+        struct frame_t *p_frame;
+        const uint32_t repeats = (argc == 3) ? parse_int(argv[2]) : 1;
+        if ((g_batch.depth == 0) || (g_batch.depth == MAX_NESTING))
+        {
+            /* Can only happen from RPC, or a script running itself */
+            TEXT("Can't run a script from here\n");
+            return 2;
+        }
+        if (g_script_len && repeats)
+        {
+            /* Runs after this statement, then we carry on with the line */
+            p_frame = &g_batch.frames[g_batch.depth];
+            p_frame->p_start = g_script;
+            p_frame->p_next = g_script;
+            p_frame->p_end = g_script + g_script_len;
+            p_frame->repeats = repeats;
+            g_batch.depth++;
+        }
+        return 0;
+    }
+    TEXT("Call %s record, then type commands and 'end'\n", argv[0]);
+    TEXT("Call %s run 10 to run them 10 times\n", argv[0]);
+    return 1;
+}
+
+static int fn_rpc(unsigned int argc, char* argv[])
+{
+    TEXT("Binary mode. Send opcode 0x%02X to come back.\n", COMMAND_RPC_OP_EXIT);
+    fflush(stdout);
+    memset(&g_rpc, 0, sizeof(g_rpc));
+    /* Everything from here, including "Command OK", is quiet */
+    g_rpc.active = true;
+    return 0;
+}
+
+#ifdef CIRCBUFFER_STATS
+
+static int fn_buffers(unsigned int argc, char* argv[])
+{
+    bool reset = (argc == 2) && (strcmp(argv[1], "reset") == 0);
+    struct circbuffer_t *cb = circbuffer_next_registered(NULL);
+    if ((argc > 2) || ((argc == 2) && !reset))
+    {
+        TEXT("Call %s to show stats, %s reset to clear them\n", argv[0], argv[0]);
+        return 1;
+    }
+    TEXT("%-12s %5s %5s %5s %10s %10s\n", "Name", "Size", "Used", "High", "Written", "Dropped");
+    while (cb)
+    {
+        TEXT("%-12s %5u %5u %5u %10" PRIu32 " %10" PRIu32 "\n",
+               cb->p_name,
+               (unsigned int) cb->size,
+               (unsigned int) circbuffer_used(cb),
+               (unsigned int) cb->stats.high_water,
+               cb->stats.written,
+               cb->stats.dropped);
+        if (reset)
+        {
+            circbuffer_stats_reset(cb);
+        }
+        cb = circbuffer_next_registered(cb);
+    }
+    return 0;
+}
+
+#endif /* def CIRCBUFFER_STATS */
+
 /**************************************************
 * End of file
 ***************************************************/
@@ -0,0 +1,90 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Looking commands up by name. See command.h.
+*
+* This is apart from command.c so it can be built (and benchmarked) on
+* the host without the drivers command.c needs.
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+
+#include "command/command.h"
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+/*
+ * Insertion sort. It only runs once, and there aren't that many commands.
+ */
+void command_table_sort(const struct command_table_t *p_table)
+{
+    const struct command_t *const p_commands = p_table->p_commands;
+    uint8_t *const p_sorted = p_table->p_sorted;
+    for (unsigned int i = 0; i < p_table->num_commands; i++)
+    {
+        unsigned int j = i;
+        while ((j > 0) && (strcmp(p_commands[p_sorted[j - 1]].p_command, p_commands[i].p_command) > 0))
+        {
+            p_sorted[j] = p_sorted[j - 1];
+            j--;
+        }
+        p_sorted[j] = i;
+    }
+}
+
+const struct command_t *command_table_find(const struct command_table_t *p_table, const char *p_name)
+{
+    unsigned int low = 0;
+    unsigned int high = p_table->num_commands;
+    while (low < high)
+    {
+        const unsigned int mid = low + ((high - low) / 2);
+        const struct command_t * const p = &p_table->p_commands[p_table->p_sorted[mid]];
+        const int cmp = strcmp(p_name, p->p_command);
+        if (cmp == 0)
+        {
+            return p;
+        }
+        else if (cmp < 0)
+        {
+            high = mid;
+        }
+        else
+        {
+            low = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+/**************************************************
+* End of file
+***************************************************/
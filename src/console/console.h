@@ -0,0 +1,113 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* A text console on the LCD, which shows whatever is written to stdout.
+*
+* console_write() (called from _write() in libc.c) only copies the text
+* in to a buffer, so printing costs the same as it does without the LCD.
+* console_service() draws some of it each time round the main loop, a
+* run of characters at a time.
+*
+* When the text reaches the bottom, the LCD's hardware scroll moves it all
+* up a line; nothing is repainted but the new line. With
+* LCD_ROTATE_DISPLAY the hardware scrolls sideways, which is no use for
+* text, so instead the console wraps back to the top, clearing a line
+* ahead of the cursor so the newest text is easy to find. SConscript
+* leaves the LCD unrotated when it builds the console, so the firmware
+* gets the hardware scroll.
+*
+*****************************************************/
+
+#ifndef CONSOLE_CONSOLE_H
+#define CONSOLE_CONSOLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+
+/**************************************************
+* Public Defines
+***************************************************/
+
+/* Text waiting to be drawn. Anything more is dropped. Must be a power of two. */
+#ifndef CONSOLE_BUFFER_LEN
+#define CONSOLE_BUFFER_LEN 512
+#endif
+
+/* How much console_service() draws per call */
+#ifndef CONSOLE_CHARS_PER_SERVICE
+#define CONSOLE_CHARS_PER_SERVICE 32
+#endif
+
+/**************************************************
+* Public Data Types
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Public Function Prototypes
+***************************************************/
+
+/*
+ * Clears the screen and puts the cursor top left. Call after lcd_init().
+ */
+extern void console_init(void);
+
+/*
+ * Queues text to be drawn. Text written before console_init() is
+ * dropped.
+ *
+ * @return how many bytes were queued
+ */
+extern size_t console_write(const char *p_text, size_t len);
+
+/*
+ * Draws up to CONSOLE_CHARS_PER_SERVICE queued characters. Call this
+ * from the main loop.
+ */
+extern void console_service(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ndef CONSOLE_CONSOLE_H */
+
+/**************************************************
+* End of file
+***************************************************/
+
@@ -0,0 +1,281 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* A text console on the LCD. See console.h.
+*
+* Text row r is drawn at pixel row text_y(r). With hardware scrolling
+* the rows are a ring in the frame buffer, g_top being the one shown at
+* the top of the screen; without it g_top stays 0.
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+#include "circbuffer/circbuffer.h"
+#include "drivers/lcd/lcd.h"
+#include "font/font.h"
+
+#include "console/console.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+#define CONSOLE_FG LCD_WHITE
+#define CONSOLE_BG LCD_BLACK
+
+#define TAB_WIDTH 8
+
+/* Characters drawn with one call to font_draw_text_small() */
+#define MAX_RUN 32
+
+/* See console.h */
+#ifndef LCD_ROTATE_DISPLAY
+#define HARDWARE_SCROLL
+#endif
+
+/**************************************************
+* Data Types
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+static void render(const char *p_text, size_t len);
+static void add_to_run(char c);
+static void flush_run(void);
+static void new_line(void);
+static void clear_row(unsigned int row);
+static lcd_row_t text_y(unsigned int row);
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Private Data
+**************************************************/
+
+static struct circbuffer_t g_cb;
+static uint8_t g_buffer[CONSOLE_BUFFER_LEN];
+
+/* printf works before console_init(), so until then g_cb isn't ready */
+static bool g_ready;
+
+/* Character cell size and screen size in cells */
+static unsigned int g_cell_width;
+static unsigned int g_cell_height;
+static unsigned int g_cols;
+static unsigned int g_rows;
+
+/* Cursor */
+static unsigned int g_col;
+static unsigned int g_row;
+/* First text row on screen */
+static unsigned int g_top;
+
+/* Characters waiting to be drawn from the cursor onwards */
+static char g_run[MAX_RUN + 1];
+static size_t g_run_len;
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+void console_init(void)
+{
+    /* Only the main loop writes (via printf) and reads */
+    circbuffer_init_spsc(&g_cb, g_buffer, NUMELTS(g_buffer));
+#ifdef CIRCBUFFER_STATS
+    circbuffer_register(&g_cb, "lcd console");
+#endif
+
+    font_get_size_small(&g_cell_width, &g_cell_height);
+    g_cols = (1 + LCD_LAST_COLUMN - LCD_FIRST_COLUMN) / g_cell_width;
+    g_rows = (1 + LCD_LAST_ROW - LCD_FIRST_ROW) / g_cell_height;
+    g_col = 0;
+    g_row = 0;
+    g_top = 0;
+    g_run_len = 0;
+
+    lcd_paint_clear_screen();
+#ifdef HARDWARE_SCROLL
+    /* Any rows left over at the bottom stay blank */
+    lcd_set_scroll_area(LCD_FIRST_ROW, LCD_FIRST_ROW + (g_rows * g_cell_height) - 1);
+    lcd_scroll_to(LCD_FIRST_ROW);
+#endif
+
+    g_ready = true;
+}
+
+size_t console_write(const char *p_text, size_t len)
+{
+    if (!g_ready)
+    {
+        return 0;
+    }
+    return circbuffer_write_block(&g_cb, (const uint8_t *) p_text, len);
+}
+
+void console_service(void)
+{
+    size_t len;
+    const uint8_t *p_text;
+    if (!g_ready)
+    {
+        return;
+    }
+    p_text = circbuffer_get_read_span(&g_cb, &len);
+    if (len == 0)
+    {
+        return;
+    }
+    len = MIN(len, CONSOLE_CHARS_PER_SERVICE);
+    render((const char *) p_text, len);
+    circbuffer_consume(&g_cb, len);
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+/*
+ * Handles the control characters command.c sends ("\b \b" to rub out,
+ * "\r\n" or "\n" for a new line) and draws everything else.
+ */
+static void render(const char *p_text, size_t len)
+{
+    while (len--)
+    {
+        const char c = *p_text++;
+        switch (c)
+        {
+        case '\n':
+            flush_run();
+            new_line();
+            break;
+        case '\r':
+            flush_run();
+            g_col = 0;
+            break;
+        case '\b':
+            flush_run();
+            if (g_col > 0)
+            {
+                g_col--;
+            }
+            break;
+        case '\t':
+            do
+            {
+                add_to_run(' ');
+            } while ((g_col + g_run_len) % TAB_WIDTH);
+            break;
+        default:
+            if ((c >= ' ') && (c <= '~'))
+            {
+                add_to_run(c);
+            }
+            /* Ignore other control characters (like the bell) */
+            break;
+        }
+    }
+    flush_run();
+}
+
+static void add_to_run(char c)
+{
+    if (g_col + g_run_len >= g_cols)
+    {
+        /* Wrap long lines */
+        flush_run();
+        new_line();
+    }
+    else if (g_run_len == MAX_RUN)
+    {
+        flush_run();
+    }
+    g_run[g_run_len++] = c;
+}
+
+static void flush_run(void)
+{
+    if (g_run_len == 0)
+    {
+        return;
+    }
+    g_run[g_run_len] = '\0';
+    font_draw_text_small(g_col * g_cell_width, text_y(g_row), g_run, CONSOLE_FG, CONSOLE_BG, true);
+    g_col += g_run_len;
+    g_run_len = 0;
+}
+
+static void new_line(void)
+{
+    g_col = 0;
+#ifdef HARDWARE_SCROLL
+    if (g_row + 1 < g_rows)
+    {
+        /* Still blank from console_init() */
+        g_row++;
+    }
+    else
+    {
+        /* The old top row comes round to the bottom */
+        g_top = (g_top + 1) % g_rows;
+        clear_row(g_row);
+        lcd_scroll_to(LCD_FIRST_ROW + (g_top * g_cell_height));
+    }
+#else
+    /* Already cleared, as the row after the last one */
+    g_row = (g_row + 1) % g_rows;
+    /* Keep a blank line between the newest text and the oldest */
+    clear_row((g_row + 1) % g_rows);
+#endif
+}
+
+static void clear_row(unsigned int row)
+{
+    const lcd_row_t y = text_y(row);
+    lcd_paint_fill_rectangle(CONSOLE_BG,
+        LCD_FIRST_COLUMN, LCD_LAST_COLUMN, y, y + g_cell_height - 1);
+}
+
+static lcd_row_t text_y(unsigned int row)
+{
+    return LCD_FIRST_ROW + (((g_top + row) % g_rows) * g_cell_height);
+}
+
+/**************************************************
+* End of file
+***************************************************/
+
@@ -46,6 +46,8 @@ extern "C" {
 
 /* Macros to pack a port and pin into one value */
 #define GPIO_MAKE_IO_PIN(port, pin)  ( (gpio_io_pin_t) ( ((port) << 8U) | (1U<<(pin)) ) )
+/* Several pins on one port at once, given as a mask of bits 0..7 */
+#define GPIO_MAKE_IO_PINS(port, mask)  ( (gpio_io_pin_t) ( ((port) << 8U) | ((mask) & 0xFFU) ) )
 #define GPIO_GET_PORT(io_pin)  ((io_pin) >> 8U)
 #define GPIO_GET_PIN(io_pin)  ((io_pin) & 0xFFU)
 
@@ -59,7 +61,15 @@ extern "C" {
 #define BUTTON_TWO GPIO_MAKE_IO_PIN(GPIO_PORT_F, 4)
 
 #ifndef GPIO_MAX_INTERRUPT_HANDLERS
-#define GPIO_MAX_INTERRUPT_HANDLERS 2
+#define GPIO_MAX_INTERRUPT_HANDLERS 4
+#endif
+
+/* All GPIO_MAX_INTERRUPT_HANDLERS handlers are in use */
+#define GPIO_ERROR_NO_HANDLERS (-1)
+
+/* Must be a power of two */
+#ifndef GPIO_EVENT_QUEUE_LEN
+#define GPIO_EVENT_QUEUE_LEN 16
 #endif
 
 /**************************************************
@@ -93,6 +103,22 @@ typedef enum gpio_interrupt_mode_t
  */
 typedef void (*gpio_interrupt_handler_t)(gpio_io_pin_t pin, void* p_context, uint32_t n_context);
 
+/*
+ * An interrupt captured for handling later, from the main loop.
+ */
+typedef struct gpio_event_t
+{
+    gpio_io_pin_t pin;
+    /* Level of every pin on the port when the interrupt fired */
+    uint8_t levels;
+} gpio_event_t;
+
+/*
+ * Functions matching this prototype can be registered and called from
+ * gpio_process_events() after an interrupt has fired.
+ */
+typedef void (*gpio_event_handler_t)(const gpio_event_t *p_event, void* p_context, uint32_t n_context);
+
 /**************************************************
 * Public Data
 **************************************************/
@@ -168,6 +194,15 @@ extern void gpio_set_outputs(gpio_port_t port, uint8_t outputs, uint8_t mask);
 #define gpio_set_outputs_porte(outputs, mask) do { GPIO_PORTE_DATA_BITS_R[mask] = outputs; } while(0)
 #define gpio_set_outputs_portf(outputs, mask) do { GPIO_PORTF_DATA_BITS_R[mask] = outputs; } while(0)
 
+/* The masked data registers for a port. Folds to a constant if port is one. */
+#define GPIO_DATA_BITS_R(port) ( \
+    ((port) == GPIO_PORT_A) ? GPIO_PORTA_DATA_BITS_R : \
+    ((port) == GPIO_PORT_B) ? GPIO_PORTB_DATA_BITS_R : \
+    ((port) == GPIO_PORT_C) ? GPIO_PORTC_DATA_BITS_R : \
+    ((port) == GPIO_PORT_D) ? GPIO_PORTD_DATA_BITS_R : \
+    ((port) == GPIO_PORT_E) ? GPIO_PORTE_DATA_BITS_R : \
+    GPIO_PORTF_DATA_BITS_R )
+
 /*
  * If a pin is already an input, read the level. 0 for low, 1 for high.
  */
@@ -179,15 +214,44 @@ extern uint8_t gpio_read_input(gpio_io_pin_t pin);
 extern uint8_t gpio_read_inputs(gpio_port_t port, uint8_t mask);
 
 /*
- * Register an interrupt handler.
+ * Register an interrupt handler. The pin can name several pins on one
+ * port (OR together their GPIO_MAKE_IO_PIN values), in which case the
+ * handler is called once for each of them with an edge.
+ *
+ * @return 0 or an error
  */
-void gpio_register_handler(
+int gpio_register_handler(
     gpio_io_pin_t pin,
     gpio_interrupt_mode_t mode,
     gpio_interrupt_handler_t handler_fn,
     void* p_context,
     uint32_t n_context);
 
+/*
+ * Register a handler which is called from gpio_process_events() rather than
+ * in interrupt context. The interrupt just queues a gpio_event_t.
+ *
+ * @return 0 or an error
+ */
+int gpio_register_deferred_handler(
+    gpio_io_pin_t pin,
+    gpio_interrupt_mode_t mode,
+    gpio_event_handler_t handler_fn,
+    void* p_context,
+    uint32_t n_context);
+
+/*
+ * Disable the interrupt on a pin and remove its handler. Pass the same pin
+ * it was registered with.
+ */
+void gpio_unregister_handler(gpio_io_pin_t pin);
+
+/*
+ * Call the deferred handlers for any queued events. Call this from the main
+ * loop. Returns the number of events handled.
+ */
+unsigned int gpio_process_events(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -35,6 +35,7 @@
 #include "drivers/misc/misc.h"
 #include "drivers/gpio/gpio.h"
 #include "drivers/gpio/gpio_interrupts.h"
+#include "mpscqueue/recordring.h"
 
 /**************************************************
 * Defines
@@ -49,11 +50,22 @@
 typedef struct gpio_interrupt_list_t
 {
     gpio_interrupt_handler_t handler_fn;
+    gpio_event_handler_t event_fn;
     gpio_io_pin_t pin;
     uint32_t n_context;
     void *p_context;
 } gpio_interrupt_list_t;
 
+/* What the interrupt queues for a deferred handler */
+typedef struct gpio_queued_event_t
+{
+    uint8_t handler;
+    uint8_t levels;
+} gpio_queued_event_t;
+
+/* Fed by interrupts at any priority */
+RECORDRING_DEFINE(event_ring, gpio_queued_event_t, GPIO_EVENT_QUEUE_LEN)
+
 typedef struct gpio_registers_t
 {
     reg_t DATA[255]; /* Data - offset sets pin mask */
@@ -103,6 +115,13 @@ typedef struct gpio_registers_t
 
 static void enable_gpio_module(gpio_port_t port);
 static void gpio_interrupt(gpio_port_t port);
+static int register_handler(
+    gpio_io_pin_t pin,
+    gpio_interrupt_mode_t mode,
+    gpio_interrupt_handler_t handler_fn,
+    gpio_event_handler_t event_fn,
+    void *p_context,
+    uint32_t n_context);
 
 
 /**************************************************
@@ -117,6 +136,8 @@ static void gpio_interrupt(gpio_port_t port);
 
 static gpio_interrupt_list_t interrupt_handlers[GPIO_MAX_INTERRUPT_HANDLERS];
 
+static struct event_ring_t event_queue;
+
 static gpio_registers_t *const register_map[GPIO_NUM_PORTS] =
 {
     (gpio_registers_t *) GPIO_PORTA_DATA_BITS_R,
@@ -371,52 +392,81 @@ uint8_t gpio_read_inputs(gpio_port_t port, uint8_t mask)
 /*
  * Register an interrupt handler in an empty slot.
  */
-void gpio_register_handler(
+int gpio_register_handler(
     gpio_io_pin_t pin,
     gpio_interrupt_mode_t mode,
     gpio_interrupt_handler_t handler_fn,
     void *p_context,
     uint32_t n_context)
+{
+    return register_handler(pin, mode, handler_fn, NULL, p_context, n_context);
+}
+
+/*
+ * Register a deferred interrupt handler in an empty slot.
+ */
+int gpio_register_deferred_handler(
+    gpio_io_pin_t pin,
+    gpio_interrupt_mode_t mode,
+    gpio_event_handler_t handler_fn,
+    void *p_context,
+    uint32_t n_context)
+{
+    if (!event_ring_isready(&event_queue))
+    {
+        /* First deferred handler, so set up the queue it will use */
+        event_ring_init(&event_queue);
+    }
+    return register_handler(pin, mode, NULL, handler_fn, p_context, n_context);
+}
+
+/*
+ * Mask the pin's interrupt and free its slot.
+ */
+void gpio_unregister_handler(gpio_io_pin_t pin)
 {
     gpio_port_t port = GPIO_GET_PORT(pin);
     reg_t mask = GPIO_GET_PIN(pin);
-    gpio_registers_t * const p_gpio = register_map[port];
 
     for (unsigned int i = 0; i < NUMELTS(interrupt_handlers); i++)
     {
         gpio_interrupt_list_t *const p = &interrupt_handlers[i];
-        if (!p->handler_fn)
+        if ((p->handler_fn || p->event_fn) && (p->pin == pin))
         {
-            /* Enable the GPIO port interrupt in the NVIC */
-            enable_interrupt(gpio_int_map[port]);
-            p->handler_fn = handler_fn;
-            p->pin = pin;
-            p->p_context = p_context;
-            p->n_context = n_context;
-            /* Detect edges */
-            CLEAR_BITS(p_gpio->IS_R, mask);
-            switch(mode)
-            {
-            case GPIO_INTERRUPT_MODE_RISING:
-                CLEAR_BITS(p_gpio->IBE_R, mask);
-                SET_BITS(p_gpio->IEV_R, mask);
-                break;
-            case GPIO_INTERRUPT_MODE_FALLING:
-                CLEAR_BITS(p_gpio->IBE_R, mask);
-                CLEAR_BITS(p_gpio->IEV_R, mask);
-                break;
-            case GPIO_INTERRUPT_MODE_BOTH:
-                SET_BITS(p_gpio->IBE_R, mask);
-                break;
-            default:
-                gpio_flash_error(LED_RED, LED_GREEN, 500);
-                break;
-            }
-            /* Enable the pin interrupt in the mask register */
-            SET_BITS(p_gpio->IM_R, mask);
-            break;
+            CLEAR_BITS(register_map[port]->IM_R, mask);
+            p->handler_fn = NULL;
+            p->event_fn = NULL;
+            p->pin = 0;
+        }
+    }
+}
+
+/*
+ * Call the deferred handlers for any events the interrupts have queued.
+ */
+unsigned int gpio_process_events(void)
+{
+    unsigned int count = 0;
+    gpio_queued_event_t queued;
+    if (!event_ring_isready(&event_queue))
+    {
+        /* No deferred handlers registered yet */
+        return 0;
+    }
+    while (event_ring_pop(&event_queue, &queued))
+    {
+        const gpio_interrupt_list_t *const p = &interrupt_handlers[queued.handler];
+        if (p->event_fn)
+        {
+            const gpio_event_t event = {
+                .pin = p->pin,
+                .levels = queued.levels
+            };
+            p->event_fn(&event, p->p_context, p->n_context);
         }
+        count++;
     }
+    return count;
 }
 
 void gpioA_interrupt(void)
@@ -453,6 +503,57 @@ void gpioF_interrupt(void)
 * Private Functions
 ***************************************************/
 
+static int register_handler(
+    gpio_io_pin_t pin,
+    gpio_interrupt_mode_t mode,
+    gpio_interrupt_handler_t handler_fn,
+    gpio_event_handler_t event_fn,
+    void *p_context,
+    uint32_t n_context)
+{
+    gpio_port_t port = GPIO_GET_PORT(pin);
+    reg_t mask = GPIO_GET_PIN(pin);
+    gpio_registers_t * const p_gpio = register_map[port];
+
+    for (unsigned int i = 0; i < NUMELTS(interrupt_handlers); i++)
+    {
+        gpio_interrupt_list_t *const p = &interrupt_handlers[i];
+        if (!p->handler_fn && !p->event_fn)
+        {
+            /* Enable the GPIO port interrupt in the NVIC */
+            enable_interrupt(gpio_int_map[port]);
+            p->handler_fn = handler_fn;
+            p->event_fn = event_fn;
+            p->pin = pin;
+            p->p_context = p_context;
+            p->n_context = n_context;
+            /* Detect edges */
+            CLEAR_BITS(p_gpio->IS_R, mask);
+            switch(mode)
+            {
+            case GPIO_INTERRUPT_MODE_RISING:
+                CLEAR_BITS(p_gpio->IBE_R, mask);
+                SET_BITS(p_gpio->IEV_R, mask);
+                break;
+            case GPIO_INTERRUPT_MODE_FALLING:
+                CLEAR_BITS(p_gpio->IBE_R, mask);
+                CLEAR_BITS(p_gpio->IEV_R, mask);
+                break;
+            case GPIO_INTERRUPT_MODE_BOTH:
+                SET_BITS(p_gpio->IBE_R, mask);
+                break;
+            default:
+                gpio_flash_error(LED_RED, LED_GREEN, 500);
+                break;
+            }
+            /* Enable the pin interrupt in the mask register */
+            SET_BITS(p_gpio->IM_R, mask);
+            return 0;
+        }
+    }
+    return GPIO_ERROR_NO_HANDLERS;
+}
+
 static void enable_gpio_module(gpio_port_t port)
 {
     reg_t mask = 1 << port;
@@ -476,6 +577,8 @@ static void gpio_interrupt(gpio_port_t port)
 {
     /* Capture the current enabled & active interrupts */
     uint8_t active_interrupts = register_map[port]->MIS_R;
+    /* And the pin levels, for any deferred handlers */
+    uint8_t levels = register_map[port]->DATA_R;
 
     /* Clear only those interrupts we captured */
     register_map[port]->ICR_R = active_interrupts;
@@ -489,11 +592,24 @@ static void gpio_interrupt(gpio_port_t port)
             for (unsigned int i = 0; i < NUMELTS(interrupt_handlers); i++)
             {
                 const gpio_interrupt_list_t *const p = &interrupt_handlers[i];
-                if (p->handler_fn && (p->pin == GPIO_MAKE_IO_PIN(port, pin)))
+                if ((GPIO_GET_PORT(p->pin) != port) || !(GPIO_GET_PIN(p->pin) & (1 << pin)))
+                {
+                    continue;
+                }
+                if (p->handler_fn)
                 {
                     /* Call registered handler */
                     p->handler_fn(p->pin, p->p_context, p->n_context);
                 }
+                else if (p->event_fn)
+                {
+                    /* Queue it for gpio_process_events(). Dropped if full. */
+                    const gpio_queued_event_t queued = {
+                        .handler = i,
+                        .levels = levels
+                    };
+                    event_ring_push(&event_queue, &queued);
+                }
             }
         }
     }
@@ -51,6 +51,16 @@ extern "C" {
 /* count should also be 0x00..0xFF */
 #define MAKE_RLE_COLOUR(count, r, g, b) ( ((count) << 24) | ((r) << 16) | ((g) << 8) | ((b) << 0) )
 
+/* r, g and b are 0x00..0xFF as above, but only the top 5, 6 and 5 bits are kept */
+#define MAKE_COLOUR565(r, g, b) ( (lcd_colour565_t) ( (((r) & 0xF8) << 8) | (((g) & 0xFC) << 3) | ((b) >> 3) ) )
+
+/* Converts between lcd_colour_t (ignoring any RLE count) and lcd_colour565_t */
+#define LCD_COLOUR_TO_565(c) MAKE_COLOUR565(((c) >> 16) & 0xFF, ((c) >> 8) & 0xFF, (c) & 0xFF)
+#define LCD_565_TO_COLOUR(c) MAKE_COLOUR( \
+    (((c) >> 8) & 0xF8) | (((c) >> 13) & 0x07), \
+    (((c) >> 3) & 0xFC) | (((c) >> 9) & 0x03), \
+    (((c) << 3) & 0xF8) | (((c) >> 2) & 0x07))
+
 /* Colours */
 #define LCD_BLACK       MAKE_COLOUR(0x00, 0x00, 0x00)
 #define LCD_RED         MAKE_COLOUR(0xFF, 0x00, 0x00)
@@ -83,6 +93,14 @@ extern "C" {
 #define LCD_LAST_ROW (LCD_HEIGHT-1)
 #endif
 
+/*
+ * Hardware scrolling moves the panel's lines, of which there are
+ * LCD_HEIGHT. Normally those are rows; with LCD_ROTATE_DISPLAY they're
+ * columns, so the picture scrolls sideways.
+ */
+#define LCD_FIRST_SCROLL_LINE 0
+#define LCD_LAST_SCROLL_LINE (LCD_HEIGHT-1)
+
 /**************************************************
 * Public Data Types
 **************************************************/
@@ -121,6 +139,9 @@ typedef unsigned int lcd_col_t;
 /* Stores NRGB where N is an RLE number of pixels (optional) */
 typedef uint32_t lcd_colour_t;
 
+/* Stores RRRRRGGGGGGBBBBB, which is what goes over a 16-bit bus */
+typedef uint16_t lcd_colour565_t;
+
 struct lcd_mode_t
 {
     bool colour_enhancement;
@@ -204,6 +225,21 @@ struct lcd_address_mode_t
     bool flip_vertical;
 };
 
+#ifdef LCD_BUS_STATS
+/*
+ * Data bus activity, as counted by lcd.c when built with LCD_BUS_STATS.
+ * Every strobe used to need a write, so (strobes - writes) is what the
+ * strobe-only paths save.
+ */
+struct lcd_bus_stats_t
+{
+    /* Values put on the data bus */
+    uint32_t writes;
+    /* WR strobes */
+    uint32_t strobes;
+};
+#endif
+
 /**************************************************
 * Public Data
 **************************************************/
@@ -234,7 +270,19 @@ struct lcd_address_mode_t
  * DATA06 = A6 (J1.09)
  * DATA07 = A7 (J1.10)
  *
- * In the future, I might add 16-bit mode.
+ * If LCD_PINMAP_PORTB is defined, DATA00..DATA07 are B0..B7 instead, so
+ * each byte is one store rather than two. D0 and D1 are linked to B6 and
+ * B7 (see below) so leave them as inputs. The control pins can be moved
+ * by defining LCD_CS, LCD_COMMAND_DATA, LCD_WR and LCD_EN - see lcd.c.
+ *
+ * If LCD_BUS_16BIT is defined, pixels are sent as 16-bit 565 colour, one
+ * WR strobe per pixel instead of three. That needs the top half of the
+ * bus too:
+ *
+ * DATA08..DATA15 = B0..B7
+ *
+ * Note PB6 and PB7 are linked to PD0 and PD1 on the Launchpad by R9 and
+ * R10, which have to be removed. Commands still only use DATA00..07.
  *
  */
 extern int lcd_init(void);
@@ -382,6 +430,25 @@ extern void lcd_paint_colour_rectangle(
     const lcd_colour_t *p_rle_pixels
 );
 
+/**
+ * Paints a full-colour rectangle to the LCD from 565 pixels, which is half
+ * the size of lcd_paint_colour_rectangle()'s format without RLE. With
+ * LCD_BUS_16BIT they go straight on to the bus.
+ *
+ * @param x1 the starting column
+ * @param x2 the end column
+ * @param y1 the starting row
+ * @param y2 the end row
+ * @param p_pixels (x2-x1+1)*(y2-y1+1) pixel values
+ */
+extern void lcd_paint_colour565_rectangle(
+    lcd_col_t x1,
+    lcd_col_t x2,
+    lcd_row_t y1,
+    lcd_row_t y2,
+    const lcd_colour565_t *p_pixels
+);
+
 extern void lcd_read_color_rectangle(
     lcd_col_t x1,
     lcd_col_t x2,
@@ -391,6 +458,31 @@ extern void lcd_read_color_rectangle(
     size_t pixel_len
 );
 
+/**
+ * Sets which lines (see LCD_FIRST_SCROLL_LINE) lcd_scroll_to() moves.
+ * Lines either side stay where they are. Does nothing if the lines are
+ * out of range.
+ *
+ * @param first the first line that scrolls
+ * @param last the last line that scrolls
+ */
+extern void lcd_set_scroll_area(unsigned int first, unsigned int last);
+
+/**
+ * Scrolls the scroll area so the given line of the frame buffer is shown
+ * on its first line. The lines after it follow, wrapping round within the
+ * area. Nothing is repainted. lcd_scroll_to(first) puts everything back.
+ * Does nothing if the line is outside the area last set.
+ *
+ * @param line a line within the scroll area
+ */
+extern void lcd_scroll_to(unsigned int line);
+
+#ifdef LCD_BUS_STATS
+extern void lcd_get_bus_stats(struct lcd_bus_stats_t *p_stats);
+extern void lcd_reset_bus_stats(void);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -30,6 +30,7 @@
 
 #include "drivers/misc/misc.h"
 #include "drivers/gpio/gpio.h"
+#include "log/log.h"
 #include "../lcd.h"
 
 /**************************************************
@@ -39,17 +40,96 @@
 /* Really conservative default */
 #define STROBE_READ_DELAY 100
 
-#define STROBE_WR() \
+/*
+ * Control pins. Any of these can be moved by defining them before this
+ * point (e.g. in SConscript).
+ */
+#ifndef LCD_CS
+#define LCD_CS            GPIO_MAKE_IO_PIN(GPIO_PORT_D, 2)
+#endif
+#ifndef LCD_COMMAND_DATA
+#define LCD_COMMAND_DATA  GPIO_MAKE_IO_PIN(GPIO_PORT_D, 3)
+#endif
+#ifndef LCD_WR
+#define LCD_WR            GPIO_MAKE_IO_PIN(GPIO_PORT_E, 2)
+#endif
+#ifndef LCD_EN
+#define LCD_EN            GPIO_MAKE_IO_PIN(GPIO_PORT_E, 3)
+#endif
+/* We don't use LCD_RST or LCD_RD */
+
+/*
+ * With LCD_BUS_STATS, every value put on the data bus and every WR strobe
+ * is counted (see lcd_get_bus_stats()).
+ */
+#ifdef LCD_BUS_STATS
+#define COUNT_BUS_WRITE() do { g_bus_stats.writes++; } while(0)
+#define COUNT_BUS_STROBE() do { g_bus_stats.strobes++; } while(0)
+#else
+#define COUNT_BUS_WRITE() do { } while(0)
+#define COUNT_BUS_STROBE() do { } while(0)
+#endif
+
+/*
+ * The data bus. By default it's split over ports D and A, so each byte
+ * takes two stores. LCD_PINMAP_PORTB puts it all on port B, for one.
+ */
+#ifdef LCD_PINMAP_PORTB
+
+#ifdef LCD_BUS_16BIT
+#error "LCD_PINMAP_PORTB uses port B for DATA00..07, but LCD_BUS_16BIT needs it for DATA08..15"
+#endif
+
+#define LCD_DATA0         GPIO_MAKE_IO_PIN(GPIO_PORT_B, 0)
+#define LCD_DATA1         GPIO_MAKE_IO_PIN(GPIO_PORT_B, 1)
+#define LCD_DATA2         GPIO_MAKE_IO_PIN(GPIO_PORT_B, 2)
+#define LCD_DATA3         GPIO_MAKE_IO_PIN(GPIO_PORT_B, 3)
+#define LCD_DATA4         GPIO_MAKE_IO_PIN(GPIO_PORT_B, 4)
+#define LCD_DATA5         GPIO_MAKE_IO_PIN(GPIO_PORT_B, 5)
+#define LCD_DATA6         GPIO_MAKE_IO_PIN(GPIO_PORT_B, 6)
+#define LCD_DATA7         GPIO_MAKE_IO_PIN(GPIO_PORT_B, 7)
+
+#define WRITE_BYTE_FAST(b) \
     do { \
-        GPIO_PORTE_DATA_BITS_R[GPIO_GET_PIN(LCD_WR)] = 0x00; \
-        GPIO_PORTE_DATA_BITS_R[GPIO_GET_PIN(LCD_WR)] = \
-            GPIO_GET_PIN(LCD_WR); \
+        GPIO_PORTB_DATA_BITS_R[0xFF] = b; \
+        COUNT_BUS_WRITE(); \
     } while(0)
 
+#define READ_BYTE() gpio_read_inputs(GPIO_PORT_B, 0xFF)
+
+#else
+
+#define LCD_DATA0         GPIO_MAKE_IO_PIN(GPIO_PORT_D, 0)
+#define LCD_DATA1         GPIO_MAKE_IO_PIN(GPIO_PORT_D, 1)
+#define LCD_DATA2         GPIO_MAKE_IO_PIN(GPIO_PORT_A, 2)
+#define LCD_DATA3         GPIO_MAKE_IO_PIN(GPIO_PORT_A, 3)
+#define LCD_DATA4         GPIO_MAKE_IO_PIN(GPIO_PORT_A, 4)
+#define LCD_DATA5         GPIO_MAKE_IO_PIN(GPIO_PORT_A, 5)
+#define LCD_DATA6         GPIO_MAKE_IO_PIN(GPIO_PORT_A, 6)
+#define LCD_DATA7         GPIO_MAKE_IO_PIN(GPIO_PORT_A, 7)
+
 #define WRITE_BYTE_FAST(b) \
     do { \
         GPIO_PORTD_DATA_BITS_R[0x03] = b; \
         GPIO_PORTA_DATA_BITS_R[0xFC] = b; \
+        COUNT_BUS_WRITE(); \
+    } while(0)
+
+#define READ_BYTE() (gpio_read_inputs(GPIO_PORT_D, 0x03) | gpio_read_inputs(GPIO_PORT_A, 0xFC))
+
+#endif /* LCD_PINMAP_PORTB */
+
+#ifdef LCD_BUS_16BIT
+/* DATA08..DATA15, all at once */
+#define LCD_DATA_HIGH     GPIO_MAKE_IO_PINS(GPIO_PORT_B, 0xFF)
+#endif
+
+#define STROBE_WR() \
+    do { \
+        GPIO_DATA_BITS_R(GPIO_GET_PORT(LCD_WR))[GPIO_GET_PIN(LCD_WR)] = 0x00; \
+        GPIO_DATA_BITS_R(GPIO_GET_PORT(LCD_WR))[GPIO_GET_PIN(LCD_WR)] = \
+            GPIO_GET_PIN(LCD_WR); \
+        COUNT_BUS_STROBE(); \
     } while(0)
 
 #define WRITE_PIXEL_RGB(r, g, b) \
@@ -62,6 +142,73 @@
         STROBE_WR(); \
     } while(0)
 
+#define WRITE_WORD_FAST(w) \
+    do { \
+        WRITE_BYTE_FAST(w); \
+        GPIO_PORTB_DATA_BITS_R[0xFF] = (w) >> 8; \
+    } while(0)
+
+/*
+ * The paint functions convert each colour in to a bus_pixel_t once, then
+ * send it with WRITE_PIXEL as many times as they need.
+ */
+/*
+ * A pixel is 'uniform' if it puts the same value on the bus for each of
+ * its strobes. Runs of uniform pixels only need the bus writing once,
+ * then WR strobing (see write_pixels()).
+ */
+#ifdef LCD_BUS_16BIT
+typedef lcd_colour565_t bus_pixel_t;
+#define MAKE_BUS_PIXEL(c) LCD_COLOUR_TO_565(c)
+#define WRITE_PIXEL(p) \
+    do { \
+        WRITE_WORD_FAST(p); \
+        STROBE_WR(); \
+    } while(0)
+#define LCD_PIXEL_WIDTH LCD_PIXEL_WIDTH_16_565
+#define STROBES_PER_PIXEL 1
+#define STROBE_PIXEL() STROBE_WR()
+#define IS_UNIFORM(p) true
+#define WRITE_UNIFORM(p) WRITE_WORD_FAST(p)
+#else
+typedef lcd_colour_t bus_pixel_t;
+#define MAKE_BUS_PIXEL(c) ((c) & 0xFFFFFF)
+/* The data registers ignore the bits above the ones they're masked to */
+#define WRITE_PIXEL(p) WRITE_PIXEL_RGB((p) >> 16, (p) >> 8, (p))
+#define LCD_PIXEL_WIDTH LCD_PIXEL_WIDTH_8
+#define STROBES_PER_PIXEL 3
+#define STROBE_PIXEL() \
+    do { \
+        STROBE_WR(); \
+        STROBE_WR(); \
+        STROBE_WR(); \
+    } while(0)
+/* Greys, including black and white */
+#define IS_UNIFORM(p) ((((p) >> 16) == ((p) & 0xFF)) && ((((p) >> 8) & 0xFF) == ((p) & 0xFF)))
+#define WRITE_UNIFORM(p) WRITE_BYTE_FAST(p)
+#endif
+
+/*
+ * One pixel of a mono rectangle. If both colours are uniform the bus only
+ * needs writing when the colour changes, which for text isn't often.
+ */
+#define WRITE_MONO_PIXEL(set) \
+    do { \
+        if (uniform) \
+        { \
+            if ((set) != last_set) \
+            { \
+                WRITE_UNIFORM((set) ? f_pixel : b_pixel); \
+                last_set = (set); \
+            } \
+            STROBE_PIXEL(); \
+        } \
+        else \
+        { \
+            WRITE_PIXEL((set) ? f_pixel : b_pixel); \
+        } \
+    } while(0)
+
 #define SET_COMMAND()  gpio_set_output(LCD_COMMAND_DATA, 0)
 #define SET_DATA()     gpio_set_output(LCD_COMMAND_DATA, 1)
 
@@ -74,21 +221,6 @@
 #define SET_RST()       gpio_set_output(LCD_RST, 0)
 #define CLEAR_RST()     gpio_set_output(LCD_RST, 1)
 
-#define LCD_CS            GPIO_MAKE_IO_PIN(GPIO_PORT_D, 2)
-#define LCD_COMMAND_DATA  GPIO_MAKE_IO_PIN(GPIO_PORT_D, 3)
-/* If you change LCD_WR, change STROBE_WR too */
-#define LCD_WR            GPIO_MAKE_IO_PIN(GPIO_PORT_E, 2)
-/* We don't use LCD_RST or LCD_RD */
-#define LCD_DATA0         GPIO_MAKE_IO_PIN(GPIO_PORT_D, 0)
-#define LCD_DATA1         GPIO_MAKE_IO_PIN(GPIO_PORT_D, 1)
-#define LCD_DATA2         GPIO_MAKE_IO_PIN(GPIO_PORT_A, 2)
-#define LCD_DATA3         GPIO_MAKE_IO_PIN(GPIO_PORT_A, 3)
-#define LCD_DATA4         GPIO_MAKE_IO_PIN(GPIO_PORT_A, 4)
-#define LCD_DATA5         GPIO_MAKE_IO_PIN(GPIO_PORT_A, 5)
-#define LCD_DATA6         GPIO_MAKE_IO_PIN(GPIO_PORT_A, 6)
-#define LCD_DATA7         GPIO_MAKE_IO_PIN(GPIO_PORT_A, 7)
-
-#define LCD_EN            GPIO_MAKE_IO_PIN(GPIO_PORT_E, 3)
 
 /**************************************************
 * Data Types
@@ -188,9 +320,12 @@ static void send_command(enum ssd1963_cmd_t command);
 static void send_data(uint8_t data);
 #ifdef LCD_RD
 static uint8_t read_data(void);
+static bus_pixel_t read_pixel(void);
 #endif
 static void make_bus_output(void);
 static void make_bus_input(void);
+static void write_pixels(bus_pixel_t pixel, size_t count);
+static RAMFUNC void strobe_repeat(size_t count);
 
 /**************************************************
 * Public Data
@@ -202,7 +337,13 @@ static void make_bus_input(void);
 * Private Data
 **************************************************/
 
-/* None */
+/* What lcd_set_scroll_area() last set; the whole panel after reset */
+static unsigned int g_scroll_first = LCD_FIRST_SCROLL_LINE;
+static unsigned int g_scroll_last = LCD_LAST_SCROLL_LINE;
+
+#ifdef LCD_BUS_STATS
+static struct lcd_bus_stats_t g_bus_stats;
+#endif
 
 /**************************************************
 * Public Functions
@@ -218,11 +359,11 @@ int lcd_init(void)
 {
     /* Turn on LCD */
 
-    PRINTF("Wait...\n");
+    LOG("lcd: wait");
 
     delay_ms(1500);
 
-    PRINTF("LCD init...\n");
+    LOG("lcd: init");
 
     gpio_make_output(LCD_COMMAND_DATA, 1);
     gpio_make_output(LCD_CS, 1);
@@ -235,7 +376,7 @@ int lcd_init(void)
 #endif
     make_bus_output();
 
-    lcd_set_pixel_width(LCD_PIXEL_WIDTH_8);
+    lcd_set_pixel_width(LCD_PIXEL_WIDTH);
 
 #ifdef LCD_ROTATE_DISPLAY
     {
@@ -273,7 +414,7 @@ int lcd_init(void)
 
     lcd_paint_clear_screen();
 
-    PRINTF("Done!\n");
+    LOG("lcd: done");
 
     return 0;
 }
@@ -450,6 +591,49 @@ void lcd_set_backlight(uint8_t brightness)
     do_command(CMD_SET_PWM_CONF, data, NUMELTS(data), NULL, 0);
 }
 
+/**
+ * Sets which lines lcd_scroll_to() moves. The panel scrolls along its
+ * 272 lines whichever way round we've got it (see lcd.h).
+ *
+ * @param first the first line that scrolls
+ * @param last the last line that scrolls
+ */
+void lcd_set_scroll_area(unsigned int first, unsigned int last)
+{
+    uint8_t data[6];
+    if ((first > last) || (last > LCD_LAST_SCROLL_LINE))
+    {
+        return;
+    }
+    /* Top fixed, scrolling and bottom fixed line counts */
+    data[0] = first >> 8;
+    data[1] = first;
+    data[2] = (1 + last - first) >> 8;
+    data[3] = (1 + last - first);
+    data[4] = (LCD_LAST_SCROLL_LINE - last) >> 8;
+    data[5] = (LCD_LAST_SCROLL_LINE - last);
+    do_command(CMD_SET_SCROLL_AREA, data, NUMELTS(data), NULL, 0);
+    g_scroll_first = first;
+    g_scroll_last = last;
+}
+
+/**
+ * Shows the given frame buffer line at the top of the scroll area.
+ *
+ * @param line a line within the scroll area
+ */
+void lcd_scroll_to(unsigned int line)
+{
+    uint8_t data[2];
+    if ((line < g_scroll_first) || (line > g_scroll_last))
+    {
+        return;
+    }
+    data[0] = line >> 8;
+    data[1] = line;
+    do_command(CMD_SET_SCROLL_START, data, NUMELTS(data), NULL, 0);
+}
+
 /**
  * Paints a solid rectangle to the LCD in the given colour.
  *
@@ -468,17 +652,10 @@ void lcd_paint_fill_rectangle(
 )
 {
     size_t size = (1 + x2 - x1) * (1 + y2 - y1);
-    uint8_t r, g, b;
     SET_CS();
     set_region(x1, x2, y1, y2);
     send_command(CMD_WR_MEMSTART);
-    r = (bg >> 16) & 0xFF;    
-    g = (bg >> 8) & 0xFF;    
-    b = (bg >> 0) & 0xFF;    
-    while (size--)
-    {
-        WRITE_PIXEL_RGB(r, g, b);
-    }
+    write_pixels(MAKE_BUS_PIXEL(bg), size);
     CLEAR_CS();
 }
 
@@ -505,18 +682,13 @@ void lcd_paint_mono_rectangle(
 )
 {
     size_t size = (1 + x2 - x1) * (1 + y2 - y1);
-    uint8_t f_r, f_g, f_b;
-    uint8_t b_r, b_g, b_b;
+    const bus_pixel_t f_pixel = MAKE_BUS_PIXEL(fg);
+    const bus_pixel_t b_pixel = MAKE_BUS_PIXEL(bg);
+    const bool uniform = IS_UNIFORM(f_pixel) && IS_UNIFORM(b_pixel);
+    int last_set = -1;
     size_t bytes = size / 8;
     size_t remainder = size - (bytes * 8);
 
-    f_r = (fg >> 16) & 0xFF;
-    f_g = (fg >> 8) & 0xFF;
-    f_b = (fg >> 0) & 0xFF;
-    b_r = (bg >> 16) & 0xFF;
-    b_g = (bg >> 8) & 0xFF;
-    b_b = (bg >> 0) & 0xFF;
-
     SET_CS();
     set_region(x1, x2, y1, y2);
     send_command(CMD_WR_MEMSTART);
@@ -526,14 +698,7 @@ void lcd_paint_mono_rectangle(
         p_pixels++;
         for(uint8_t bit = 0; bit < 8; bit++)
         {
-            if (temp & 0x80)
-            {
-                WRITE_PIXEL_RGB(f_r, f_g, f_b);
-            }
-            else
-            {
-                WRITE_PIXEL_RGB(b_r, b_g, b_b);
-            }
+            WRITE_MONO_PIXEL(temp & 0x80);
             temp <<= 1;
         }
     }
@@ -543,14 +708,7 @@ void lcd_paint_mono_rectangle(
         p_pixels++;
         for(uint8_t bit = 0; bit < remainder; bit++)
         {
-            if (temp & 0x80)
-            {
-                WRITE_PIXEL_RGB(f_r, f_g, f_b);
-            }
-            else
-            {
-                WRITE_PIXEL_RGB(b_r, b_g, b_b);
-            }
+            WRITE_MONO_PIXEL(temp & 0x80);
             temp <<= 1;
         }
     }
@@ -581,21 +739,49 @@ void lcd_paint_colour_rectangle(
     send_command(CMD_WR_MEMSTART);
     while (size)
     {
-        uint32_t pixel = *p_rle_pixels;
-        uint8_t count = (pixel >> 24) & 0xFF;
-        uint8_t r = (pixel >> 16) & 0xFF;
-        uint8_t g = (pixel >> 8) & 0xFF;
-        uint8_t b = (pixel >> 0) & 0xFF;
+        uint32_t rle_pixel = *p_rle_pixels;
+        uint8_t count = (rle_pixel >> 24) & 0xFF;
         size -= count;
-        while (count--)
-        {
-            WRITE_PIXEL_RGB(r,g,b);
-        }
+        write_pixels(MAKE_BUS_PIXEL(rle_pixel), count);
         p_rle_pixels++;
     }
     CLEAR_CS();
 }
 
+/**
+ * Paints a full-colour rectangle to the LCD from 565 pixels.
+ *
+ * @param x1 the starting column
+ * @param x2 the end column
+ * @param y1 the starting row
+ * @param y2 the end row
+ * @param p_pixels (x2-x1+1)*(y2-y1+1) pixel values
+ */
+void lcd_paint_colour565_rectangle(
+    lcd_col_t x1,
+    lcd_col_t x2,
+    lcd_row_t y1,
+    lcd_row_t y2,
+    const lcd_colour565_t *p_pixels
+)
+{
+    size_t size = (1 + x2 - x1) * (1 + y2 - y1);
+    SET_CS();
+    set_region(x1, x2, y1, y2);
+    send_command(CMD_WR_MEMSTART);
+    while (size--)
+    {
+#ifdef LCD_BUS_16BIT
+        WRITE_PIXEL(*p_pixels);
+#else
+        const bus_pixel_t pixel = LCD_565_TO_COLOUR(*p_pixels);
+        WRITE_PIXEL(pixel);
+#endif
+        p_pixels++;
+    }
+    CLEAR_CS();
+}
+
 #ifdef LCD_RD
 void lcd_read_color_rectangle(
     lcd_col_t x1,
@@ -614,21 +800,35 @@ void lcd_read_color_rectangle(
     SET_CS();
     set_region(x1, x2, y1, y2);
     send_command(CMD_RD_MEMSTART);
+    make_bus_input();
     while (size && pixel_len)
     {
-        uint32_t pixel = 0;
-        pixel = read_data() << 16;
-        pixel |= read_data() << 8;
-        pixel |= read_data();
-        *p_pixels = pixel;
+#ifdef LCD_BUS_16BIT
+        *p_pixels = LCD_565_TO_COLOUR(read_pixel());
+#else
+        *p_pixels = read_pixel();
+#endif
         size--;
         pixel_len--;
         p_pixels++;
     }
+    make_bus_output();
     CLEAR_CS();
 }
 #endif
 
+#ifdef LCD_BUS_STATS
+void lcd_get_bus_stats(struct lcd_bus_stats_t *p_stats)
+{
+    *p_stats = g_bus_stats;
+}
+
+void lcd_reset_bus_stats(void)
+{
+    memset(&g_bus_stats, 0, sizeof(g_bus_stats));
+}
+#endif
+
 /**************************************************
 * svate Functions
 ***************************************************/
@@ -725,11 +925,29 @@ static uint8_t read_data(
     uint8_t result = 0;
     SET_RD();
     busy_sleep(STROBE_READ_DELAY);
-    result = gpio_read_inputs(GPIO_PORT_D, 0x03);
-    result |= gpio_read_inputs(GPIO_PORT_A, 0xFC);
+    result = READ_BYTE();
     CLEAR_RD();
     return result;
 }
+
+static bus_pixel_t read_pixel(
+    void
+)
+{
+    bus_pixel_t result = 0;
+#ifdef LCD_BUS_16BIT
+    SET_RD();
+    busy_sleep(STROBE_READ_DELAY);
+    result = READ_BYTE();
+    result |= gpio_read_inputs(GPIO_PORT_B, 0xFF) << 8;
+    CLEAR_RD();
+#else
+    result = read_data() << 16;
+    result |= read_data() << 8;
+    result |= read_data();
+#endif
+    return result;
+}
 #endif
 
 static void make_bus_output(void)
@@ -743,6 +961,54 @@ static void make_bus_output(void)
     gpio_make_output(LCD_DATA5, 1);
     gpio_make_output(LCD_DATA6, 1);
     gpio_make_output(LCD_DATA7, 1);
+#ifdef LCD_BUS_16BIT
+    gpio_make_output(LCD_DATA_HIGH, 1);
+#endif
+}
+
+/*
+ * Sends count copies of a pixel, just strobing WR if the bus value doesn't
+ * change between bytes.
+ */
+static void write_pixels(bus_pixel_t pixel, size_t count)
+{
+    if (IS_UNIFORM(pixel))
+    {
+        WRITE_UNIFORM(pixel);
+        strobe_repeat(count * STROBES_PER_PIXEL);
+    }
+    else
+    {
+        while (count--)
+        {
+            WRITE_PIXEL(pixel);
+        }
+    }
+}
+
+/*
+ * Strobes WR count times, leaving the data bus alone. It runs from SRAM
+ * and is unrolled, so the loop overhead and flash wait states don't
+ * stretch the time between strobes.
+ */
+static RAMFUNC void strobe_repeat(size_t count)
+{
+    while (count >= 8)
+    {
+        STROBE_WR();
+        STROBE_WR();
+        STROBE_WR();
+        STROBE_WR();
+        STROBE_WR();
+        STROBE_WR();
+        STROBE_WR();
+        STROBE_WR();
+        count -= 8;
+    }
+    while (count--)
+    {
+        STROBE_WR();
+    }
 }
 
 static void make_bus_input(void)
@@ -756,6 +1022,9 @@ static void make_bus_input(void)
     gpio_make_input(LCD_DATA5);
     gpio_make_input(LCD_DATA6);
     gpio_make_input(LCD_DATA7);
+#ifdef LCD_BUS_16BIT
+    gpio_make_input(LCD_DATA_HIGH);
+#endif
 }
 
 /**************************************************
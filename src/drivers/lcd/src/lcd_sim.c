@@ -35,13 +35,21 @@
 
 #include <stdio.h>
 #include "util/util.h"
+#include "log/log.h"
 #include "../lcd.h"
 
 /**************************************************
 * Defines
 ***************************************************/
 
-/* None */
+/* Show the colours the panel would, having lost the bits 565 drops */
+#ifdef LCD_BUS_16BIT
+#define BUS_COLOUR(c) LCD_565_TO_COLOUR(LCD_COLOUR_TO_565(c))
+#define LCD_PIXEL_WIDTH LCD_PIXEL_WIDTH_16_565
+#else
+#define BUS_COLOUR(c) ((c) & 0xFFFFFF)
+#define LCD_PIXEL_WIDTH LCD_PIXEL_WIDTH_8
+#endif
 
 /**************************************************
 * Data Types
@@ -65,7 +73,9 @@ extern FILE* f;
 * Private Data
 **************************************************/
 
-/* None */
+/* What lcd_set_scroll_area() last set; the whole panel after reset */
+static unsigned int g_scroll_first = LCD_FIRST_SCROLL_LINE;
+static unsigned int g_scroll_last = LCD_LAST_SCROLL_LINE;
 
 /**************************************************
 * Public Functions
@@ -81,11 +91,11 @@ int lcd_init(void)
 {
     fprintf(f, "reset\n");
 
-    PRINTF("Wait...\n");
+    LOG("lcd: wait");
 
     delay_ms(1500);
 
-    PRINTF("LCD init...\n");
+    LOG("lcd: init");
 
     lcd_paint_clear_screen();
 
@@ -106,7 +116,7 @@ int lcd_init(void)
 
     lcd_paint_clear_screen();
 
-    PRINTF("Done!\n");
+    LOG("lcd: done");
 
     return 0;
 }
@@ -122,7 +132,7 @@ void lcd_deinit(void)
  */
 enum lcd_pixel_width_t lcd_get_pixel_width(void)
 {
-    return LCD_PIXEL_WIDTH_8;
+    return LCD_PIXEL_WIDTH;
 }
 
 /**
@@ -204,6 +214,43 @@ void lcd_set_backlight(uint8_t brightness)
     /* Nothing */
 }
 
+/**
+ * Sets which lines lcd_scroll_to() moves.
+ *
+ * @param first the first line that scrolls
+ * @param last the last line that scrolls
+ */
+void lcd_set_scroll_area(unsigned int first, unsigned int last)
+{
+    if ((first > last) || (last > LCD_LAST_SCROLL_LINE))
+    {
+        return;
+    }
+#ifdef LCD_ROTATE_DISPLAY
+    fprintf(f, "scroll_area columns %u %u\n", first, last);
+#else
+    fprintf(f, "scroll_area rows %u %u\n", first, last);
+#endif
+    fflush(f);
+    g_scroll_first = first;
+    g_scroll_last = last;
+}
+
+/**
+ * Shows the given frame buffer line at the top of the scroll area.
+ *
+ * @param line a line within the scroll area
+ */
+void lcd_scroll_to(unsigned int line)
+{
+    if ((line < g_scroll_first) || (line > g_scroll_last))
+    {
+        return;
+    }
+    fprintf(f, "scroll_to %u\n", line);
+    fflush(f);
+}
+
 /**
  * Paints a solid rectangle to the LCD in the given colour.
  *
@@ -221,7 +268,7 @@ void lcd_paint_fill_rectangle(
     lcd_row_t y2
 )
 {
-    fprintf(f, "box %d %d %d %d 0x%06lx\n", x1, x2, y1, y2, bg);
+    fprintf(f, "box %d %d %d %d 0x%06lx\n", x1, x2, y1, y2, BUS_COLOUR(bg));
     fflush(f);
 }
 
@@ -247,7 +294,7 @@ void lcd_paint_mono_rectangle(
     const uint8_t *p_pixels
 )
 {
-    fprintf(f, "bitmap %d %d %d %d 0x%06lx 0x%06lx ", x1, x2, y1, y2, fg, bg);
+    fprintf(f, "bitmap %d %d %d %d 0x%06lx 0x%06lx ", x1, x2, y1, y2, BUS_COLOUR(fg), BUS_COLOUR(bg));
     size_t size = (1 + x2 - x1) * (1 + y2 - y1);
     size_t bytes = (size + 7) / 8;
     for(size_t i = 0; i < bytes; i++)
@@ -286,7 +333,7 @@ void lcd_paint_colour_rectangle(
         size -= count;
         while (count--)
         {
-            pixel_fn(x, y, pixel & 0xFFFFFF);
+            pixel_fn(x, y, BUS_COLOUR(pixel));
             if (x == x2)
             {
                 x = x1;
@@ -301,6 +348,33 @@ void lcd_paint_colour_rectangle(
     }
 }
 
+/**
+ * Paints a full-colour rectangle to the LCD from 565 pixels.
+ *
+ * @param x1 the starting column
+ * @param x2 the end column
+ * @param y1 the starting row
+ * @param y2 the end row
+ * @param p_pixels (x2-x1+1)*(y2-y1+1) pixel values
+ */
+void lcd_paint_colour565_rectangle(
+    lcd_col_t x1,
+    lcd_col_t x2,
+    lcd_row_t y1,
+    lcd_row_t y2,
+    const lcd_colour565_t *p_pixels
+)
+{
+    for (lcd_row_t y = y1; y <= y2; y++)
+    {
+        for (lcd_col_t x = x1; x <= x2; x++)
+        {
+            pixel_fn(x, y, LCD_565_TO_COLOUR(*p_pixels));
+            p_pixels++;
+        }
+    }
+}
+
 /**************************************************
 * Private Functions
 ***************************************************/
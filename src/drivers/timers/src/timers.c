@@ -40,12 +40,15 @@
 
 #include "drivers/misc/misc.h"
 #include "drivers/timers/timers.h"
+#include "mpscqueue/recordring.h"
 
 /**************************************************
 * Defines
 ***************************************************/
 
-/* None */
+/* The timer_interrupt_t bits belonging to each half of a timer */
+#define TIMER_A_INTERRUPTS 0x001F
+#define TIMER_B_INTERRUPTS 0x0F00
 
 /**************************************************
 * Data Types
@@ -85,10 +88,14 @@ typedef struct timer_registers_t
 typedef struct timer_interrupt_list_t
 {
     timer_interrupt_handler_t handler_fn;
+    timer_event_handler_t event_fn;
     uint32_t n_context;
     void *p_context;
 } timer_interrupt_list_t;
 
+/* Fed by interrupts at any priority */
+RECORDRING_DEFINE(event_ring, timer_event_t, TIMER_EVENT_QUEUE_LEN)
+
 /**************************************************
 * Function Prototypes
 **************************************************/
@@ -107,6 +114,8 @@ static void handle_interrupt(timer_module_t timer, timer_ab_t ab);
 
 static timer_interrupt_list_t interrupt_handlers[TIMER_NUM_TIMERS][2];
 
+static struct event_ring_t event_queue;
+
 static timer_registers_t *const timers[TIMER_NUM_TIMERS] =
 {
     (timer_registers_t *) &TIMER0_CFG_R,
@@ -157,40 +166,40 @@ void timer_configure(timer_module_t timer, const timer_config_t *p_config)
     switch (timer)
     {
     case TIMER_0:
-        SYSCTL_RCGCTIMER_R = SYSCTL_RCGCTIMER_R0;
+        SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R0;
         break;
     case TIMER_1:
-        SYSCTL_RCGCTIMER_R = SYSCTL_RCGCTIMER_R1;
+        SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R1;
         break;
     case TIMER_2:
-        SYSCTL_RCGCTIMER_R = SYSCTL_RCGCTIMER_R2;
+        SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R2;
         break;
     case TIMER_3:
-        SYSCTL_RCGCTIMER_R = SYSCTL_RCGCTIMER_R3;
+        SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R3;
         break;
     case TIMER_4:
-        SYSCTL_RCGCTIMER_R = SYSCTL_RCGCTIMER_R4;
+        SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R4;
         break;
     case TIMER_5:
-        SYSCTL_RCGCTIMER_R = SYSCTL_RCGCTIMER_R5;
+        SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R5;
         break;
     case TIMER_WIDE_0:
-        SYSCTL_RCGCWTIMER_R = SYSCTL_RCGCWTIMER_R0;
+        SYSCTL_RCGCWTIMER_R |= SYSCTL_RCGCWTIMER_R0;
         break;
     case TIMER_WIDE_1:
-        SYSCTL_RCGCWTIMER_R = SYSCTL_RCGCWTIMER_R1;
+        SYSCTL_RCGCWTIMER_R |= SYSCTL_RCGCWTIMER_R1;
         break;
     case TIMER_WIDE_2:
-        SYSCTL_RCGCWTIMER_R = SYSCTL_RCGCWTIMER_R2;
+        SYSCTL_RCGCWTIMER_R |= SYSCTL_RCGCWTIMER_R2;
         break;
     case TIMER_WIDE_3:
-        SYSCTL_RCGCWTIMER_R = SYSCTL_RCGCWTIMER_R3;
+        SYSCTL_RCGCWTIMER_R |= SYSCTL_RCGCWTIMER_R3;
         break;
     case TIMER_WIDE_4:
-        SYSCTL_RCGCWTIMER_R = SYSCTL_RCGCWTIMER_R4;
+        SYSCTL_RCGCWTIMER_R |= SYSCTL_RCGCWTIMER_R4;
         break;
     case TIMER_WIDE_5:
-        SYSCTL_RCGCWTIMER_R = SYSCTL_RCGCWTIMER_R5;
+        SYSCTL_RCGCWTIMER_R |= SYSCTL_RCGCWTIMER_R5;
         break;
     }
 
@@ -464,11 +473,69 @@ void timer_register_handler(
 {
     timer_interrupt_list_t *p = &interrupt_handlers[timer][ab];
     p->handler_fn = handler;
+    p->event_fn = NULL;
     p->p_context = p_context;
     p->n_context = n_context;
     enable_interrupt(timer_int_map[timer][ab]);
 }
 
+/*
+ * Register a function to be called from timer_process_events() after an
+ * interrupt fires. The interrupt itself just clears the interrupt and
+ * queues a timer_event_t, so the handler runs in the main loop.
+ *
+ * @param timer - A timer module (e.g. TIMER_0)
+ * @param ab - Select timer A or timer B.
+ * @param handler - A function to call (from timer_process_events)
+ * @param p_context - A pointer argument supplied to the handler
+ * @param n_context - An integer argument supplied to the handler
+ */
+void timer_register_deferred_handler(
+    timer_module_t timer,
+    timer_ab_t ab,
+    timer_event_handler_t handler,
+    void *p_context, uint32_t n_context)
+{
+    if (!event_ring_isready(&event_queue))
+    {
+        /* First deferred handler, so set up the queue it will use */
+        event_ring_init(&event_queue);
+    }
+    timer_interrupt_list_t *p = &interrupt_handlers[timer][ab];
+    p->handler_fn = NULL;
+    p->event_fn = handler;
+    p->p_context = p_context;
+    p->n_context = n_context;
+    enable_interrupt(timer_int_map[timer][ab]);
+}
+
+/*
+ * Call the deferred handlers for any events the interrupts have queued.
+ * Call this from the main loop.
+ *
+ * @return the number of events handled
+ */
+unsigned int timer_process_events(void)
+{
+    unsigned int count = 0;
+    timer_event_t event;
+    if (!event_ring_isready(&event_queue))
+    {
+        /* No deferred handlers registered yet */
+        return 0;
+    }
+    while (event_ring_pop(&event_queue, &event))
+    {
+        const timer_interrupt_list_t *p = &interrupt_handlers[event.timer][event.ab];
+        if (p->event_fn)
+        {
+            p->event_fn(&event, p->p_context, p->n_context);
+        }
+        count++;
+    }
+    return count;
+}
+
 /*
  * Check if an interrupt event has actually occured.
  *
@@ -904,6 +971,19 @@ static void handle_interrupt(timer_module_t timer, timer_ab_t ab)
     {
         p->handler_fn(timer, ab, p->p_context, p->n_context);
     }
+    else if (p->event_fn)
+    {
+        /* Clear it here, as the handler won't run until later. Dropped if
+         * the queue is full. */
+        timer_registers_t *p_timer = timers[timer];
+        timer_event_t event;
+        event.timer = timer;
+        event.ab = ab;
+        event.status = p_timer->MIS & ((ab == TIMER_A) ? TIMER_A_INTERRUPTS : TIMER_B_INTERRUPTS);
+        p_timer->ICR = event.status;
+        event.value = (ab == TIMER_A) ? p_timer->TAR : p_timer->TBR;
+        event_ring_push(&event_queue, &event);
+    }
 }
 
 /**************************************************
@@ -45,7 +45,10 @@ extern "C" {
 * Public Defines
 ***************************************************/
 
-/* None */
+/* Must be a power of two */
+#ifndef TIMER_EVENT_QUEUE_LEN
+#define TIMER_EVENT_QUEUE_LEN 16
+#endif
 
 /**************************************************
 * Public Data Types
@@ -148,6 +151,26 @@ typedef struct timer_config_t
  */
 typedef void (*timer_interrupt_handler_t)(timer_module_t timer, timer_ab_t ab, void* p_context, uint32_t n_context);
 
+/*
+ * An interrupt captured for handling later, from the main loop. The
+ * interrupt has already been cleared.
+ */
+typedef struct timer_event_t
+{
+    timer_module_t timer;
+    timer_ab_t ab;
+    /* The timer_interrupt_t bits which caused the interrupt */
+    uint32_t status;
+    /* Timer value (or captured time) when the interrupt fired */
+    uint32_t value;
+} timer_event_t;
+
+/*
+ * Functions matching this prototype can be registered and called from
+ * timer_process_events() after an interrupt has fired.
+ */
+typedef void (*timer_event_handler_t)(const timer_event_t *p_event, void* p_context, uint32_t n_context);
+
 /**************************************************
 * Public Data
 **************************************************/
@@ -174,6 +197,14 @@ void timer_register_handler(
     timer_interrupt_handler_t handler,
     void* p_context, uint32_t n_context);
 
+void timer_register_deferred_handler(
+    timer_module_t timer,
+    timer_ab_t ab,
+    timer_event_handler_t handler,
+    void* p_context, uint32_t n_context);
+
+unsigned int timer_process_events(void);
+
 bool timer_interrupt_raw_status(timer_module_t timer, timer_interrupt_t interrupt);
 
 bool timer_interrupt_masked_status(timer_module_t timer, timer_interrupt_t interrupt);
@@ -39,6 +39,9 @@
 
 #include "drivers/misc/misc.h"
 #include "drivers/uart/uart.h"
+#include "drivers/udma/udma.h"
+#include "circbuffer/circbuffer.h"
+#include "log/log.h"
 
 /**************************************************
 * Defines
@@ -51,6 +54,17 @@
 **************************************************/
 
 static void uart_irq(uart_id_t uart_id);
+static int calc_divider(
+    uart_baudrate_t baud_rate,
+    unsigned int tolerance,
+    uint32_t *p_divider,
+    uart_baud_info_t *p_info);
+static void tx_fill_fifo(uart_id_t uart_id);
+static void dma_rx_service(uart_id_t uart_id);
+static void dma_rx_arm(uart_id_t uart_id, unsigned int half);
+static void deliver_fifo(uart_id_t uart_id);
+static void fifo_to_ring(uart_id_t uart_id);
+static bool rx_interrupt_mode(uart_id_t uart_id);
 
 /**************************************************
 * Data Types
@@ -76,6 +90,51 @@ typedef struct uart_register_map_t
     reg_t DMACTL_R;         /* 0x4xxxx048 */
 } uart_register_map_t;
 
+/*
+ * Software transmit buffer. The writer (e.g. the main loop) is the
+ * producer and the TX interrupt is the consumer. The writer masks
+ * UART_IM_TXIM whenever it touches the buffer, which also makes it safe
+ * for the writer to discard data in UART_TX_FULL_OVERWRITE mode.
+ */
+typedef struct uart_tx_t
+{
+    struct circbuffer_t cb;
+    uart_tx_policy_t policy;
+    bool enabled;
+} uart_tx_t;
+
+/*
+ * uDMA channels for each UART. See table 9-1 in [1].
+ */
+typedef struct uart_dma_channels_t
+{
+    uint8_t rx_channel;
+    uint8_t tx_channel;
+    uint8_t encoding;
+} uart_dma_channels_t;
+
+/*
+ * DMA receive state. Half 0 (ping) uses the primary control structure
+ * and half 1 (pong) the alternate.
+ */
+typedef struct uart_dma_rx_t
+{
+    uint8_t *p_buffer[2];
+    size_t buffer_len;
+    size_t delivered[2]; /* bytes of each half given to the callback */
+    bool enabled;
+} uart_dma_rx_t;
+
+/*
+ * DMA transmit state. The primary control structure copies these tasks
+ * in to the alternate one, one at a time. See [1] p595.
+ */
+typedef struct uart_dma_tx_t
+{
+    udma_entry_t tasks[UART_DMA_MAX_TASKS];
+    volatile bool busy;
+} uart_dma_tx_t;
+
 /**************************************************
 * Public Data
 **************************************************/
@@ -113,6 +172,40 @@ static const int uart_int_map[NUM_UARTS] =
 
 static uart_callback_fn_t interrupt_fn_table[NUM_UARTS];
 
+static struct circbuffer_t *rx_rings[NUM_UARTS];
+
+static uart_notify_fn_t rx_notify_fn_table[NUM_UARTS];
+
+static uart_tx_t tx_buffers[NUM_UARTS];
+
+static volatile uart_stats_t stats[NUM_UARTS];
+
+static uart_baud_info_t baud_info[NUM_UARTS];
+
+static const uart_dma_channels_t dma_channels[NUM_UARTS] =
+{
+    {  8,  9, 0 }, // UART 0
+    { 22, 23, 0 }, // UART 1
+    {  0,  1, 1 }, // UART 2
+    { 16, 17, 2 }, // UART 3
+    { 18, 19, 2 }, // UART 4
+    {  6,  7, 2 }, // UART 5
+    { 10, 11, 2 }, // UART 6
+    { 20, 21, 2 }  // UART 7
+};
+
+static uart_dma_rx_t dma_rx[NUM_UARTS];
+
+static uart_dma_tx_t dma_tx[NUM_UARTS];
+
+#ifdef CIRCBUFFER_STATS
+static const char *const tx_buffer_names[NUM_UARTS] =
+{
+    "uart0 tx", "uart1 tx", "uart2 tx", "uart3 tx",
+    "uart4 tx", "uart5 tx", "uart6 tx", "uart7 tx"
+};
+#endif
+
 /**************************************************
 * Public Functions
 ***************************************************/
@@ -131,12 +224,60 @@ int uart_init(
     uart_stopbits_t stopbits,
     uart_callback_fn_t cbfn
     )
+{
+    /* These FIFO settings match the hardware defaults */
+    const uart_config_t config = {
+        .baud_rate = baud_rate,
+        .parity = parity,
+        .databits = databits,
+        .stopbits = stopbits,
+        .cbfn = cbfn,
+        .rx_level = UART_FIFO_4_8,
+        .tx_level = UART_FIFO_4_8,
+        .rx_timeout = true
+    };
+    return uart_configure(uart_id, &config);
+}
+
+/**
+ * Configure a UART.
+ *
+ * @param uart_id   The UART to initialise
+ * @param p_config  Pointer to a UART configuration structure.
+ */
+int uart_configure(
+    uart_id_t uart_id,
+    const uart_config_t *p_config
+    )
 {
     if (uart_id >= NUM_UARTS)
     {
         return UART_ERROR_INVALID_ID;
     }
 
+    if ((p_config->rx_level > UART_FIFO_7_8) || (p_config->tx_level > UART_FIFO_7_8))
+    {
+        return UART_ERROR_INVALID_FIFO_LEVEL;
+    }
+
+    if (p_config->cbfn && p_config->p_rx_ring)
+    {
+        /* It's one or the other */
+        return UART_ERROR_INVALID_BUFFER;
+    }
+
+    uint32_t divider;
+    uart_baud_info_t info;
+    int res = calc_divider(
+                  p_config->baud_rate,
+                  p_config->baud_tolerance ? p_config->baud_tolerance : UART_DEFAULT_BAUD_TOLERANCE,
+                  &divider,
+                  &info);
+    if (res != UART_OK)
+    {
+        return res;
+    }
+
 
     /* See [1] p812 for these steps */
 
@@ -150,20 +291,15 @@ int uart_init(
     /* Disable UART and all features */
     uart_base[uart_id]->CTL_R = 0;
 
-    /* Calculate the baud rate values */
-
-    /* baud_div = CLOCK_RATE / (16 * baud_rate); */
-    /* baud_int = round(baud_div * 64) */
-    uint32_t baud_int = (((CLOCK_RATE * 8) / baud_rate) + 1) / 2;
-
     /* Store the upper and lower parts of the divider */
-    uart_base[uart_id]->IBRD_R = baud_int / 64;
-    uart_base[uart_id]->FBRD_R = baud_int % 64;
+    uart_base[uart_id]->IBRD_R = divider / 64;
+    uart_base[uart_id]->FBRD_R = divider % 64;
+    baud_info[uart_id] = info;
 
     /* Calculate the UART Line Control register value */
     reg_t ctrl = UART_LCRH_FEN;
 
-    switch(parity)
+    switch(p_config->parity)
     {
     case UART_PARITY_EVEN:
         ctrl |= UART_LCRH_EPS;
@@ -178,7 +314,7 @@ int uart_init(
         return UART_ERROR_INVALID_PARITY;
     }
 
-    switch(databits)
+    switch(p_config->databits)
     {
     case UART_DATABITS_5:
         ctrl |= UART_LCRH_WLEN_5;
@@ -196,38 +332,93 @@ int uart_init(
         return UART_ERROR_INVALID_DATABITS;
     }
 
-    if (stopbits == UART_STOPBITS_2)
+    if (p_config->stopbits == UART_STOPBITS_2)
     {
         ctrl |= UART_LCRH_STP2;
     }
 
     uart_base[uart_id]->LCRH_R = ctrl;
 
+    /*
+     * FIFO interrupt trigger levels. The same encoding is used for both
+     * fields. See [1] p837.
+     */
+    uart_base[uart_id]->IFLS_R = ((reg_t) p_config->rx_level << 3) | (reg_t) p_config->tx_level;
+
     /* Clear the flags */
     uart_base[uart_id]->FR_R = 0;
 
     /* Clock source is System clock by default */
 
     /* Set any interrupts */
-    if (cbfn)
+    interrupt_fn_table[uart_id] = p_config->cbfn;
+    rx_rings[uart_id] = p_config->p_rx_ring;
+    rx_notify_fn_table[uart_id] = p_config->p_rx_ring ? p_config->rx_notify : NULL;
+    if (rx_interrupt_mode(uart_id))
     {
-        interrupt_fn_table[uart_id] = cbfn;
-        uart_base[uart_id]->IM_R |= UART_IM_RXIM | UART_IM_RTIM;
+        uart_base[uart_id]->IM_R &= ~(UART_IM_RXIM | UART_IM_RTIM);
+        uart_base[uart_id]->IM_R |= UART_IM_RXIM | (p_config->rx_timeout ? UART_IM_RTIM : 0);
         enable_interrupt(uart_int_map[uart_id]);
     }
     else
     {
-        disable_interrupt(uart_int_map[uart_id]);
+        if (!tx_buffers[uart_id].enabled)
+        {
+            /* Transmit still needs the interrupt if there's a TX buffer */
+            disable_interrupt(uart_int_map[uart_id]);
+        }
         uart_base[uart_id]->IM_R &= ~(UART_IM_RXIM | UART_IM_RTIM);
-        interrupt_fn_table[uart_id] = NULL;
     }
 
     /* Re-enable UART */
-    uart_base[uart_id]->CTL_R |= UART_CTL_RXE | UART_CTL_TXE | UART_CTL_UARTEN;
+    uart_base[uart_id]->CTL_R |= UART_CTL_RXE | UART_CTL_TXE | UART_CTL_UARTEN
+                                 | (info.high_speed ? UART_CTL_HSE : 0);
 
     return UART_OK;
 }
 
+/**
+ * Find out what baud rate uart_configure() actually set.
+ *
+ * @return 0 or an error
+ */
+int uart_get_baud_info(
+    uart_id_t uart_id,
+    uart_baud_info_t *p_info
+    )
+{
+    if (uart_id >= NUM_UARTS)
+    {
+        return UART_ERROR_INVALID_ID;
+    }
+    *p_info = baud_info[uart_id];
+    return UART_OK;
+}
+
+/**
+ * Take a copy of a UART's counters.
+ */
+void uart_get_stats(
+    uart_id_t uart_id,
+    uart_stats_t *p_stats
+    )
+{
+    if (uart_id < NUM_UARTS)
+    {
+        *p_stats = stats[uart_id];
+    }
+}
+
+void uart_reset_stats(
+    uart_id_t uart_id
+    )
+{
+    if (uart_id < NUM_UARTS)
+    {
+        memset((void*) &stats[uart_id], 0, sizeof(stats[uart_id]));
+    }
+}
+
 /**
  * @return the number of bytes read or, if -ve, an error
  */
@@ -242,7 +433,7 @@ ssize_t uart_read(
         return UART_ERROR_INVALID_ID;
     }
 
-    if (interrupt_fn_table[uart_id])
+    if (rx_interrupt_mode(uart_id))
     {
         /* Can't read from a UART when rx interrupts are enabled */
         return UART_ERROR_INTERRUPT_MODE;
@@ -264,9 +455,57 @@ ssize_t uart_read(
     return read;
 }
 
+/**
+ * Give a UART a software transmit buffer (or take it away with NULL).
+ *
+ * @return 0 or an error
+ */
+int uart_set_tx_buffer(
+    uart_id_t uart_id,
+    uint8_t *p_buffer,
+    size_t buffer_len,
+    uart_tx_policy_t policy
+    )
+{
+    if (uart_id >= NUM_UARTS)
+    {
+        return UART_ERROR_INVALID_ID;
+    }
+
+    uart_tx_t *const p_tx = &tx_buffers[uart_id];
+
+    /* Stop the interrupt using the old buffer */
+    uart_base[uart_id]->IM_R &= ~UART_IM_TXIM;
+    p_tx->enabled = false;
+
+    if (p_buffer)
+    {
+        if (!circbuffer_init_spsc(&p_tx->cb, p_buffer, buffer_len))
+        {
+            return UART_ERROR_INVALID_BUFFER;
+        }
+#ifdef CIRCBUFFER_STATS
+        if (!p_tx->cb.p_name)
+        {
+            circbuffer_register(&p_tx->cb, tx_buffer_names[uart_id]);
+        }
+#endif
+        p_tx->policy = policy;
+        p_tx->enabled = true;
+        /* TXIM stays masked until there's something to send */
+        enable_interrupt(uart_int_map[uart_id]);
+    }
+    else if (!rx_interrupt_mode(uart_id))
+    {
+        disable_interrupt(uart_int_map[uart_id]);
+    }
+
+    return UART_OK;
+}
+
 /*
  * This function will block until all the data has
- * been written.
+ * been written, or queued if there is a TX buffer.
  *
  * @return 0 or an error
  */
@@ -281,6 +520,58 @@ int uart_write(
         return UART_ERROR_INVALID_ID;
     }
 
+    if (tx_buffers[uart_id].enabled)
+    {
+        uart_tx_t *const p_tx = &tx_buffers[uart_id];
+        size_t queued = 0;
+        while (queued < buffer_size)
+        {
+            size_t len = buffer_size - queued;
+            /* Keep the interrupt off the buffer while we change it */
+            uart_base[uart_id]->IM_R &= ~UART_IM_TXIM;
+            size_t space = circbuffer_free(&p_tx->cb);
+            if (len > space)
+            {
+                switch (p_tx->policy)
+                {
+                case UART_TX_FULL_OVERWRITE:
+                    /*
+                     * Make room by discarding the oldest unsent data. That
+                     * moves the consumer's index, and the interrupt can
+                     * still run tx_fill_fifo() when a DMA transmit
+                     * finishes, whatever TXIM says, so hold it off in the
+                     * NVIC. It's always enabled while there's a TX buffer.
+                     */
+                    disable_interrupt(uart_int_map[uart_id]);
+                    circbuffer_consume(&p_tx->cb, MIN(len - space, circbuffer_used(&p_tx->cb)));
+                    enable_interrupt(uart_int_map[uart_id]);
+                    break;
+                case UART_TX_FULL_DROP:
+                    /* circbuffer_write_block() drops (and counts) the rest */
+                    break;
+                case UART_TX_FULL_BLOCK:
+                default:
+                    /* Queue what fits now and go round again */
+                    len = space;
+                    break;
+                }
+            }
+            queued += circbuffer_write_block(
+                &p_tx->cb, (const uint8_t*) &buffer[queued], len);
+            /*
+             * This also re-enables the interrupt. If we're blocked on a full
+             * buffer, feeding the FIFO from here means we still make progress
+             * when interrupts are disabled.
+             */
+            tx_fill_fifo(uart_id);
+            if (p_tx->policy == UART_TX_FULL_DROP)
+            {
+                break;
+            }
+        }
+        return UART_OK;
+    }
+
     ssize_t written = 0;
     while(written < buffer_size)
     {
@@ -321,6 +612,17 @@ ssize_t uart_write_nonblock(
         return UART_ERROR_INVALID_ID;
     }
 
+    if (tx_buffers[uart_id].enabled)
+    {
+        struct circbuffer_t *const cb = &tx_buffers[uart_id].cb;
+        size_t queued;
+        uart_base[uart_id]->IM_R &= ~UART_IM_TXIM;
+        queued = circbuffer_write_block(
+            cb, (const uint8_t*) buffer, MIN(buffer_size, circbuffer_free(cb)));
+        tx_fill_fifo(uart_id);
+        return queued;
+    }
+
     ssize_t written = 0;
     while(written < buffer_size)
     {
@@ -337,6 +639,235 @@ ssize_t uart_write_nonblock(
     return written;
 }
 
+/*
+ * @return the number of bytes waiting in the TX buffer or, if -ve,
+ *         an error
+ */
+ssize_t uart_tx_pending(
+    uart_id_t uart_id
+    )
+{
+    if (uart_id >= NUM_UARTS)
+    {
+        return UART_ERROR_INVALID_ID;
+    }
+
+    if (!tx_buffers[uart_id].enabled)
+    {
+        return UART_ERROR_INVALID_BUFFER;
+    }
+
+    return circbuffer_used(&tx_buffers[uart_id].cb);
+}
+
+/*
+ * This function will block until everything written so
+ * far has left the UART.
+ *
+ * @return 0 or an error
+ */
+int uart_flush(
+    uart_id_t uart_id
+    )
+{
+    if (uart_id >= NUM_UARTS)
+    {
+        return UART_ERROR_INVALID_ID;
+    }
+
+    if (tx_buffers[uart_id].enabled)
+    {
+        while (!circbuffer_isempty(&tx_buffers[uart_id].cb))
+        {
+            /* Help the interrupt along, in case interrupts are off */
+            uart_base[uart_id]->IM_R &= ~UART_IM_TXIM;
+            tx_fill_fifo(uart_id);
+        }
+    }
+
+    while (uart_base[uart_id]->FR_R & UART_FR_BUSY)
+    {
+        /* Wait for the shift register to empty */
+    }
+
+    return UART_OK;
+}
+
+/**
+ * Receive by DMA in to two buffers in turn.
+ *
+ * @return 0 or an error
+ */
+int uart_dma_rx_start(
+    uart_id_t uart_id,
+    uint8_t *p_ping,
+    uint8_t *p_pong,
+    size_t buffer_len
+    )
+{
+    if (uart_id >= NUM_UARTS)
+    {
+        return UART_ERROR_INVALID_ID;
+    }
+
+    if (!interrupt_fn_table[uart_id])
+    {
+        /* We need somewhere to deliver the data */
+        return UART_ERROR_INTERRUPT_MODE;
+    }
+
+    if (!p_ping || !p_pong || (buffer_len == 0) || (buffer_len > UDMA_MAX_TRANSFER))
+    {
+        return UART_ERROR_INVALID_BUFFER;
+    }
+
+    uart_register_map_t *const p_uart = uart_base[uart_id];
+    uart_dma_rx_t *const p_rx = &dma_rx[uart_id];
+    const unsigned int channel = dma_channels[uart_id].rx_channel;
+
+    udma_init();
+    udma_disable_channel(channel);
+    udma_assign_channel(channel, dma_channels[uart_id].encoding);
+
+    p_rx->p_buffer[0] = p_ping;
+    p_rx->p_buffer[1] = p_pong;
+    p_rx->buffer_len = buffer_len;
+    dma_rx_arm(uart_id, 0);
+    dma_rx_arm(uart_id, 1);
+    p_rx->enabled = true;
+
+    /*
+     * Only take bursts of 4 when the FIFO is half full (8), so the DMA
+     * never empties the FIFO. What's left raises the receive timeout at
+     * the end of a message, even one that's a whole number of bursts.
+     */
+    p_uart->IFLS_R = (p_uart->IFLS_R & ~UART_IFLS_RX_M) | UART_IFLS_RX4_8;
+    udma_set_burst_only(channel, true);
+    udma_select_primary(channel);
+    udma_enable_channel(channel);
+
+    p_uart->IM_R = (p_uart->IM_R & ~UART_IM_RXIM) | UART_IM_RTIM;
+    p_uart->DMACTL_R |= UART_DMACTL_RXDMAE;
+    enable_interrupt(uart_int_map[uart_id]);
+
+    return UART_OK;
+}
+
+/*
+ * Go back to receiving by interrupt.
+ *
+ * @return 0 or an error
+ */
+int uart_dma_rx_stop(
+    uart_id_t uart_id
+    )
+{
+    if (uart_id >= NUM_UARTS)
+    {
+        return UART_ERROR_INVALID_ID;
+    }
+
+    uart_register_map_t *const p_uart = uart_base[uart_id];
+
+    p_uart->DMACTL_R &= ~UART_DMACTL_RXDMAE;
+    udma_disable_channel(dma_channels[uart_id].rx_channel);
+    dma_rx[uart_id].enabled = false;
+    if (rx_interrupt_mode(uart_id))
+    {
+        p_uart->IM_R |= UART_IM_RXIM | UART_IM_RTIM;
+    }
+
+    return UART_OK;
+}
+
+/**
+ * Send some pieces of data by scatter-gather DMA.
+ *
+ * @return 0 or an error
+ */
+int uart_dma_write(
+    uart_id_t uart_id,
+    const uart_dma_segment_t *p_segments,
+    size_t num_segments
+    )
+{
+    if (uart_id >= NUM_UARTS)
+    {
+        return UART_ERROR_INVALID_ID;
+    }
+
+    uart_register_map_t *const p_uart = uart_base[uart_id];
+    uart_dma_tx_t *const p_tx = &dma_tx[uart_id];
+    const unsigned int channel = dma_channels[uart_id].tx_channel;
+    const uint32_t dr = (uint32_t) (uintptr_t) &p_uart->DR_R;
+    size_t num_tasks = 0;
+
+    if (p_tx->busy ||
+        (tx_buffers[uart_id].enabled && !circbuffer_isempty(&tx_buffers[uart_id].cb)))
+    {
+        return UART_ERROR_BUSY;
+    }
+
+    /* One task per 1024 bytes of each segment */
+    for (size_t i = 0; i < num_segments; i++)
+    {
+        const uint8_t *p_data = p_segments[i].p_data;
+        size_t len = p_segments[i].len;
+        while (len)
+        {
+            const size_t chunk = MIN(len, UDMA_MAX_TRANSFER);
+            if (num_tasks == UART_DMA_MAX_TASKS)
+            {
+                return UART_ERROR_INVALID_BUFFER;
+            }
+            p_tx->tasks[num_tasks].src_end = (uint32_t) (uintptr_t) (p_data + chunk - 1);
+            p_tx->tasks[num_tasks].dst_end = dr;
+            p_tx->tasks[num_tasks].control = udma_make_control(
+                UDMA_INC_NONE, UDMA_INC_8, UDMA_WIDTH_8, UDMA_ARB_4, chunk, UDMA_MODE_ALT_PERIPH_SG);
+            p_data += chunk;
+            len -= chunk;
+            num_tasks++;
+        }
+    }
+
+    if (num_tasks == 0)
+    {
+        return UART_OK;
+    }
+
+    /* The last task stops the channel when it's done */
+    p_tx->tasks[num_tasks - 1].control =
+        (p_tx->tasks[num_tasks - 1].control & ~UDMA_CHCTL_XFERMODE_M) | UDMA_MODE_BASIC;
+
+    udma_init();
+    udma_disable_channel(channel);
+    udma_assign_channel(channel, dma_channels[uart_id].encoding);
+
+    /* The primary structure copies each task (four words) to the alternate */
+    udma_entry_t *const p_primary = udma_primary(channel);
+    p_primary->src_end = (uint32_t) (uintptr_t) &p_tx->tasks[num_tasks - 1].unused;
+    p_primary->dst_end = (uint32_t) (uintptr_t) &udma_alternate(channel)->unused;
+    p_primary->control = udma_make_control(
+        UDMA_INC_32, UDMA_INC_32, UDMA_WIDTH_32, UDMA_ARB_4, num_tasks * 4, UDMA_MODE_PERIPH_SG);
+
+    udma_set_burst_only(channel, false);
+    udma_select_primary(channel);
+    p_tx->busy = true;
+    MEMORY_BARRIER();
+    enable_interrupt(uart_int_map[uart_id]);
+    p_uart->DMACTL_R |= UART_DMACTL_TXDMAE;
+    udma_enable_channel(channel);
+
+    return UART_OK;
+}
+
+bool uart_dma_write_busy(
+    uart_id_t uart_id
+    )
+{
+    return (uart_id < NUM_UARTS) && dma_tx[uart_id].busy;
+}
+
 /* These are in the NVIC table in startup.c */
 void uart0_irq(void)
 {
@@ -383,18 +914,269 @@ void uart7_irq(void)
 ***************************************************/
 
 void uart_irq(uart_id_t uart_id)
+{
+    stats[uart_id].interrupts++;
+    if (dma_rx[uart_id].enabled)
+    {
+        dma_rx_service(uart_id);
+    }
+    else if (rx_rings[uart_id])
+    {
+        fifo_to_ring(uart_id);
+    }
+    else if (interrupt_fn_table[uart_id])
+    {
+        deliver_fifo(uart_id);
+    }
+    if (dma_tx[uart_id].busy && udma_channel_done(dma_channels[uart_id].tx_channel))
+    {
+        udma_clear_done(dma_channels[uart_id].tx_channel);
+        uart_base[uart_id]->DMACTL_R &= ~UART_DMACTL_TXDMAE;
+        dma_tx[uart_id].busy = false;
+        if (tx_buffers[uart_id].enabled)
+        {
+            /* Send anything uart_write() queued in the meantime */
+            tx_fill_fifo(uart_id);
+        }
+    }
+    if (uart_base[uart_id]->MIS_R & UART_MIS_TXMIS)
+    {
+        uart_base[uart_id]->ICR_R = UART_ICR_TXIC;
+        tx_fill_fifo(uart_id);
+    }
+}
+
+/*
+ * Move as much as will fit from the TX buffer to the FIFO. Called from
+ * the interrupt, or with UART_IM_TXIM masked. Leaves UART_IM_TXIM set only
+ * if there's more to send. As we stop when the FIFO is full, the FIFO
+ * level will always cross the TX trigger level again to interrupt us.
+ */
+static void tx_fill_fifo(uart_id_t uart_id)
+{
+    uart_register_map_t *const p_uart = uart_base[uart_id];
+    struct circbuffer_t *const cb = &tx_buffers[uart_id].cb;
+    if (dma_tx[uart_id].busy)
+    {
+        /* The DMA has the FIFO. Its done interrupt will call us again. */
+        p_uart->IM_R &= ~UART_IM_TXIM;
+        return;
+    }
+    while (!circbuffer_isempty(cb) && ((p_uart->FR_R & UART_FR_TXFF) == 0))
+    {
+        p_uart->DR_R = circbuffer_read(cb);
+    }
+    if (circbuffer_isempty(cb))
+    {
+        p_uart->IM_R &= ~UART_IM_TXIM;
+    }
+    else
+    {
+        p_uart->IM_R |= UART_IM_TXIM;
+    }
+}
+
+/*
+ * Work out the baud rate divider, in 64ths. See [1] p817.
+ *
+ * baud_div = CLOCK_RATE / (oversample * baud_rate)
+ * divider = round(baud_div * 64)
+ *
+ * 16x oversampling is used if the integer part would be at least 1,
+ * otherwise 8x (high speed).
+ */
+static int calc_divider(
+    uart_baudrate_t baud_rate,
+    unsigned int tolerance,
+    uint32_t *p_divider,
+    uart_baud_info_t *p_info)
+{
+    uint32_t divider;
+    uint32_t oversample = 16;
+
+    if (baud_rate == 0)
+    {
+        return UART_ERROR_INVALID_BAUDRATE;
+    }
+
+    divider = ((((uint32_t) CLOCK_RATE * 8) / baud_rate) + 1) / 2;
+    if (divider < 64)
+    {
+        oversample = 8;
+        divider = ((((uint32_t) CLOCK_RATE * 16) / baud_rate) + 1) / 2;
+    }
+
+    /* IBRD is 16 bits wide and can't be 0 */
+    if ((divider < 64) || ((divider / 64) > 0xFFFF))
+    {
+        return UART_ERROR_INVALID_BAUDRATE;
+    }
+
+    /* actual = CLOCK_RATE * 64 / (oversample * divider), rounded */
+    const uint32_t scaled_clock = (uint32_t) CLOCK_RATE * (64 / oversample);
+    p_info->actual = (scaled_clock + (divider / 2)) / divider;
+    p_info->error = (int32_t) ((((int64_t) p_info->actual - baud_rate) * 10000) / baud_rate);
+    p_info->high_speed = (oversample == 8);
+
+    if ((p_info->error > (int32_t) tolerance) || (p_info->error < -(int32_t) tolerance))
+    {
+        return UART_ERROR_INVALID_BAUDRATE;
+    }
+
+    *p_divider = divider;
+    return UART_OK;
+}
+
+/*
+ * Read what's in the receive FIFO and give it to the callback.
+ */
+static void deliver_fifo(uart_id_t uart_id)
 {
     char buffer[RX_IRQ_FIFO_SIZE];
     size_t num_chars = 0;
-    if (interrupt_fn_table[uart_id])
+    while ((num_chars < NUMELTS(buffer)) && ((uart_base[uart_id]->FR_R & UART_FR_RXFE) == 0))
+    {
+        buffer[num_chars] = uart_base[uart_id]->DR_R & 0xFF;
+        num_chars++;
+    }
+    if (num_chars)
+    {
+        /* Don't bother the app if we're only here for TX */
+        stats[uart_id].rx_bytes += num_chars;
+        stats[uart_id].rx_callbacks++;
+        interrupt_fn_table[uart_id](uart_id, buffer, num_chars);
+    }
+}
+
+/*
+ * Read what's in the receive FIFO straight in to the RX ring. The only
+ * thing the app hears about it is a notification if the ring was empty.
+ */
+static void fifo_to_ring(uart_id_t uart_id)
+{
+    uart_register_map_t *const p_uart = uart_base[uart_id];
+    struct circbuffer_t *const cb = rx_rings[uart_id];
+    const bool was_empty = circbuffer_isempty(cb);
+    size_t num_chars = 0;
+
+    while ((p_uart->FR_R & UART_FR_RXFE) == 0)
     {
-        while ((num_chars < NUMELTS(buffer)) && ((uart_base[uart_id]->FR_R & UART_FR_RXFE) == 0))
+        size_t space, len = 0;
+        uint8_t *const p_span = circbuffer_get_write_span(cb, &space);
+        if (space == 0)
         {
-            buffer[num_chars] = uart_base[uart_id]->DR_R & 0xFF;
-            num_chars++;
+            /* Empty the FIFO anyway, or we'll be straight back here */
+            const uint8_t c = p_uart->DR_R & 0xFF;
+            /* This just counts the drop in the ring's stats */
+            circbuffer_write_block(cb, &c, 1);
+            stats[uart_id].rx_dropped++;
+            continue;
         }
-        interrupt_fn_table[uart_id](uart_id, buffer, num_chars);
+        while ((len < space) && ((p_uart->FR_R & UART_FR_RXFE) == 0))
+        {
+            p_span[len] = p_uart->DR_R & 0xFF;
+            len++;
+        }
+        circbuffer_commit_write(cb, len);
+        num_chars += len;
     }
+
+    stats[uart_id].rx_bytes += num_chars;
+    if (was_empty && num_chars && rx_notify_fn_table[uart_id])
+    {
+        stats[uart_id].rx_callbacks++;
+        rx_notify_fn_table[uart_id](uart_id);
+    }
+}
+
+/*
+ * @return true if received data is handled by the interrupt
+ */
+static bool rx_interrupt_mode(uart_id_t uart_id)
+{
+    return interrupt_fn_table[uart_id] || rx_rings[uart_id];
+}
+
+/*
+ * Called from the UART interrupt when receiving by DMA. That's either
+ * because the DMA filled a buffer, or because of a receive timeout with
+ * fewer than a burst's worth of bytes left in the FIFO.
+ */
+static void dma_rx_service(uart_id_t uart_id)
+{
+    uart_register_map_t *const p_uart = uart_base[uart_id];
+    uart_dma_rx_t *const p_rx = &dma_rx[uart_id];
+    const unsigned int channel = dma_channels[uart_id].rx_channel;
+    const bool timeout = (p_uart->MIS_R & UART_MIS_RTMIS) != 0;
+
+    if (timeout)
+    {
+        /* Hold the DMA off so the FIFO bytes go out after the DMA bytes */
+        p_uart->DMACTL_R &= ~UART_DMACTL_RXDMAE;
+        p_uart->ICR_R = UART_ICR_RTIC;
+    }
+
+    udma_clear_done(channel);
+
+    /*
+     * The half not in use is the older one, so do that first. If we were
+     * so slow that both halves finished, the DMA switched back to the
+     * older one and stopped there, so that one goes first instead.
+     */
+    const unsigned int active = (UDMA_ALTSET_R >> channel) & 1;
+    const udma_entry_t *const p_active = active ? udma_alternate(channel) : udma_primary(channel);
+    const bool stopped = (p_active->control & UDMA_CHCTL_XFERMODE_M) == UDMA_MODE_STOP;
+    const unsigned int order[2] = { stopped ? active : !active, stopped ? !active : active };
+    if (stopped)
+    {
+        /* Bytes may have been lost from the FIFO while it was stopped */
+        LOG("uart%u rx dma stalled", uart_id);
+    }
+    for (unsigned int i = 0; i < NUMELTS(order); i++)
+    {
+        const unsigned int half = order[i];
+        const udma_entry_t *const p_entry = half ? udma_alternate(channel) : udma_primary(channel);
+        const size_t done = p_rx->buffer_len - udma_remaining(p_entry);
+        if (done > p_rx->delivered[half])
+        {
+            stats[uart_id].rx_bytes += done - p_rx->delivered[half];
+            stats[uart_id].rx_callbacks++;
+            interrupt_fn_table[uart_id](
+                uart_id,
+                (const char*) &p_rx->p_buffer[half][p_rx->delivered[half]],
+                done - p_rx->delivered[half]);
+            p_rx->delivered[half] = done;
+        }
+        if ((p_entry->control & UDMA_CHCTL_XFERMODE_M) == UDMA_MODE_STOP)
+        {
+            /* Finished - ready it for next time round */
+            dma_rx_arm(uart_id, half);
+        }
+    }
+
+    /* If we were too slow, both halves finished and the channel stopped */
+    udma_enable_channel(channel);
+
+    if (timeout)
+    {
+        deliver_fifo(uart_id);
+        p_uart->DMACTL_R |= UART_DMACTL_RXDMAE;
+    }
+}
+
+/*
+ * Set up one half of the ping-pong receive.
+ */
+static void dma_rx_arm(uart_id_t uart_id, unsigned int half)
+{
+    uart_dma_rx_t *const p_rx = &dma_rx[uart_id];
+    const unsigned int channel = dma_channels[uart_id].rx_channel;
+    udma_entry_t *const p_entry = half ? udma_alternate(channel) : udma_primary(channel);
+    p_entry->src_end = (uint32_t) (uintptr_t) &uart_base[uart_id]->DR_R;
+    p_entry->dst_end = (uint32_t) (uintptr_t) &p_rx->p_buffer[half][p_rx->buffer_len - 1];
+    p_entry->control = udma_make_control(
+        UDMA_INC_8, UDMA_INC_NONE, UDMA_WIDTH_8, UDMA_ARB_4, p_rx->buffer_len, UDMA_MODE_PINGPONG);
+    p_rx->delivered[half] = 0;
 }
 
 /**************************************************
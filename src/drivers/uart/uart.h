@@ -51,6 +51,18 @@ extern "C" {
 #define UART_ERROR_INVALID_DATABITS  -5
 #define UART_ERROR_INVALID_STOPPBITS -6
 #define UART_ERROR_INTERRUPT_MODE    -7
+#define UART_ERROR_INVALID_BUFFER    -8
+#define UART_ERROR_BUSY              -9
+#define UART_ERROR_INVALID_FIFO_LEVEL -10
+
+/*
+ * How far the achieved baud rate may be from the one asked for, in
+ * hundredths of a percent, if uart_config_t doesn't say.
+ */
+#define UART_DEFAULT_BAUD_TOLERANCE 200
+
+/* Most pieces a uart_dma_write() can be split in to */
+#define UART_DMA_MAX_TASKS 8
 
 /**************************************************
 * Public Data Types
@@ -92,8 +104,113 @@ typedef enum uart_stopbits_t
 
 typedef unsigned int uart_baudrate_t;
 
+/*
+ * FIFO interrupt trigger levels, in eighths of the 16 byte FIFO.
+ */
+typedef enum uart_fifo_level_t
+{
+    UART_FIFO_1_8,
+    UART_FIFO_2_8,
+    UART_FIFO_4_8,
+    UART_FIFO_6_8,
+    UART_FIFO_7_8
+} uart_fifo_level_t;
+
+/*
+ * What uart_write() does when the software TX buffer is full.
+ */
+typedef enum uart_tx_policy_t
+{
+    UART_TX_FULL_BLOCK,    /* wait for the interrupt to make space    */
+    UART_TX_FULL_DROP,     /* throw away whatever doesn't fit         */
+    UART_TX_FULL_OVERWRITE /* throw away the oldest unsent data       */
+} uart_tx_policy_t;
+
 typedef void (*uart_callback_fn_t)(uart_id_t uart_id, const char* buffer, size_t buffer_size);
 
+/*
+ * Called from interrupt context when a receive ring goes from empty to
+ * not empty.
+ */
+typedef void (*uart_notify_fn_t)(uart_id_t uart_id);
+
+struct circbuffer_t;
+
+typedef struct uart_config_t
+{
+    uart_baudrate_t baud_rate;
+    uart_parity_t parity;
+    uart_databits_t databits;
+    uart_stopbits_t stopbits;
+    /*
+     * Called from interrupt context with the data received. If NULL,
+     * received data can be read with uart_read().
+     */
+    uart_callback_fn_t cbfn;
+    /*
+     * Alternatively (with cbfn NULL), the interrupt puts received data
+     * straight in to this ring, which must be set up with
+     * circbuffer_init_spsc(). Data which doesn't fit is dropped.
+     */
+    struct circbuffer_t *p_rx_ring;
+    /*
+     * Optional. Called from interrupt context when p_rx_ring goes from
+     * empty to not empty, so whoever is reading it knows to look.
+     */
+    uart_notify_fn_t rx_notify;
+    /*
+     * Interrupt when the RX FIFO is at least this full. Higher levels
+     * mean fewer interrupts (and callbacks) on a busy link.
+     */
+    uart_fifo_level_t rx_level;
+    /* Interrupt when the TX FIFO drains to this level (with a TX buffer) */
+    uart_fifo_level_t tx_level;
+    /*
+     * Also interrupt when data has been sitting in the RX FIFO for 32 bit
+     * periods. Without this, fewer than rx_level bytes can be stuck in
+     * the FIFO until more arrive.
+     */
+    bool rx_timeout;
+    /*
+     * Maximum baud rate error, in hundredths of a percent. 0 means
+     * UART_DEFAULT_BAUD_TOLERANCE.
+     */
+    unsigned int baud_tolerance;
+} uart_config_t;
+
+/*
+ * The baud rate actually achieved by the divider.
+ */
+typedef struct uart_baud_info_t
+{
+    uart_baudrate_t actual;
+    /* (actual - requested) / requested, in hundredths of a percent */
+    int32_t error;
+    /* true if 8x oversampling (UART_CTL_HSE) was needed */
+    bool high_speed;
+} uart_baud_info_t;
+
+/*
+ * Counters kept by the interrupt handler. rx_bytes / interrupts shows
+ * how well received data is being coalesced.
+ */
+typedef struct uart_stats_t
+{
+    uint32_t interrupts;    /* times the interrupt handler has run */
+    uint32_t rx_callbacks;  /* times cbfn or rx_notify was called  */
+    uint32_t rx_bytes;      /* bytes received                      */
+    uint32_t rx_dropped;    /* bytes the RX ring had no room for   */
+} uart_stats_t;
+
+/*
+ * One piece of a scatter-gather DMA transmit.
+ */
+typedef struct uart_dma_segment_t
+{
+    const void *p_data;
+    size_t len;
+} uart_dma_segment_t;
+
 /**************************************************
 * Public Data
 **************************************************/
@@ -118,6 +235,42 @@ extern int uart_init(
     uart_callback_fn_t cbfn
     );
 
+/**
+ * As uart_init(), but with control over the FIFO trigger levels and
+ * the baud rate tolerance. Rates above CLOCK_RATE / 16 use 8x
+ * oversampling. Returns UART_ERROR_INVALID_BAUDRATE if the rate can't
+ * be made within tolerance.
+ *
+ * @param uart_id   The UART to initialise
+ * @param p_config  Pointer to a UART configuration structure.
+ */
+extern int uart_configure(
+    uart_id_t uart_id,
+    const uart_config_t *p_config
+    );
+
+/**
+ * Find out what baud rate uart_configure() actually set.
+ *
+ * @return 0 or an error
+ */
+extern int uart_get_baud_info(
+    uart_id_t uart_id,
+    uart_baud_info_t *p_info
+    );
+
+/*
+ * Take a copy of a UART's counters.
+ */
+extern void uart_get_stats(
+    uart_id_t uart_id,
+    uart_stats_t *p_stats
+    );
+
+extern void uart_reset_stats(
+    uart_id_t uart_id
+    );
+
 /**
  * @return the number of bytes written or, if -ve, an error
  */
@@ -127,9 +280,30 @@ extern ssize_t uart_read(
     size_t buffer_size
     );
 
+/**
+ * Give a UART a software transmit buffer. uart_write() and
+ * uart_write_nonblock() then copy in to this buffer and the TX
+ * interrupt feeds the hardware FIFO from it. Pass NULL to go back to
+ * writing the FIFO directly. Any data still in an old buffer is thrown
+ * away, so call uart_flush() first.
+ *
+ * Only one context (e.g. the main loop) may write to a buffered UART.
+ *
+ * @param p_buffer   Storage for the buffer. Must stay valid.
+ * @param buffer_len A power of two, at least 2.
+ * @param policy     What uart_write() does when the buffer is full.
+ */
+extern int uart_set_tx_buffer(
+    uart_id_t uart_id,
+    uint8_t *p_buffer,
+    size_t buffer_len,
+    uart_tx_policy_t policy
+    );
+
 /*
  * This function will block until all the data has
- * been written.
+ * been written (or, with a TX buffer, queued - subject
+ * to the buffer's policy).
  */
 extern int uart_write(
     uart_id_t uart_id,
@@ -156,6 +330,65 @@ extern ssize_t uart_write_nonblock(
     size_t buffer_size
     );
 
+/*
+ * @return the number of bytes waiting in the TX buffer or, if -ve,
+ *         an error (UART_ERROR_INVALID_BUFFER if there isn't one).
+ */
+extern ssize_t uart_tx_pending(
+    uart_id_t uart_id
+    );
+
+/*
+ * This function will block until everything written so
+ * far has left the UART.
+ */
+extern int uart_flush(
+    uart_id_t uart_id
+    );
+
+/**
+ * Receive by DMA in to two buffers in turn. Each time a buffer fills, or
+ * the line goes quiet (the receive timeout), whatever has arrived is
+ * given to the callback passed to uart_init(), from interrupt context.
+ * The callback must have finished with the data before the DMA comes
+ * back round to that buffer.
+ *
+ * @param buffer_len Size of each buffer, 1..1024.
+ */
+extern int uart_dma_rx_start(
+    uart_id_t uart_id,
+    uint8_t *p_ping,
+    uint8_t *p_pong,
+    size_t buffer_len
+    );
+
+/*
+ * Go back to receiving by interrupt. Anything the DMA has received but
+ * not yet delivered is lost.
+ */
+extern int uart_dma_rx_stop(
+    uart_id_t uart_id
+    );
+
+/**
+ * Start sending the given pieces, one after another, by scatter-gather
+ * DMA. Returns immediately. The data must stay valid until
+ * uart_dma_write_busy() returns false. While the DMA is busy, anything
+ * written with uart_write() waits in the TX buffer (if there is one).
+ *
+ * @return 0 or an error. UART_ERROR_BUSY if the last DMA write hasn't
+ *         finished or the TX buffer isn't empty yet.
+ */
+extern int uart_dma_write(
+    uart_id_t uart_id,
+    const uart_dma_segment_t *p_segments,
+    size_t num_segments
+    );
+
+extern bool uart_dma_write_busy(
+    uart_id_t uart_id
+    );
+
 extern void uart0_irq(void);
 extern void uart1_irq(void);
 extern void uart2_irq(void);
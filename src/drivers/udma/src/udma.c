@@ -0,0 +1,228 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* A driver for the micro Direct Memory Access (uDMA) controller.
+*
+* References:
+*
+*     [1] - Stellaris® LM4F121H5QR Microcontroller
+*           Data Sheet.
+*           http://www.ti.com/lit/ds/symlink/lm4f120h5qr.pdf
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+
+#include "drivers/misc/misc.h"
+#include "drivers/udma/udma.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+/* See table 2-9 in [1] */
+#define UDMA_ERROR_INT 47
+
+/* Each CHMAPn register selects the source for 8 channels, 4 bits each */
+#define CHANNELS_PER_CHMAP 8
+
+/**************************************************
+* Data Types
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Private Data
+**************************************************/
+
+/*
+ * The primary structures followed by the alternate structures. The
+ * controller needs this on a 1024 byte boundary. See [1] p585.
+ */
+static udma_entry_t control_table[2 * UDMA_NUM_CHANNELS] __attribute__ ((aligned(1024)));
+
+static reg_t *const chmap[UDMA_NUM_CHANNELS / CHANNELS_PER_CHMAP] =
+{
+    &UDMA_CHMAP0_R,
+    &UDMA_CHMAP1_R,
+    &UDMA_CHMAP2_R,
+    &UDMA_CHMAP3_R
+};
+
+static volatile uint32_t error_count;
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+void udma_init(void)
+{
+    if ((SYSCTL_RCGCDMA_R & SYSCTL_RCGCDMA_R0) && (UDMA_CFG_R & UDMA_CFG_MASTEN))
+    {
+        /* Already done */
+        return;
+    }
+
+    SYSCTL_RCGCDMA_R |= SYSCTL_RCGCDMA_R0;
+    /* Wait for module to settle */
+    while((SYSCTL_PRDMA_R & SYSCTL_PRDMA_R0) == 0)
+    {
+        __asm("");
+    }
+
+    UDMA_CFG_R = UDMA_CFG_MASTEN;
+    UDMA_CTLBASE_R = (uint32_t) (uintptr_t) control_table;
+
+    enable_interrupt(UDMA_ERROR_INT);
+}
+
+void udma_assign_channel(unsigned int channel, unsigned int encoding)
+{
+    reg_t *const p_map = chmap[channel / CHANNELS_PER_CHMAP];
+    const unsigned int shift = (channel % CHANNELS_PER_CHMAP) * 4;
+    *p_map = (*p_map & ~(0xFUL << shift)) | ((uint32_t) encoding << shift);
+}
+
+udma_entry_t *udma_primary(unsigned int channel)
+{
+    return &control_table[channel];
+}
+
+udma_entry_t *udma_alternate(unsigned int channel)
+{
+    return &control_table[UDMA_NUM_CHANNELS + channel];
+}
+
+uint32_t udma_make_control(
+    udma_inc_t dst_inc,
+    udma_inc_t src_inc,
+    udma_width_t width,
+    udma_arb_t arb,
+    size_t count,
+    udma_mode_t mode)
+{
+    return ((uint32_t) dst_inc << 30)
+           | ((uint32_t) width << 28)
+           | ((uint32_t) src_inc << 26)
+           | ((uint32_t) width << 24)
+           | ((uint32_t) arb << 14)
+           | (((uint32_t) (count - 1) << UDMA_CHCTL_XFERSIZE_S) & UDMA_CHCTL_XFERSIZE_M)
+           | (uint32_t) mode;
+}
+
+size_t udma_remaining(const udma_entry_t *p_entry)
+{
+    const uint32_t control = p_entry->control;
+    if ((control & UDMA_CHCTL_XFERMODE_M) == UDMA_MODE_STOP)
+    {
+        return 0;
+    }
+    return ((control & UDMA_CHCTL_XFERSIZE_M) >> UDMA_CHCTL_XFERSIZE_S) + 1;
+}
+
+void udma_set_burst_only(unsigned int channel, bool burst_only)
+{
+    if (burst_only)
+    {
+        UDMA_USEBURSTSET_R = 1UL << channel;
+    }
+    else
+    {
+        UDMA_USEBURSTCLR_R = 1UL << channel;
+    }
+}
+
+void udma_select_primary(unsigned int channel)
+{
+    UDMA_ALTCLR_R = 1UL << channel;
+}
+
+void udma_enable_channel(unsigned int channel)
+{
+    UDMA_ENASET_R = 1UL << channel;
+}
+
+void udma_disable_channel(unsigned int channel)
+{
+    UDMA_ENACLR_R = 1UL << channel;
+}
+
+bool udma_channel_enabled(unsigned int channel)
+{
+    return (UDMA_ENASET_R & (1UL << channel)) != 0;
+}
+
+bool udma_channel_done(unsigned int channel)
+{
+    return (UDMA_CHIS_R & (1UL << channel)) != 0;
+}
+
+void udma_clear_done(unsigned int channel)
+{
+    /* Write one to clear */
+    UDMA_CHIS_R = 1UL << channel;
+}
+
+uint32_t udma_error_count(void)
+{
+    return error_count;
+}
+
+/* In the NVIC table in startup.c */
+void udma_error_irq(void)
+{
+    /*
+     * The controller has already disabled the channel which faulted.
+     * Whoever owns it will notice it has stopped.
+     */
+    UDMA_ERRCLR_R = UDMA_ERRCLR_ERRCLR;
+    error_count++;
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+/* None */
+
+/**************************************************
+* End of file
+***************************************************/
@@ -0,0 +1,206 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* A driver for the micro Direct Memory Access (uDMA) controller.
+*
+* This module owns the channel control table and provides helpers for
+* setting up channel control structures. Peripheral drivers (e.g. the
+* UART driver) use these to move data without the CPU.
+*
+* References:
+*
+*     [1] - Stellaris® LM4F121H5QR Microcontroller
+*           Data Sheet.
+*           http://www.ti.com/lit/ds/symlink/lm4f120h5qr.pdf
+*
+*****************************************************/
+
+#ifndef UDMA_UDMA_H_
+#define UDMA_UDMA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+
+/**************************************************
+* Public Defines
+***************************************************/
+
+#define UDMA_NUM_CHANNELS 32
+
+/* Most items one channel control structure can move. See [1] p587. */
+#define UDMA_MAX_TRANSFER 1024
+
+/**************************************************
+* Public Data Types
+**************************************************/
+
+/*
+ * A channel control structure (or a scatter-gather task, which has the
+ * same layout). See table 9-3 in [1]. The end pointers are the address
+ * of the *last* item, not one past it.
+ */
+typedef struct udma_entry_t
+{
+    volatile uint32_t src_end;
+    volatile uint32_t dst_end;
+    volatile uint32_t control;
+    uint32_t unused;
+} udma_entry_t;
+
+typedef enum udma_mode_t
+{
+    UDMA_MODE_STOP = 0,
+    UDMA_MODE_BASIC = 1,
+    UDMA_MODE_AUTO = 2,
+    UDMA_MODE_PINGPONG = 3,
+    UDMA_MODE_MEM_SG = 4,
+    UDMA_MODE_ALT_MEM_SG = 5,
+    UDMA_MODE_PERIPH_SG = 6,
+    UDMA_MODE_ALT_PERIPH_SG = 7
+} udma_mode_t;
+
+typedef enum udma_width_t
+{
+    UDMA_WIDTH_8 = 0,
+    UDMA_WIDTH_16 = 1,
+    UDMA_WIDTH_32 = 2
+} udma_width_t;
+
+typedef enum udma_inc_t
+{
+    UDMA_INC_8 = 0,
+    UDMA_INC_16 = 1,
+    UDMA_INC_32 = 2,
+    UDMA_INC_NONE = 3
+} udma_inc_t;
+
+/* Transfers per arbitration is 1 << udma_arb_t */
+typedef enum udma_arb_t
+{
+    UDMA_ARB_1 = 0,
+    UDMA_ARB_2 = 1,
+    UDMA_ARB_4 = 2,
+    UDMA_ARB_8 = 3,
+    UDMA_ARB_16 = 4
+} udma_arb_t;
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Public Function Prototypes
+***************************************************/
+
+/**
+ * Enable the uDMA controller and point it at our control table. Safe to
+ * call more than once.
+ */
+extern void udma_init(void);
+
+/**
+ * Select which peripheral drives a channel. See table 9-1 in [1].
+ *
+ * @param channel  0..31
+ * @param encoding 0..4
+ */
+extern void udma_assign_channel(unsigned int channel, unsigned int encoding);
+
+/**
+ * @return the primary control structure for a channel.
+ */
+extern udma_entry_t *udma_primary(unsigned int channel);
+
+/**
+ * @return the alternate control structure for a channel.
+ */
+extern udma_entry_t *udma_alternate(unsigned int channel);
+
+/**
+ * Build a control word.
+ *
+ * @param count Number of items to move, 1..UDMA_MAX_TRANSFER.
+ */
+extern uint32_t udma_make_control(
+    udma_inc_t dst_inc,
+    udma_inc_t src_inc,
+    udma_width_t width,
+    udma_arb_t arb,
+    size_t count,
+    udma_mode_t mode);
+
+/**
+ * @return the number of items the structure has still to move.
+ */
+extern size_t udma_remaining(const udma_entry_t *p_entry);
+
+/**
+ * Only respond to burst requests (e.g. the FIFO level trigger) on this
+ * channel, rather than single requests.
+ */
+extern void udma_set_burst_only(unsigned int channel, bool burst_only);
+
+/**
+ * Start using the primary control structure when next enabled.
+ */
+extern void udma_select_primary(unsigned int channel);
+
+extern void udma_enable_channel(unsigned int channel);
+extern void udma_disable_channel(unsigned int channel);
+extern bool udma_channel_enabled(unsigned int channel);
+
+/**
+ * Completion of a peripheral channel interrupts on the peripheral's
+ * vector. The peripheral's interrupt handler uses these to see which
+ * of its channels finished.
+ */
+extern bool udma_channel_done(unsigned int channel);
+extern void udma_clear_done(unsigned int channel);
+
+/**
+ * @return the number of bus errors seen since reset.
+ */
+extern uint32_t udma_error_count(void);
+
+/* In the NVIC table in startup.c */
+extern void udma_error_irq(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ndef UDMA_UDMA_H_ */
+
+/**************************************************
+* End of file
+***************************************************/
@@ -84,6 +84,12 @@ size_t font_draw_text_small_len(
 
 void font_glyph_width_small(char x);
 
+/*
+ * The cell size of the small font, which is what each character takes up
+ * when it's drawn monospace.
+ */
+void font_get_size_small(unsigned int *p_width, unsigned int *p_height);
+
 #ifdef __cplusplus
 }
 #endif
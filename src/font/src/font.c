@@ -173,6 +173,12 @@ size_t font_draw_text_small_len(
     return result;
 }
 
+void font_get_size_small(unsigned int *p_width, unsigned int *p_height)
+{
+    *p_width = DEFAULT_FONT[GLYPH_WIDTH_INDEX];
+    *p_height = DEFAULT_FONT[GLYPH_HEIGHT_INDEX];
+}
+
 void font_glyph_width_small(char x)
 {
     unsigned int glyph_width = DEFAULT_FONT[GLYPH_WIDTH_INDEX];
@@ -0,0 +1,167 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Binary framing for serial links.
+*
+* Each frame carries a channel ID, a payload and a CRC-16, and is COBS
+* encoded so the only zero byte on the wire is the delimiter at the end
+* of each frame:
+*
+*   COBS(channel, payload..., crc_hi, crc_lo), 0x00
+*
+* The CRC is CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) over the
+* channel and payload. A receiver that starts mid-stream, or sees a bad
+* byte, recovers at the next zero.
+*
+* The encoder and decoder both work incrementally, so payloads can be
+* sent in pieces and received a byte at a time from an RX callback.
+*
+*****************************************************/
+
+#ifndef FRAME_FRAME_H
+#define FRAME_FRAME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+
+/**************************************************
+* Public Defines
+***************************************************/
+
+#define FRAME_DELIMITER 0x00
+
+/* Longest run COBS can encode with one code byte */
+#define FRAME_COBS_BLOCK 254
+
+/* Channel and CRC bytes added to every payload */
+#define FRAME_OVERHEAD 3
+
+/*
+ * Worst case encoded size of a payload, including the delimiter.
+ */
+#define FRAME_MAX_ENCODED(len) \
+    ((len) + FRAME_OVERHEAD + (((len) + FRAME_OVERHEAD) / FRAME_COBS_BLOCK) + 2)
+
+/**************************************************
+* Public Data Types
+**************************************************/
+
+/*
+ * Called by the encoder with encoded bytes to send.
+ */
+typedef void (*frame_output_fn_t)(const uint8_t *p_data, size_t len, void *p_context);
+
+/*
+ * Called by the decoder with each good frame.
+ */
+typedef void (*frame_handler_fn_t)(uint8_t channel, const uint8_t *p_payload, size_t len, void *p_context);
+
+struct frame_encoder_t
+{
+    /* Code byte followed by the run of non-zero bytes it describes */
+    uint8_t block[1 + FRAME_COBS_BLOCK];
+    size_t block_len;
+    uint16_t crc;
+    frame_output_fn_t output_fn;
+    void *p_context;
+};
+
+struct frame_decoder_t
+{
+    uint8_t *p_buffer;      /* decoded channel, payload and CRC     */
+    size_t buffer_size;
+    size_t len;
+    uint8_t remaining;      /* bytes left in this COBS block        */
+    bool zero_pending;      /* a zero goes before the next block    */
+    bool discard;           /* frame is bad, skip to next delimiter */
+    frame_handler_fn_t handler_fn;
+    void *p_context;
+    /* Statistics */
+    uint32_t good;
+    uint32_t bad_crc;
+    uint32_t bad_frame;     /* too long, too short or malformed     */
+};
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Public Function Prototypes
+***************************************************/
+
+void frame_encoder_init(struct frame_encoder_t *p_enc, frame_output_fn_t output_fn, void *p_context);
+
+/*
+ * Start a frame on the given channel. Follow with any number of
+ * frame_encoder_add() calls, then frame_encoder_finish().
+ */
+void frame_encoder_start(struct frame_encoder_t *p_enc, uint8_t channel);
+void frame_encoder_add(struct frame_encoder_t *p_enc, const uint8_t *p_data, size_t len);
+void frame_encoder_finish(struct frame_encoder_t *p_enc);
+
+/*
+ * Send a whole frame in one go.
+ */
+void frame_encoder_send(struct frame_encoder_t *p_enc, uint8_t channel, const uint8_t *p_data, size_t len);
+
+/*
+ * p_buffer must hold the largest payload expected plus FRAME_OVERHEAD.
+ */
+void frame_decoder_init(
+    struct frame_decoder_t *p_dec,
+    uint8_t *p_buffer,
+    size_t buffer_size,
+    frame_handler_fn_t handler_fn,
+    void *p_context);
+
+/*
+ * Feed received bytes to the decoder. The handler is called (from here)
+ * for each good frame.
+ */
+void frame_decoder_feed(struct frame_decoder_t *p_dec, const uint8_t *p_data, size_t len);
+
+/*
+ * CRC-16/CCITT-FALSE. Start with crc = 0xFFFF.
+ */
+uint16_t frame_crc16(uint16_t crc, const uint8_t *p_data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ndef FRAME_FRAME_H */
+
+/**************************************************
+* End of file
+***************************************************/
@@ -0,0 +1,297 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Binary framing for serial links. See frame.h.
+*
+* COBS is described in "Consistent Overhead Byte Stuffing", Cheshire &
+* Baker, IEEE/ACM Transactions on Networking, 1999.
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+
+#include "frame/frame.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+#define CRC_INIT 0xFFFF
+
+/* A full block has no implied zero after it */
+#define FULL_BLOCK_CODE (FRAME_COBS_BLOCK + 1)
+
+/**************************************************
+* Data Types
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+static void encode_byte(struct frame_encoder_t *p_enc, uint8_t byte);
+static void flush_block(struct frame_encoder_t *p_enc);
+static void decode_end_of_frame(struct frame_decoder_t *p_dec);
+static void decode_append(struct frame_decoder_t *p_dec, uint8_t byte);
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Private Data
+**************************************************/
+
+/* CRC-16/CCITT-FALSE, one byte at a time */
+static const uint16_t crc_table[256] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+void frame_encoder_init(struct frame_encoder_t *p_enc, frame_output_fn_t output_fn, void *p_context)
+{
+    p_enc->block_len = 0;
+    p_enc->crc = CRC_INIT;
+    p_enc->output_fn = output_fn;
+    p_enc->p_context = p_context;
+}
+
+void frame_encoder_start(struct frame_encoder_t *p_enc, uint8_t channel)
+{
+    p_enc->block_len = 0;
+    p_enc->crc = CRC_INIT;
+    frame_encoder_add(p_enc, &channel, 1);
+}
+
+void frame_encoder_add(struct frame_encoder_t *p_enc, const uint8_t *p_data, size_t len)
+{
+    p_enc->crc = frame_crc16(p_enc->crc, p_data, len);
+    while (len--)
+    {
+        encode_byte(p_enc, *p_data++);
+    }
+}
+
+void frame_encoder_finish(struct frame_encoder_t *p_enc)
+{
+    static const uint8_t delimiter = FRAME_DELIMITER;
+    const uint16_t crc = p_enc->crc;
+    encode_byte(p_enc, (uint8_t) (crc >> 8));
+    encode_byte(p_enc, (uint8_t) crc);
+    /* The last block has no zero after it, just the delimiter */
+    flush_block(p_enc);
+    p_enc->output_fn(&delimiter, 1, p_enc->p_context);
+}
+
+void frame_encoder_send(struct frame_encoder_t *p_enc, uint8_t channel, const uint8_t *p_data, size_t len)
+{
+    frame_encoder_start(p_enc, channel);
+    frame_encoder_add(p_enc, p_data, len);
+    frame_encoder_finish(p_enc);
+}
+
+void frame_decoder_init(
+    struct frame_decoder_t *p_dec,
+    uint8_t *p_buffer,
+    size_t buffer_size,
+    frame_handler_fn_t handler_fn,
+    void *p_context)
+{
+    p_dec->p_buffer = p_buffer;
+    p_dec->buffer_size = buffer_size;
+    p_dec->len = 0;
+    p_dec->remaining = 0;
+    p_dec->zero_pending = false;
+    p_dec->discard = false;
+    p_dec->handler_fn = handler_fn;
+    p_dec->p_context = p_context;
+    p_dec->good = 0;
+    p_dec->bad_crc = 0;
+    p_dec->bad_frame = 0;
+}
+
+void frame_decoder_feed(struct frame_decoder_t *p_dec, const uint8_t *p_data, size_t len)
+{
+    while (len--)
+    {
+        const uint8_t byte = *p_data++;
+        if (byte == FRAME_DELIMITER)
+        {
+            decode_end_of_frame(p_dec);
+        }
+        else if (p_dec->discard)
+        {
+            /* Wait for the delimiter */
+        }
+        else if (p_dec->remaining == 0)
+        {
+            /* A code byte, starting a new block */
+            if (p_dec->zero_pending)
+            {
+                decode_append(p_dec, 0);
+            }
+            p_dec->remaining = byte - 1;
+            p_dec->zero_pending = (byte != FULL_BLOCK_CODE);
+        }
+        else
+        {
+            decode_append(p_dec, byte);
+            p_dec->remaining--;
+        }
+    }
+}
+
+uint16_t frame_crc16(uint16_t crc, const uint8_t *p_data, size_t len)
+{
+    while (len--)
+    {
+        crc = (uint16_t) ((crc << 8) ^ crc_table[(uint8_t) ((crc >> 8) ^ *p_data++)]);
+    }
+    return crc;
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+static void encode_byte(struct frame_encoder_t *p_enc, uint8_t byte)
+{
+    if (byte == 0)
+    {
+        /* The code byte says where this zero goes */
+        flush_block(p_enc);
+    }
+    else
+    {
+        p_enc->block_len++;
+        p_enc->block[p_enc->block_len] = byte;
+        if (p_enc->block_len == FRAME_COBS_BLOCK)
+        {
+            /* A full block, with no zero after it */
+            flush_block(p_enc);
+        }
+    }
+}
+
+static void flush_block(struct frame_encoder_t *p_enc)
+{
+    p_enc->block[0] = (uint8_t) (p_enc->block_len + 1);
+    p_enc->output_fn(p_enc->block, p_enc->block_len + 1, p_enc->p_context);
+    p_enc->block_len = 0;
+}
+
+static void decode_end_of_frame(struct frame_decoder_t *p_dec)
+{
+    if (p_dec->discard || (p_dec->remaining != 0))
+    {
+        p_dec->bad_frame++;
+    }
+    else if (p_dec->len == 0)
+    {
+        /* Back to back delimiters are allowed, to resync the link */
+    }
+    else if (p_dec->len < FRAME_OVERHEAD)
+    {
+        p_dec->bad_frame++;
+    }
+    else
+    {
+        const size_t body_len = p_dec->len - 2;
+        const uint16_t rx_crc = (uint16_t) ((p_dec->p_buffer[body_len] << 8) | p_dec->p_buffer[body_len + 1]);
+        if (frame_crc16(CRC_INIT, p_dec->p_buffer, body_len) == rx_crc)
+        {
+            p_dec->good++;
+            p_dec->handler_fn(p_dec->p_buffer[0], &p_dec->p_buffer[1], body_len - 1, p_dec->p_context);
+        }
+        else
+        {
+            p_dec->bad_crc++;
+        }
+    }
+    p_dec->len = 0;
+    p_dec->remaining = 0;
+    p_dec->zero_pending = false;
+    p_dec->discard = false;
+}
+
+static void decode_append(struct frame_decoder_t *p_dec, uint8_t byte)
+{
+    if (p_dec->len == p_dec->buffer_size)
+    {
+        /* Too long - drop it */
+        p_dec->discard = true;
+    }
+    else
+    {
+        p_dec->p_buffer[p_dec->len] = byte;
+        p_dec->len++;
+    }
+}
+
+/**************************************************
+* End of file
+***************************************************/
@@ -0,0 +1,173 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Deferred binary logging.
+*
+* LOG("fmt", ...) doesn't format anything on the chip. It queues the
+* address of the format string and up to LOG_MAX_ARGS raw 32-bit
+* arguments, which takes a few dozen cycles and is safe from any
+* interrupt. log_service(), called from the main loop, sends the records
+* to a sink. The format strings are kept in the .logstr section of the
+* ELF, which isn't loaded on to the chip, and logdecode.py uses them to
+* print the records on the host.
+*
+* Arguments are stored as uint32_t. %s only works for strings in flash,
+* which the decoder reads out of the image. Floats aren't supported.
+*
+*****************************************************/
+
+#ifndef LOG_LOG_H
+#define LOG_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+
+/**************************************************
+* Public Defines
+***************************************************/
+
+#define LOG_MAX_ARGS 4
+
+/* Must be a power of two */
+#ifndef LOG_QUEUE_LEN
+#define LOG_QUEUE_LEN 32
+#endif
+
+/*
+ * Each record starts with this byte, which never appears in console
+ * text, so the decoder can pick records out of a mixed stream.
+ */
+#define LOG_SYNC 0x1F
+
+/*
+ * ID of the record log_service() sends when records have been dropped.
+ * Its argument is how many. Real IDs are never 0 (see basic.ld).
+ */
+#define LOG_ID_DROPPED 0
+
+/*
+ * LOG("format", arg1, ...) with 0 to LOG_MAX_ARGS arguments. The format
+ * must be a string literal.
+ */
+#define LOG(...) \
+    LOG_SELECT(__VA_ARGS__, LOG_4, LOG_3, LOG_2, LOG_1, LOG_0, unused)(__VA_ARGS__)
+
+/* The rest are the guts of LOG() */
+
+#define LOG_SELECT(fmt, a, b, c, d, name, ...) name
+
+#define LOG_STRING(fmt) \
+    static const char log_fmt[] __attribute__ ((section(".logstr"))) = fmt
+
+#define LOG_ARG(x) ((uint32_t) (uintptr_t) (x))
+
+#define LOG_0(fmt) \
+    do { \
+        LOG_STRING(fmt); \
+        log_record(log_fmt, 0, NULL); \
+    } while (0)
+
+#define LOG_1(fmt, a) \
+    do { \
+        LOG_STRING(fmt); \
+        const uint32_t log_args[] = { LOG_ARG(a) }; \
+        log_record(log_fmt, 1, log_args); \
+    } while (0)
+
+#define LOG_2(fmt, a, b) \
+    do { \
+        LOG_STRING(fmt); \
+        const uint32_t log_args[] = { LOG_ARG(a), LOG_ARG(b) }; \
+        log_record(log_fmt, 2, log_args); \
+    } while (0)
+
+#define LOG_3(fmt, a, b, c) \
+    do { \
+        LOG_STRING(fmt); \
+        const uint32_t log_args[] = { LOG_ARG(a), LOG_ARG(b), LOG_ARG(c) }; \
+        log_record(log_fmt, 3, log_args); \
+    } while (0)
+
+#define LOG_4(fmt, a, b, c, d) \
+    do { \
+        LOG_STRING(fmt); \
+        const uint32_t log_args[] = { LOG_ARG(a), LOG_ARG(b), LOG_ARG(c), LOG_ARG(d) }; \
+        log_record(log_fmt, 4, log_args); \
+    } while (0)
+
+/**************************************************
+* Public Data Types
+**************************************************/
+
+/*
+ * Where log_service() sends the encoded records. The records can share a
+ * UART with console text, as the decoder picks them out, but not with
+ * any other binary protocol. Either give them a channel of their own
+ * (see USE_UART_MUX) or don't call log_service() while one is running.
+ */
+typedef void (*log_sink_fn_t)(const uint8_t *p_data, size_t len);
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Public Function Prototypes
+***************************************************/
+
+/*
+ * Until this is called, LOG() does nothing.
+ */
+void log_init(log_sink_fn_t sink_fn);
+
+/*
+ * Use LOG() rather than calling this directly. Safe from any context.
+ */
+void log_record(const char *p_fmt, unsigned int nargs, const uint32_t *p_args);
+
+/*
+ * Send any queued records to the sink. Call from the main loop.
+ *
+ * @return the number of records sent
+ */
+unsigned int log_service(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ndef LOG_LOG_H */
+
+/**************************************************
+* End of file
+***************************************************/
@@ -0,0 +1,167 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Deferred binary logging. See log.h.
+*
+* Each record goes to the sink as:
+*
+*   LOG_SYNC, nargs, id (4 bytes), nargs * arg (4 bytes each)
+*
+* with multi-byte values little-endian. The id is the address of the
+* format string in the .logstr section.
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+
+#include "mpscqueue/mpscqueue.h"
+#include "log/log.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+#define HEADER_LEN 6
+
+/**************************************************
+* Data Types
+**************************************************/
+
+typedef struct log_entry_t
+{
+    uint32_t id;
+    uint32_t nargs;
+    uint32_t args[LOG_MAX_ARGS];
+} log_entry_t;
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+static void send_record(uint32_t id, unsigned int nargs, const uint32_t *p_args);
+static void put_u32(uint8_t *p, uint32_t value);
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Private Data
+**************************************************/
+
+static struct mpscqueue_t queue;
+static uint32_t queue_seq[LOG_QUEUE_LEN];
+static log_entry_t queue_elems[LOG_QUEUE_LEN];
+
+static log_sink_fn_t sink;
+
+/* How many drops we've told the host about */
+static uint32_t reported_drops;
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+void log_init(log_sink_fn_t sink_fn)
+{
+    mpscqueue_init(&queue, queue_elems, sizeof(queue_elems[0]), queue_seq, NUMELTS(queue_elems));
+    reported_drops = 0;
+    sink = sink_fn;
+}
+
+void log_record(const char *p_fmt, unsigned int nargs, const uint32_t *p_args)
+{
+    log_entry_t entry;
+    if (!sink)
+    {
+        return;
+    }
+    entry.id = (uint32_t) (uintptr_t) p_fmt;
+    entry.nargs = MIN(nargs, LOG_MAX_ARGS);
+    for (unsigned int i = 0; i < entry.nargs; i++)
+    {
+        entry.args[i] = p_args[i];
+    }
+    /* If the queue is full, mpscqueue counts the drop for us */
+    mpscqueue_push(&queue, &entry);
+}
+
+unsigned int log_service(void)
+{
+    unsigned int count = 0;
+    log_entry_t entry;
+    if (!sink)
+    {
+        return 0;
+    }
+    while (mpscqueue_pop(&queue, &entry))
+    {
+        send_record(entry.id, entry.nargs, entry.args);
+        count++;
+    }
+    /* Tell the host what it missed */
+    const uint32_t drops = queue.dropped;
+    if (drops != reported_drops)
+    {
+        const uint32_t missed = drops - reported_drops;
+        send_record(LOG_ID_DROPPED, 1, &missed);
+        reported_drops = drops;
+    }
+    return count;
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+static void send_record(uint32_t id, unsigned int nargs, const uint32_t *p_args)
+{
+    uint8_t buffer[HEADER_LEN + (4 * LOG_MAX_ARGS)];
+    buffer[0] = LOG_SYNC;
+    buffer[1] = (uint8_t) nargs;
+    put_u32(&buffer[2], id);
+    for (unsigned int i = 0; i < nargs; i++)
+    {
+        put_u32(&buffer[HEADER_LEN + (4 * i)], p_args[i]);
+    }
+    sink(buffer, HEADER_LEN + (4 * nargs));
+}
+
+static void put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t) value;
+    p[1] = (uint8_t) (value >> 8);
+    p[2] = (uint8_t) (value >> 16);
+    p[3] = (uint8_t) (value >> 24);
+}
+
+/**************************************************
+* End of file
+***************************************************/
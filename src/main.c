@@ -39,6 +39,10 @@
 
 #include "command/command.h"
 #include "circbuffer/circbuffer.h"
+#include "log/log.h"
+#include "mux/mux.h"
+#include "drivers/lcd/lcd.h"
+#include "console/console.h"
 #include "util/util.h"
 
 /**************************************************
@@ -48,8 +52,21 @@
 #define ON_MS 100
 #define OFF_MS 900
 
-/* Size of IRQ to userland ring buffer */
-#define MAX_UART_CHARS 16
+/* Size of the ring the UART interrupt receives in to. Must be a power of two. */
+#define MAX_UART_CHARS 64
+
+/* Size of the UART transmit buffer. Must be a power of two. */
+#define MAX_UART_TX_CHARS 256
+
+/* Sizes of the multiplexer's channel queues. Must be powers of two. */
+#define MUX_CONSOLE_CHARS 256
+#define MUX_LOG_CHARS 256
+#define MUX_TELEMETRY_CHARS 512
+
+/* The console is what someone is waiting for, so it goes first */
+#define MUX_CONSOLE_PRIORITY 2
+#define MUX_LOG_PRIORITY 1
+#define MUX_TELEMETRY_PRIORITY 0
 
 #define MS_TO_CLOCKS(x) ((x) * (CLOCK_RATE / 1000UL))
 
@@ -63,12 +80,12 @@
 * Function Prototypes
 **************************************************/
 
-static void uart_chars_received(
-    uart_id_t uart_id,
-    const char *buffer,
-    size_t buffer_size
+static void uart_rx_ready(
+    uart_id_t uart_id
 );
 
+static void log_to_console(const uint8_t *p_data, size_t len);
+
 /**************************************************
 * Public Data
 **************************************************/
@@ -88,8 +105,39 @@ static const timer_config_t timer_0_config = {
 
 static struct circbuffer_t g_uart_cb;
 
+/*
+ * Take input in bursts of 12, relying on the receive timeout to pass on
+ * anything less (like someone typing). The interrupt puts it straight in
+ * to g_uart_cb.
+ */
+static const uart_config_t uart_0_config = {
+    .baud_rate = 115200,
+    .parity = UART_PARITY_NONE,
+    .databits = UART_DATABITS_8,
+    .stopbits = UART_STOPBITS_1,
+    .p_rx_ring = &g_uart_cb,
+    .rx_notify = uart_rx_ready,
+    .rx_level = UART_FIFO_6_8,
+    .tx_level = UART_FIFO_4_8,
+    .rx_timeout = true
+};
+
 static uint8_t g_buffer[MAX_UART_CHARS];
 
+/* Set by the UART interrupt when g_uart_cb stops being empty */
+static volatile bool g_uart_rx_ready;
+
+/* The UART's rx_dropped count when we last logged it */
+static uint32_t g_uart_rx_dropped;
+
+static uint8_t g_tx_buffer[MAX_UART_TX_CHARS];
+
+#ifdef USE_UART_MUX
+static uint8_t g_mux_console[MUX_CONSOLE_CHARS];
+static uint8_t g_mux_log[MUX_LOG_CHARS];
+static uint8_t g_mux_telemetry[MUX_TELEMETRY_CHARS];
+#endif
+
 /**************************************************
 * Public Functions
 ***************************************************/
@@ -102,7 +150,10 @@ int main(void)
     /* Set system clock to CLOCK_RATE */
     set_clock();
 
-    circbuffer_init(&g_uart_cb, g_buffer, NUMELTS(g_buffer));
+    circbuffer_init_spsc(&g_uart_cb, g_buffer, NUMELTS(g_buffer));
+#ifdef CIRCBUFFER_STATS
+    circbuffer_register(&g_uart_cb, "uart0 rx");
+#endif
 
     gpio_enable_peripherals();
 
@@ -110,14 +161,24 @@ int main(void)
     timer_enable(TIMER_0, TIMER_A);
     timer_set_interval_load(TIMER_0, TIMER_A, 0);
 
-    int res = uart_init(
-                  UART_ID_0,
-                  115200,
-                  UART_PARITY_NONE,
-                  UART_DATABITS_8,
-                  UART_STOPBITS_1,
-                  uart_chars_received
-              );
+    int res = uart_configure(UART_ID_0, &uart_0_config);
+
+    if (res == 0)
+    {
+        /* printf output goes out under interrupt, rather than stalling us */
+        res = uart_set_tx_buffer(UART_ID_0, g_tx_buffer, NUMELTS(g_tx_buffer), UART_TX_FULL_BLOCK);
+    }
+
+#ifdef USE_UART_MUX
+    if (res == 0)
+    {
+        /* From here on, printf output goes out on the console channel */
+        mux_init(UART_ID_0);
+        res = mux_open(MUX_CHANNEL_CONSOLE, g_mux_console, NUMELTS(g_mux_console), MUX_CONSOLE_PRIORITY);
+        res = res ? res : mux_open(MUX_CHANNEL_LOG, g_mux_log, NUMELTS(g_mux_log), MUX_LOG_PRIORITY);
+        res = res ? res : mux_open(MUX_CHANNEL_TELEMETRY, g_mux_telemetry, NUMELTS(g_mux_telemetry), MUX_TELEMETRY_PRIORITY);
+    }
+#endif
 
     if (res != 0)
     {
@@ -125,6 +186,15 @@ int main(void)
         gpio_flash_error(LED_RED, LED_GREEN, 250);
     }
 
+    /* Use ./logdecode.py (or ./muxterm.py) as your terminal to see LOG() output */
+    log_init(log_to_console);
+
+#ifdef USE_LCD_CONSOLE
+    /* From here on, printf output is drawn on the LCD too */
+    lcd_init();
+    console_init();
+#endif
+
     /* iprintf is a non-float version of printf (it won't print floats).
      * Using the full printf() would double the code size of this small example program. */
     iprintf("Hello %s, %d!\n", "world", 123);
@@ -175,10 +245,63 @@ int main(void)
             on_period = true;
         }
 
-        while (!circbuffer_isempty(&g_uart_cb))
+        /* Run any interrupt handlers which were deferred to the main loop */
+        gpio_process_events();
+        timer_process_events();
+
+        /* Carry on with any command that's still running */
+        command_poll();
+
+        /*
+         * Send anything logged since last time round. Without the mux, log
+         * records would end up in the middle of the RPC replies, so they
+         * wait until RPC mode ends.
+         */
+#ifndef USE_UART_MUX
+        if (!command_rpc_active())
+#endif
+        {
+            log_service();
+        }
+
+#ifdef USE_UART_MUX
+        /* Send the next few frames, most important channel first */
+        mux_service();
+#endif
+
+#ifdef USE_LCD_CONSOLE
+        /* Draw some of what's been printed since last time round */
+        console_service();
+#endif
+
+        if (g_uart_rx_ready)
         {
-            char c = (char) circbuffer_read(&g_uart_cb);
-            command_handle_char(c);
+            /*
+             * Clear this first. If the interrupt finds the ring empty after
+             * we've drained it, it'll set it again.
+             */
+            g_uart_rx_ready = false;
+
+            while (!circbuffer_isempty(&g_uart_cb))
+            {
+                /* Parse the chars where they are, without copying them out */
+                size_t num_chars;
+                const uint8_t *p_chars = circbuffer_get_read_span(&g_uart_cb, &num_chars);
+                command_handle_chars((const char*) p_chars, num_chars);
+                circbuffer_consume(&g_uart_cb, num_chars);
+            }
+
+            /* The interrupt only counts drops, so report them from here */
+            uart_stats_t stats;
+            uart_get_stats(UART_ID_0, &stats);
+            if (stats.rx_dropped != g_uart_rx_dropped)
+            {
+                /* The 'uart' command may have reset the count */
+                const uint32_t dropped = (stats.rx_dropped > g_uart_rx_dropped) ?
+                    (stats.rx_dropped - g_uart_rx_dropped) : stats.rx_dropped;
+                LOG("uart%u rx dropped %u chars", UART_ID_0, dropped);
+                g_uart_rx_dropped = stats.rx_dropped;
+            }
         }
 
     }
@@ -192,26 +315,21 @@ int main(void)
 * Private Functions
 ***************************************************/
 
-void uart_chars_received(
-    uart_id_t uart_id,
-    const char *buffer,
-    size_t buffer_size
+void uart_rx_ready(
+    uart_id_t uart_id
 )
 {
-    /* Don't do any printf here - we're in an interrupt and we
-     * need to get out of it as quickly as possible.
-     */
-    while (buffer_size)
-    {
-        if (!circbuffer_isfull(&g_uart_cb))
-        {
-            /* Drop chars if buffer full */
-            circbuffer_write(&g_uart_cb, *buffer);
-        }
-        buffer_size--;
-        buffer++;
-    }
+    /* We're in an interrupt, so just make a note to look at the ring */
+    g_uart_rx_ready = true;
+}
 
+void log_to_console(const uint8_t *p_data, size_t len)
+{
+#ifdef USE_UART_MUX
+    mux_write_all(MUX_CHANNEL_LOG, p_data, len);
+#else
+    uart_write(UART_ID_0, (const char*) p_data, len);
+#endif
 }
 
 /**************************************************
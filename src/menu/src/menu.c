@@ -32,6 +32,7 @@
 #include "drivers/lcd/lcd.h"
 #include "font/font.h"
 #include "menu/menu.h"
+#include "log/log.h"
 
 /**************************************************
 * Defines
@@ -135,7 +136,7 @@ void menu_redraw(bool blank_screen)
 {
     const struct menu_t *p_menu = menu_levels[current_level];
     lcd_row_t y = 0;
-    PRINTF("Drawing menu '%s'\n", p_menu->p_title);
+    LOG("menu: drawing '%s'", p_menu->p_title);
     if (blank_screen)
     {
         lcd_paint_clear_screen();
@@ -146,7 +147,7 @@ void menu_redraw(bool blank_screen)
     for(size_t draw_item = 0; draw_item < p_menu->num_items; draw_item++)
     {
         const struct menu_item_t *p_menu_item = &(p_menu->p_menu_items[draw_item]);
-        PRINTF("%c %s\n", (draw_item == current_item) ? '*' : ' ', p_menu_item->p_label);
+        LOG("menu: %c %s", (draw_item == current_item) ? '*' : ' ', p_menu_item->p_label);
         if (draw_item == current_item)
         {
             font_draw_text_small(MENU_INSET, y, p_menu_item->p_label, LCD_BLACK, LCD_BLUE, false);
@@ -157,7 +158,7 @@ void menu_redraw(bool blank_screen)
         }
         y += 20;
     }
-    PRINTF("%c Back\n", (p_menu->num_items == current_item) ? '*' : ' ');
+    LOG("menu: %c Back", (p_menu->num_items == current_item) ? '*' : ' ');
     if (p_menu->num_items == current_item)
     {
         font_draw_text_small(MENU_INSET, y, "Back", LCD_BLACK, LCD_BLUE, false);
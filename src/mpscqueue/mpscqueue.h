@@ -0,0 +1,119 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* A bounded, lock-free, multi-producer single-consumer queue of fixed-size
+* elements. Interrupts at any priority can push without disabling
+* interrupts; the main loop pops.
+*
+*****************************************************/
+
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+
+/**************************************************
+* Public Defines
+***************************************************/
+
+/* None */
+
+/**************************************************
+* Public Data Types
+**************************************************/
+
+/*
+ * Each slot has a sequence number which says whether it is free for the
+ * producer reserving position N (seq == N) or holds data for the consumer
+ * reading position N (seq == N + 1). Producers reserve a position by
+ * atomically incrementing tail.
+ */
+struct mpscqueue_t
+{
+    volatile uint32_t head;     /* next position the consumer reads      */
+    volatile uint32_t tail;     /* next position a producer reserves     */
+    volatile uint32_t dropped;  /* pushes which failed as queue was full */
+    uint32_t mask;              /* capacity - 1                          */
+    size_t elem_size;           /* size of each element in bytes         */
+    volatile uint32_t *p_seq;   /* one sequence number per element       */
+    uint8_t *p_elems;           /* capacity * elem_size bytes            */
+};
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Public Function Prototypes
+***************************************************/
+
+/*
+ * Set up a queue using the given storage. capacity must be a power of
+ * two. p_seq must point to capacity uint32_t values and p_elems to
+ * capacity elements of elem_size bytes. Returns false if capacity is
+ * unsuitable.
+ */
+bool mpscqueue_init(
+    struct mpscqueue_t *q,
+    void *p_elems,
+    size_t elem_size,
+    uint32_t *p_seq,
+    size_t capacity);
+
+/*
+ * Copy an element in to the queue. Safe to call from any context,
+ * including nested interrupts. Returns false (and counts a drop) if the
+ * queue is full.
+ */
+bool mpscqueue_push(struct mpscqueue_t *q, const void *p_elem);
+
+/*
+ * Copy the oldest element out of the queue. Only one context (e.g. the
+ * main loop) may call this. Returns false if the queue is empty, or if the
+ * oldest element has been reserved by a producer which hasn't finished
+ * writing it yet.
+ */
+bool mpscqueue_pop(struct mpscqueue_t *q, void *p_elem);
+
+bool mpscqueue_isempty(const struct mpscqueue_t *q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ndef MPSCQUEUE_H */
+
+/**************************************************
+* End of file
+***************************************************/
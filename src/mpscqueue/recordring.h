@@ -0,0 +1,123 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*
+* A queue of fixed-size records, generated per record type. Useful for
+* passing events (with timestamps or other context) from interrupts to
+* the main loop.
+*
+* RECORDRING_DEFINE(my_ring, struct my_event_t, 16) defines struct
+* my_ring_t, with room for 16 records, and the functions my_ring_init(),
+* my_ring_isready(), my_ring_isempty(), my_ring_push() and my_ring_pop().
+* The capacity must be a power of two, which is checked when compiling.
+*
+* It's an mpscqueue underneath, so interrupts at any priority can push
+* while the main loop pops. The typed functions just save passing sizes
+* and void pointers around.
+*
+*****************************************************/
+
+#ifndef RECORDRING_H
+#define RECORDRING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+#include "mpscqueue/mpscqueue.h"
+
+/**************************************************
+* Public Defines
+***************************************************/
+
+#define RECORDRING_DEFINE(name, type, capacity) \
+    typedef char name##_capacity_must_be_power_of_two[IS_POWER_OF_TWO(capacity) ? 1 : -1]; \
+    \
+    struct name##_t \
+    { \
+        struct mpscqueue_t queue; \
+        uint32_t seq[capacity]; \
+        type elems[capacity]; \
+    }; \
+    \
+    static inline void name##_init(struct name##_t *p_ring) \
+    { \
+        mpscqueue_init(&p_ring->queue, p_ring->elems, sizeof(type), p_ring->seq, (capacity)); \
+    } \
+    \
+    /* A zeroed (static) ring isn't ready until name##_init() */ \
+    static inline bool name##_isready(const struct name##_t *p_ring) \
+    { \
+        return p_ring->queue.p_seq != NULL; \
+    } \
+    \
+    static inline bool name##_isempty(const struct name##_t *p_ring) \
+    { \
+        return mpscqueue_isempty(&p_ring->queue); \
+    } \
+    \
+    /* Returns false (and counts a drop) if the ring is full */ \
+    static inline bool name##_push(struct name##_t *p_ring, const type *p_elem) \
+    { \
+        return mpscqueue_push(&p_ring->queue, p_elem); \
+    } \
+    \
+    /* Returns false if the ring is empty */ \
+    static inline bool name##_pop(struct name##_t *p_ring, type *p_elem) \
+    { \
+        return mpscqueue_pop(&p_ring->queue, p_elem); \
+    }
+
+/**************************************************
+* Public Data Types
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Public Function Prototypes
+***************************************************/
+
+/* None */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ndef RECORDRING_H */
+
+/**************************************************
+* End of file
+***************************************************/
@@ -0,0 +1,188 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Lock-free multi-producer single-consumer queue. See mpscqueue.h.
+*
+* On the Cortex-M4 the tail is advanced with LDREX/STREX. The core clears
+* the exclusive monitor on exception entry and exit, so if an interrupt
+* pushes between our LDREX and STREX, the STREX fails and we try again.
+* On other targets (e.g. a host build) the GCC atomic builtins are used.
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+
+#include "mpscqueue/mpscqueue.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+/* None */
+
+/**************************************************
+* Data Types
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+static bool compare_and_swap(volatile uint32_t *p, uint32_t expected, uint32_t desired);
+static void atomic_increment(volatile uint32_t *p);
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Private Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+bool mpscqueue_init(
+    struct mpscqueue_t *q,
+    void *p_elems,
+    size_t elem_size,
+    uint32_t *p_seq,
+    size_t capacity)
+{
+    if (!IS_POWER_OF_TWO(capacity))
+    {
+        return false;
+    }
+    q->head = 0;
+    q->tail = 0;
+    q->dropped = 0;
+    q->mask = capacity - 1;
+    q->elem_size = elem_size;
+    q->p_seq = p_seq;
+    q->p_elems = p_elems;
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        /* Every slot starts free for the first lap */
+        p_seq[i] = i;
+    }
+    return true;
+}
+
+bool mpscqueue_push(struct mpscqueue_t *q, const void *p_elem)
+{
+    while (1)
+    {
+        uint32_t pos = q->tail;
+        uint32_t index = pos & q->mask;
+        int32_t diff = (int32_t) (q->p_seq[index] - pos);
+        if (diff == 0)
+        {
+            /* Slot is free - try and reserve it */
+            if (compare_and_swap(&q->tail, pos, pos + 1))
+            {
+                memcpy(&q->p_elems[index * q->elem_size], p_elem, q->elem_size);
+                MEMORY_BARRIER_RELEASE();
+                /* Publish to the consumer */
+                q->p_seq[index] = pos + 1;
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            /* Slot still holds data from the previous lap */
+            atomic_increment(&q->dropped);
+            return false;
+        }
+        /* Otherwise someone else reserved pos first, so try again */
+    }
+}
+
+bool mpscqueue_pop(struct mpscqueue_t *q, void *p_elem)
+{
+    uint32_t pos = q->head;
+    uint32_t index = pos & q->mask;
+    if (q->p_seq[index] != (pos + 1))
+    {
+        return false;
+    }
+    MEMORY_BARRIER_ACQUIRE();
+    memcpy(p_elem, &q->p_elems[index * q->elem_size], q->elem_size);
+    MEMORY_BARRIER_RELEASE();
+    /* Hand the slot back to the producers for the next lap */
+    q->p_seq[index] = pos + q->mask + 1;
+    q->head = pos + 1;
+    return true;
+}
+
+bool mpscqueue_isempty(const struct mpscqueue_t *q)
+{
+    uint32_t pos = q->head;
+    return q->p_seq[pos & q->mask] != (pos + 1);
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+static bool compare_and_swap(volatile uint32_t *p, uint32_t expected, uint32_t desired)
+{
+#ifdef __arm__
+    uint32_t current;
+    uint32_t failed;
+    __asm volatile ("ldrex %0, [%1]" : "=r" (current) : "r" (p) : "memory");
+    if (current != expected)
+    {
+        __asm volatile ("clrex" : : : "memory");
+        return false;
+    }
+    __asm volatile ("strex %0, %2, [%1]" : "=&r" (failed) : "r" (p), "r" (desired) : "memory");
+    return (failed == 0);
+#else
+    return __sync_bool_compare_and_swap(p, expected, desired);
+#endif
+}
+
+static void atomic_increment(volatile uint32_t *p)
+{
+    uint32_t value;
+    do
+    {
+        value = *p;
+    } while (!compare_and_swap(p, value, value + 1));
+}
+
+/**************************************************
+* End of file
+***************************************************/
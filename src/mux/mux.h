@@ -0,0 +1,184 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Multiplexes several logical channels over one UART.
+*
+* Each channel has its own transmit queue and a priority. mux_service(),
+* called from the main loop, takes the highest priority channel with
+* something queued and sends up to MUX_CHUNK_SIZE bytes of it as one
+* frame (see frame/frame.h), with the channel number in the frame.
+* Channels with the same priority take turns.
+*
+* Only a couple of frames are ever handed to the UART at once, so a
+* high priority channel (the console) waits for at most that much of a
+* bulk transfer before it gets the link, and bulk data gets whatever
+* bandwidth is left over. muxterm.py splits the channels out again on
+* the host.
+*
+* Each channel's queue is single producer (see circbuffer_init_spsc),
+* so write to a channel from one context only. Everything here expects
+* UART TX buffering (uart_set_tx_buffer) to be enabled.
+*
+*****************************************************/
+
+#ifndef MUX_MUX_H
+#define MUX_MUX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+
+#include "drivers/uart/uart.h"
+#include "frame/frame.h"
+
+/**************************************************
+* Public Defines
+***************************************************/
+
+#define MUX_ERROR_INVALID_CHANNEL (-1)
+#define MUX_ERROR_INVALID_BUFFER (-2)
+#define MUX_ERROR_NOT_OPEN (-3)
+
+#ifndef MUX_MAX_CHANNELS
+#define MUX_MAX_CHANNELS 4
+#endif
+
+/*
+ * Largest payload in one frame. Smaller means lower latency for high
+ * priority channels, larger means less framing overhead.
+ */
+#ifndef MUX_CHUNK_SIZE
+#define MUX_CHUNK_SIZE 64
+#endif
+
+/*
+ * How many bytes we let queue up in the UART's TX buffer. Anything in
+ * there goes out before any higher priority frame we queue later.
+ */
+#ifndef MUX_UART_DEPTH
+#define MUX_UART_DEPTH (2 * FRAME_MAX_ENCODED(MUX_CHUNK_SIZE))
+#endif
+
+/* Conventional channel numbers. Lower numbers aren't more important. */
+#define MUX_CHANNEL_CONSOLE 0
+#define MUX_CHANNEL_LOG 1
+#define MUX_CHANNEL_TELEMETRY 2
+
+/**************************************************
+* Public Data Types
+**************************************************/
+
+typedef struct mux_stats_t
+{
+    uint32_t frames;    /* frames sent           */
+    uint32_t bytes;     /* payload bytes sent    */
+    uint32_t dropped;   /* bytes mux_write() refused */
+} mux_stats_t;
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Public Function Prototypes
+***************************************************/
+
+/*
+ * Sends all channels out of the given UART.
+ */
+extern void mux_init(
+    uart_id_t uart_id
+    );
+
+/*
+ * Sets up a channel's queue. buffer_len must be a power of two. Higher
+ * priority channels are sent first.
+ *
+ * @return 0 or an error
+ */
+extern int mux_open(
+    uint8_t channel,
+    uint8_t *p_buffer,
+    size_t buffer_len,
+    uint8_t priority
+    );
+
+/*
+ * Queues data on a channel. Doesn't block.
+ *
+ * @return the number of bytes queued (which may be less than len if the
+ *         queue is full) or, if -ve, an error
+ */
+extern ssize_t mux_write(
+    uint8_t channel,
+    const void *p_data,
+    size_t len
+    );
+
+/*
+ * As mux_write() but sends frames until everything is queued, waiting
+ * for the UART if it's full. Works with interrupts disabled, but don't
+ * call this from an interrupt.
+ *
+ * @return 0 or an error
+ */
+extern int mux_write_all(
+    uint8_t channel,
+    const void *p_data,
+    size_t len
+    );
+
+/*
+ * Hands frames to the UART, until it has MUX_UART_DEPTH bytes queued
+ * or there's nothing left to send. Call this from the main loop.
+ *
+ * @return the number of frames sent
+ */
+extern unsigned int mux_service(void);
+
+/*
+ * @return 0 or an error
+ */
+extern int mux_get_stats(
+    uint8_t channel,
+    mux_stats_t *p_stats
+    );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ndef MUX_MUX_H */
+
+/**************************************************
+* End of file
+***************************************************/
@@ -0,0 +1,301 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Multiplexes several logical channels over one UART. See mux.h.
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+
+#include "circbuffer/circbuffer.h"
+#include "frame/frame.h"
+#include "mux/mux.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+/* None */
+
+/**************************************************
+* Data Types
+**************************************************/
+
+typedef struct mux_channel_t
+{
+    struct circbuffer_t cb;
+    uint8_t priority;
+    bool open;
+    mux_stats_t stats;
+} mux_channel_t;
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+static mux_channel_t *pick_channel(void);
+static void send_chunk(mux_channel_t *p_channel);
+static void output(const uint8_t *p_data, size_t len, void *p_context);
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Private Data
+**************************************************/
+
+static mux_channel_t channels[MUX_MAX_CHANNELS];
+
+static struct frame_encoder_t encoder;
+
+static uart_id_t mux_uart;
+
+/* Where the round robin between equal priorities got to */
+static unsigned int last_sent;
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+void mux_init(
+    uart_id_t uart_id
+    )
+{
+    mux_uart = uart_id;
+    last_sent = MUX_MAX_CHANNELS - 1;
+    memset(channels, 0, sizeof(channels));
+    frame_encoder_init(&encoder, output, NULL);
+}
+
+int mux_open(
+    uint8_t channel,
+    uint8_t *p_buffer,
+    size_t buffer_len,
+    uint8_t priority
+    )
+{
+    mux_channel_t *p_channel;
+
+    if (channel >= MUX_MAX_CHANNELS)
+    {
+        return MUX_ERROR_INVALID_CHANNEL;
+    }
+
+    p_channel = &channels[channel];
+
+    if (!circbuffer_init_spsc(&p_channel->cb, p_buffer, buffer_len))
+    {
+        return MUX_ERROR_INVALID_BUFFER;
+    }
+
+    p_channel->priority = priority;
+    memset(&p_channel->stats, 0, sizeof(p_channel->stats));
+    p_channel->open = true;
+
+    return 0;
+}
+
+ssize_t mux_write(
+    uint8_t channel,
+    const void *p_data,
+    size_t len
+    )
+{
+    size_t written;
+    mux_channel_t *p_channel;
+
+    if (channel >= MUX_MAX_CHANNELS)
+    {
+        return MUX_ERROR_INVALID_CHANNEL;
+    }
+
+    p_channel = &channels[channel];
+
+    if (!p_channel->open)
+    {
+        return MUX_ERROR_NOT_OPEN;
+    }
+
+    written = circbuffer_write_block(&p_channel->cb, p_data, len);
+    p_channel->stats.dropped += len - written;
+    return written;
+}
+
+int mux_write_all(
+    uint8_t channel,
+    const void *p_data,
+    size_t len
+    )
+{
+    const uint8_t *p = p_data;
+    mux_channel_t *p_channel;
+
+    if (channel >= MUX_MAX_CHANNELS)
+    {
+        return MUX_ERROR_INVALID_CHANNEL;
+    }
+
+    p_channel = &channels[channel];
+
+    if (!p_channel->open)
+    {
+        return MUX_ERROR_NOT_OPEN;
+    }
+
+    while (1)
+    {
+        size_t written = circbuffer_write_block(&p_channel->cb, p, len);
+        p += written;
+        len -= written;
+        if (len == 0)
+        {
+            break;
+        }
+        /*
+         * Make room. If the UART is already full, mux_service() won't send
+         * anything, so send a chunk of ours anyway. That blocks in
+         * uart_write(), which feeds the FIFO itself if it has to, so we
+         * get there even with interrupts disabled.
+         */
+        if (mux_service() == 0)
+        {
+            send_chunk(p_channel);
+        }
+    }
+
+    return 0;
+}
+
+unsigned int mux_service(void)
+{
+    unsigned int count = 0;
+    mux_channel_t *p_channel;
+
+    while ((p_channel = pick_channel()) != NULL)
+    {
+        ssize_t pending = uart_tx_pending(mux_uart);
+        if ((pending < 0) || ((size_t) pending >= MUX_UART_DEPTH))
+        {
+            /* Come back when the UART has caught up */
+            break;
+        }
+        send_chunk(p_channel);
+        count++;
+    }
+
+    return count;
+}
+
+int mux_get_stats(
+    uint8_t channel,
+    mux_stats_t *p_stats
+    )
+{
+    if (channel >= MUX_MAX_CHANNELS)
+    {
+        return MUX_ERROR_INVALID_CHANNEL;
+    }
+
+    if (!channels[channel].open)
+    {
+        return MUX_ERROR_NOT_OPEN;
+    }
+
+    *p_stats = channels[channel].stats;
+    return 0;
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+/*
+ * Finds the highest priority channel with something to send. Among
+ * equals, starts looking after the one we sent last time.
+ */
+static mux_channel_t *pick_channel(void)
+{
+    mux_channel_t *p_best = NULL;
+
+    for (unsigned int i = 1; i <= MUX_MAX_CHANNELS; i++)
+    {
+        mux_channel_t *p_channel = &channels[(last_sent + i) % MUX_MAX_CHANNELS];
+        if (!p_channel->open || circbuffer_isempty(&p_channel->cb))
+        {
+            continue;
+        }
+        if (!p_best || (p_channel->priority > p_best->priority))
+        {
+            p_best = p_channel;
+        }
+    }
+
+    return p_best;
+}
+
+/*
+ * Sends up to MUX_CHUNK_SIZE bytes from the channel as one frame. The
+ * frame may have to be built from both ends of the ring.
+ */
+static void send_chunk(mux_channel_t *p_channel)
+{
+    unsigned int channel = p_channel - channels;
+    size_t remaining = MUX_CHUNK_SIZE;
+
+    frame_encoder_start(&encoder, channel);
+    while (remaining)
+    {
+        size_t len;
+        const uint8_t *p_data = circbuffer_get_read_span(&p_channel->cb, &len);
+        if (len == 0)
+        {
+            break;
+        }
+        len = MIN(len, remaining);
+        frame_encoder_add(&encoder, p_data, len);
+        circbuffer_consume(&p_channel->cb, len);
+        p_channel->stats.bytes += len;
+        remaining -= len;
+    }
+    frame_encoder_finish(&encoder);
+
+    p_channel->stats.frames++;
+    last_sent = channel;
+}
+
+static void output(const uint8_t *p_data, size_t len, void *p_context)
+{
+    uart_write(mux_uart, (const char*) p_data, len);
+}
+
+/**************************************************
+* End of file
+***************************************************/
@@ -0,0 +1,158 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Timer-driven GPIO pattern generator.
+*
+* A pattern is a table of steps held in RAM. Each step writes a value to
+* some pins of one port (through the port's masked data address, so other
+* pins are left alone) and then holds for a delay before the next step.
+* The table can be played once, a number of times, or until stopped.
+*
+* Steps are played from the TIMER_1 timeout interrupt. The step lengths
+* are reloaded by the timer hardware, so they don't drift with interrupt
+* latency; each write happens a fixed (short) time after its timeout.
+*
+*****************************************************/
+
+#ifndef PATTERN_PATTERN_H
+#define PATTERN_PATTERN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+#include "drivers/gpio/gpio.h"
+
+/**************************************************
+* Public Defines
+***************************************************/
+
+#define PATTERN_ERROR_FULL (-1)
+#define PATTERN_ERROR_INVALID_PORT (-2)
+#define PATTERN_ERROR_INVALID_DELAY (-3)
+#define PATTERN_ERROR_EMPTY (-4)
+#define PATTERN_ERROR_BUSY (-5)
+
+#ifndef PATTERN_MAX_STEPS
+#define PATTERN_MAX_STEPS 64
+#endif
+
+/*
+ * The shortest step, in clock ticks. The interrupt has to finish one step
+ * before the next is due.
+ */
+#define PATTERN_MIN_DELAY ((CLOCK_RATE / 1000000) * 2)
+
+/* Pass to pattern_start() to play until pattern_stop() */
+#define PATTERN_FOREVER 0
+
+/**************************************************
+* Public Data Types
+**************************************************/
+
+typedef struct pattern_step_t
+{
+    gpio_port_t port;
+    /* Which pins of the port to write */
+    uint8_t mask;
+    /* The levels for those pins */
+    uint8_t value;
+    /* How long to hold, in clock ticks */
+    uint32_t delay;
+} pattern_step_t;
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Public Function Prototypes
+***************************************************/
+
+/*
+ * Empties the step table. Fails if a pattern is playing.
+ *
+ * @return 0 or an error
+ */
+extern int pattern_clear(void);
+
+/*
+ * Appends a step to the table. Fails if a pattern is playing.
+ *
+ * @return the index of the new step or, if -ve, an error
+ */
+extern int pattern_add(gpio_port_t port, uint8_t mask, uint8_t value, uint32_t delay);
+
+/*
+ * @return the number of steps in the table
+ */
+extern unsigned int pattern_count(void);
+
+/*
+ * @return a step from the table, or NULL if index is too large
+ */
+extern const pattern_step_t *pattern_get(unsigned int index);
+
+/*
+ * Makes every pin the table writes an output and starts playing the
+ * table, repeats times over (or PATTERN_FOREVER). The first step is
+ * written before this returns.
+ *
+ * @return 0 or an error
+ */
+extern int pattern_start(unsigned int repeats);
+
+/*
+ * Stops playing. The pins are left as they are.
+ */
+extern void pattern_stop(void);
+
+/*
+ * @return true if a pattern is playing
+ */
+extern bool pattern_running(void);
+
+/*
+ * @return the number of passes through the table completed since
+ * pattern_start()
+ */
+extern uint32_t pattern_passes(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ndef PATTERN_PATTERN_H */
+
+/**************************************************
+* End of file
+***************************************************/
+
@@ -0,0 +1,253 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Timer-driven GPIO pattern generator. See pattern.h.
+*
+* TIMER_1 runs periodic, counting down, with interval_load_write set so
+* a new load value takes effect at the next timeout rather than at once.
+* At the timeout which starts step n the interrupt writes step n's pins
+* and loads step n + 1's delay; the hardware has already reloaded step
+* n's delay (loaded during step n - 1) so the timing doesn't depend on
+* how quickly the interrupt runs.
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+#include "drivers/gpio/gpio.h"
+#include "drivers/timers/timers.h"
+
+#include "pattern/pattern.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+#define PATTERN_TIMER TIMER_1
+
+/**************************************************
+* Data Types
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+static void timer_handler(timer_module_t timer, timer_ab_t ab, void *p_context, uint32_t n_context);
+static void make_outputs(void);
+static unsigned int next_step(unsigned int step);
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Private Data
+**************************************************/
+
+static const timer_config_t timer_config = {
+    .type = TIMER_JOINED,
+    .timer_a = {
+        .type = TIMER_SPLIT_PERIODIC,
+        .count_up = false,
+        .interval_load_write = true,
+    }
+};
+
+static pattern_step_t steps[PATTERN_MAX_STEPS];
+static unsigned int num_steps;
+
+/* Shared with the interrupt */
+static volatile bool running;
+static volatile unsigned int current_step;
+static volatile uint32_t passes;
+static uint32_t total_passes;
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+int pattern_clear(void)
+{
+    if (running)
+    {
+        return PATTERN_ERROR_BUSY;
+    }
+    num_steps = 0;
+    return 0;
+}
+
+int pattern_add(gpio_port_t port, uint8_t mask, uint8_t value, uint32_t delay)
+{
+    if (running)
+    {
+        return PATTERN_ERROR_BUSY;
+    }
+    if (num_steps >= PATTERN_MAX_STEPS)
+    {
+        return PATTERN_ERROR_FULL;
+    }
+    if ((unsigned int) port >= GPIO_NUM_PORTS)
+    {
+        return PATTERN_ERROR_INVALID_PORT;
+    }
+    if (delay < PATTERN_MIN_DELAY)
+    {
+        return PATTERN_ERROR_INVALID_DELAY;
+    }
+    steps[num_steps].port = port;
+    steps[num_steps].mask = mask;
+    steps[num_steps].value = value & mask;
+    steps[num_steps].delay = delay;
+    return num_steps++;
+}
+
+unsigned int pattern_count(void)
+{
+    return num_steps;
+}
+
+const pattern_step_t *pattern_get(unsigned int index)
+{
+    return (index < num_steps) ? &steps[index] : NULL;
+}
+
+int pattern_start(unsigned int repeats)
+{
+    if (running)
+    {
+        return PATTERN_ERROR_BUSY;
+    }
+    if (num_steps == 0)
+    {
+        return PATTERN_ERROR_EMPTY;
+    }
+
+    make_outputs();
+
+    timer_configure(PATTERN_TIMER, &timer_config);
+    timer_register_handler(PATTERN_TIMER, TIMER_A, timer_handler, NULL, 0);
+    timer_interrupt_clear(PATTERN_TIMER, TIMER_A_INTERRUPT_TIMEOUT);
+    timer_interrupt_enable(PATTERN_TIMER, TIMER_A_INTERRUPT_TIMEOUT);
+
+    total_passes = repeats;
+    passes = 0;
+    current_step = 0;
+    running = true;
+
+    /* The timer counts from the load value down to zero inclusive */
+    timer_set_interval_load(PATTERN_TIMER, TIMER_A, steps[0].delay - 1);
+    gpio_set_outputs(steps[0].port, steps[0].value, steps[0].mask);
+    timer_enable(PATTERN_TIMER, TIMER_A);
+    /* Takes effect at the first timeout */
+    timer_set_interval_load(PATTERN_TIMER, TIMER_A, steps[next_step(0)].delay - 1);
+
+    return 0;
+}
+
+void pattern_stop(void)
+{
+    timer_disable(PATTERN_TIMER, TIMER_A);
+    timer_interrupt_disable(PATTERN_TIMER, TIMER_A_INTERRUPT_TIMEOUT);
+    timer_interrupt_clear(PATTERN_TIMER, TIMER_A_INTERRUPT_TIMEOUT);
+    running = false;
+}
+
+bool pattern_running(void)
+{
+    return running;
+}
+
+uint32_t pattern_passes(void)
+{
+    return passes;
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+/*
+ * Each pin starts at the level the first step which writes it will give
+ * it, so step 0 doesn't glitch anything.
+ */
+static void make_outputs(void)
+{
+    uint8_t done[GPIO_NUM_PORTS] = { 0 };
+    for (unsigned int i = 0; i < num_steps; i++)
+    {
+        const pattern_step_t *p_step = &steps[i];
+        for (unsigned int pin = 0; pin < 8; pin++)
+        {
+            uint8_t bit = 1U << pin;
+            if ((p_step->mask & bit) && !(done[p_step->port] & bit))
+            {
+                gpio_make_output(GPIO_MAKE_IO_PIN(p_step->port, pin), p_step->value & bit);
+                done[p_step->port] |= bit;
+            }
+        }
+    }
+}
+
+static unsigned int next_step(unsigned int step)
+{
+    step++;
+    return (step == num_steps) ? 0 : step;
+}
+
+static void timer_handler(timer_module_t timer, timer_ab_t ab, void *p_context, uint32_t n_context)
+{
+    unsigned int step = next_step(current_step);
+    const pattern_step_t *p_step;
+
+    timer_interrupt_clear(PATTERN_TIMER, TIMER_A_INTERRUPT_TIMEOUT);
+
+    if (step == 0)
+    {
+        passes++;
+        if ((total_passes != PATTERN_FOREVER) && (passes == total_passes))
+        {
+            timer_disable(PATTERN_TIMER, TIMER_A);
+            running = false;
+            return;
+        }
+    }
+
+    p_step = &steps[step];
+    gpio_set_outputs(p_step->port, p_step->value, p_step->mask);
+    current_step = step;
+    timer_set_interval_load(PATTERN_TIMER, TIMER_A, steps[next_step(step)].delay - 1);
+}
+
+/**************************************************
+* End of file
+***************************************************/
+
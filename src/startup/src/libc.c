@@ -38,6 +38,8 @@
 #include "drivers/misc/misc.h"
 #include "drivers/gpio/gpio.h"
 #include "drivers/uart/uart.h"
+#include "mux/mux.h"
+#include "console/console.h"
 
 /**************************************************
 * Defines
@@ -111,7 +113,14 @@ caddr_t _sbrk(int incr) {
 int _write(int file, char *ptr, int len) {
 	if (file == 1)
 	{
+#ifdef USE_UART_MUX
+		mux_write_all(MUX_CHANNEL_CONSOLE, ptr, len);
+#else
 		uart_write(UART_ID_0, ptr, len);
+#endif
+#ifdef USE_LCD_CONSOLE
+		console_write(ptr, len);
+#endif
 	}
 	return len;
 }
@@ -32,6 +32,7 @@
 
 #include "drivers/uart/uart.h"
 #include "drivers/gpio/gpio.h"
+#include "drivers/udma/udma.h"
 #include "drivers/misc/misc.h"
 #include "drivers/timers/timer_interrupts.h"
 #include "drivers/gpio/gpio_interrupts.h"
@@ -142,7 +143,7 @@ unsigned long myvectors[] =
     (unsigned long) empty_def_handler,      // USB                              60
     0,                                      // Reserved                         61
     (unsigned long) empty_def_handler,      // UDMA SW                          62
-    (unsigned long) empty_def_handler,      // UDMA Error                       63
+    (unsigned long) udma_error_irq,         // UDMA Error                       63
     (unsigned long) empty_def_handler,      // ADC 1 Seq 0                      64
     (unsigned long) empty_def_handler,      // ADC 1 Seq 1                      65
     (unsigned long) empty_def_handler,      // ADC 1 Seq 2                      66
@@ -62,6 +62,47 @@ extern "C" {
 
 #define MIN(x,y) ((x) < (y) ? (x) : (y))
 
+#define MAX(x,y) ((x) > (y) ? (x) : (y))
+
+#define IS_POWER_OF_TWO(x) ( ((x) != 0) && (((x) & ((x) - 1)) == 0) )
+
+/*
+ * Stops the compiler (and the core) re-ordering memory accesses across this
+ * point. Use it before handing memory to the DMA controller.
+ */
+#ifdef __arm__
+#define MEMORY_BARRIER() __asm volatile ("dmb" : : : "memory")
+#else
+#define MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+/*
+ * For handing data between an interrupt and the main loop. The producer
+ * fills in the data, then MEMORY_BARRIER_RELEASE(), then moves the index
+ * that publishes it. The consumer reads the index, then
+ * MEMORY_BARRIER_ACQUIRE(), then the data. The M4 is a single core, so
+ * an interrupt always sees the main loop's accesses in order; we only
+ * need to stop the compiler moving them. The host build gets real fences
+ * for the tests' threads (which on x86 also only constrain the compiler).
+ */
+#ifdef __arm__
+#define MEMORY_BARRIER_RELEASE() __asm volatile ("" : : : "memory")
+#define MEMORY_BARRIER_ACQUIRE() __asm volatile ("" : : : "memory")
+#else
+#define MEMORY_BARRIER_RELEASE() __atomic_thread_fence(__ATOMIC_RELEASE)
+#define MEMORY_BARRIER_ACQUIRE() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#endif
+
+/*
+ * Puts a function in SRAM, away from the flash wait states. It's copied
+ * there with .data at start up (see basic.ld), so keep it small.
+ */
+#ifdef __arm__
+#define RAMFUNC __attribute__((section(".ramfunc"), noinline, long_call))
+#else
+#define RAMFUNC
+#endif
+
 /**************************************************
 * Public Data Types
 **************************************************/
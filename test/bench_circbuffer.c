@@ -0,0 +1,189 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Host throughput benchmark for circbuffer: the original one byte per
+* call, modulo-wrapped path against the SPSC mode's block copies. Data
+* goes through in UART FIFO sized chunks, as it does from the RX
+* interrupt to the main loop.
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include <time.h>
+
+#include "util/util.h"
+#include "circbuffer/circbuffer.h"
+
+#include "test.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+#define BUFFER_LEN 256
+#define CHUNK_LEN 16
+#define TOTAL_BYTES (64UL * 1024 * 1024)
+
+/**************************************************
+* Data Types
+**************************************************/
+
+typedef uint32_t (*pass_fn_t)(struct circbuffer_t *cb);
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+static void run(const char *p_name, bool spsc, pass_fn_t fn);
+static uint32_t pass_bytes(struct circbuffer_t *cb);
+static uint32_t pass_blocks(struct circbuffer_t *cb);
+static uint32_t pass_spans(struct circbuffer_t *cb);
+static double seconds(void);
+
+/**************************************************
+* Private Data
+**************************************************/
+
+static uint8_t g_buffer[BUFFER_LEN];
+static uint8_t g_chunk[CHUNK_LEN];
+static uint32_t g_expected;
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+int main(void)
+{
+    for (unsigned int i = 0; i < CHUNK_LEN; i++)
+    {
+        g_chunk[i] = (uint8_t) ('a' + i);
+        g_expected += g_chunk[i];
+    }
+    g_expected *= (TOTAL_BYTES / CHUNK_LEN);
+
+    run("write/read (modulo)", false, pass_bytes);
+    run("write/read (spsc)", true, pass_bytes);
+    run("write_block/read_block (spsc)", true, pass_blocks);
+    run("write/read spans (spsc)", true, pass_spans);
+
+    return TEST_RESULT();
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+static void run(const char *p_name, bool spsc, pass_fn_t fn)
+{
+    struct circbuffer_t cb;
+    double start, elapsed;
+    uint32_t sum;
+
+    if (spsc)
+    {
+        CHECK(circbuffer_init_spsc(&cb, g_buffer, sizeof(g_buffer)));
+    }
+    else
+    {
+        circbuffer_init(&cb, g_buffer, sizeof(g_buffer));
+    }
+
+    start = seconds();
+    sum = fn(&cb);
+    elapsed = seconds() - start;
+
+    /* Everything which went in came out, in order enough to sum right */
+    CHECK_EQUAL(sum, g_expected);
+    printf("%-32s %8.1f MB/s\n", p_name, (TOTAL_BYTES / elapsed) / 1e6);
+}
+
+/* The pre-SPSC way: a call per byte each side */
+static uint32_t pass_bytes(struct circbuffer_t *cb)
+{
+    uint32_t sum = 0;
+    for (unsigned long done = 0; done < TOTAL_BYTES; done += CHUNK_LEN)
+    {
+        for (unsigned int i = 0; i < CHUNK_LEN; i++)
+        {
+            circbuffer_write(cb, g_chunk[i]);
+        }
+        while (!circbuffer_isempty(cb))
+        {
+            sum += circbuffer_read(cb);
+        }
+    }
+    return sum;
+}
+
+static uint32_t pass_blocks(struct circbuffer_t *cb)
+{
+    uint32_t sum = 0;
+    uint8_t out[CHUNK_LEN];
+    for (unsigned long done = 0; done < TOTAL_BYTES; done += CHUNK_LEN)
+    {
+        size_t len;
+        circbuffer_write_block(cb, g_chunk, CHUNK_LEN);
+        len = circbuffer_read_block(cb, out, sizeof(out));
+        for (size_t i = 0; i < len; i++)
+        {
+            sum += out[i];
+        }
+    }
+    return sum;
+}
+
+/* How main.c hands received text to the command parser */
+static uint32_t pass_spans(struct circbuffer_t *cb)
+{
+    uint32_t sum = 0;
+    for (unsigned long done = 0; done < TOTAL_BYTES; done += CHUNK_LEN)
+    {
+        const uint8_t *p;
+        size_t len;
+        circbuffer_write_block(cb, g_chunk, CHUNK_LEN);
+        while ((p = circbuffer_get_read_span(cb, &len)), len != 0)
+        {
+            for (size_t i = 0; i < len; i++)
+            {
+                sum += p[i];
+            }
+            circbuffer_consume(cb, len);
+        }
+    }
+    return sum;
+}
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+/**************************************************
+* End of file
+***************************************************/
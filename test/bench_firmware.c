@@ -0,0 +1,68 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*
+* Host build of the firmware's benchmarks (src/bench): runs every one in
+* the table and prints the times, as the 'bench' command does on the
+* chip. Handy for comparing kernels before trying them on the chip.
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+#include "bench/bench.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+#define RUNS BENCH_MAX_RUNS
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+int main(void)
+{
+    printf("%-24s %10s %10s %10s (%s)\n", "", "min", "median", "max", bench_units());
+    for (unsigned int i = 0; i < bench_count(); i++)
+    {
+        bench_result_t result;
+        if (bench_run(i, RUNS, &result) != 0)
+        {
+            fprintf(stderr, "%s: failed\n", bench_name(i));
+            return 1;
+        }
+        printf("%-24s %10" PRIu32 " %10" PRIu32 " %10" PRIu32 "\n",
+               bench_name(i), result.min, result.median, result.max);
+    }
+    return 0;
+}
+
+/**************************************************
+* End of file
+***************************************************/
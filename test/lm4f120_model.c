@@ -0,0 +1,773 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Host model of UART0 and the uDMA controller. See lm4f120_model.h.
+*
+* References:
+*
+*     [1] - Stellaris® LM4F121H5QR Microcontroller
+*           Data Sheet.
+*           http://www.ti.com/lit/ds/symlink/lm4f120h5qr.pdf
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+/* For REG_ERR and REG_EFL in ucontext_t */
+#define _GNU_SOURCE
+
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+
+#include "util/util.h"
+#include "drivers/misc/misc.h"
+#include "drivers/uart/uart.h"
+#include "drivers/udma/udma.h"
+
+#include "lm4f120_model.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+#define PAGE_LEN 4096
+
+#define UART0_BASE  0x4000C000UL
+#define SYSCTL_BASE 0x400FE000UL
+#define UDMA_BASE   0x400FF000UL
+
+/*
+ * UART registers, as word offsets from [1] p816. uart.c reaches them
+ * through a struct of reg_t, so on the host they're sizeof(reg_t) apart.
+ */
+#define UART_DR     (0x000 / 4)
+#define UART_FR     (0x018 / 4)
+#define UART_CTL    (0x030 / 4)
+#define UART_IFLS   (0x034 / 4)
+#define UART_IM     (0x038 / 4)
+#define UART_RIS    (0x03C / 4)
+#define UART_MIS    (0x040 / 4)
+#define UART_ICR    (0x044 / 4)
+#define UART_DMACTL (0x048 / 4)
+
+/* The UART's reset value, [1] p837 */
+#define UART_IFLS_RESET 0x12
+
+/* SYSCTL and uDMA registers are used through lm4f120h5qr.h as they are */
+#define REG_ADDR(reg) ((uintptr_t) &(reg))
+
+#define UART0_INT 5
+#define UART0_RX_CHANNEL 8
+#define UART0_TX_CHANNEL 9
+#define UART0_CHANNELS ((1UL << UART0_RX_CHANNEL) | (1UL << UART0_TX_CHANNEL))
+
+#define EFLAGS_TF 0x100
+#define PAGE_FAULT_WRITE 0x2
+
+#define NUM_INTERRUPTS 160
+
+/* A model_run() that takes longer than this is stuck */
+#define MAX_PASSES 100000
+
+/**************************************************
+* Data Types
+**************************************************/
+
+struct uart_model_t
+{
+    uint32_t regs[PAGE_LEN / sizeof(reg_t)];
+    uint32_t ris;      /* TX and RT. RX follows the FIFO level */
+    uint8_t rx[MODEL_FIFO_LEN];
+    size_t rx_len;
+    uint8_t tx[MODEL_FIFO_LEN];
+    size_t tx_len;
+    uint8_t sent[MODEL_SENT_LEN];
+    size_t sent_len;
+};
+
+struct udma_model_t
+{
+    uint32_t regs[PAGE_LEN / 4];
+    uint32_t enabled;
+    uint32_t alt;
+    uint32_t useburst;
+    uint32_t reqmask;
+    uint32_t chis;
+};
+
+/* The register access being single stepped */
+struct trap_t
+{
+    uintptr_t addr;
+    void *p_page;
+    bool write;
+};
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+static void on_segv(int sig, siginfo_t *p_info, void *p_context);
+static void on_trap(int sig, siginfo_t *p_info, void *p_context);
+static bool is_model_page(const void *p_page);
+static uint32_t reg_read(uintptr_t addr, bool side_effects);
+static void reg_write(uintptr_t addr, uint32_t value);
+static uint32_t uart_ris(void);
+static uint32_t uart_fr(void);
+static size_t fifo_level(unsigned int field);
+static void line_transmit(void);
+static bool udma_service(unsigned int channel);
+static bool udma_request(unsigned int channel);
+static bool scatter_gather_copy(unsigned int channel, udma_entry_t *p_entry);
+static uint32_t bus_read(uint32_t addr, unsigned int width);
+static void bus_write(uint32_t addr, unsigned int width, uint32_t value);
+static size_t inc_bytes(uint32_t control, unsigned int shift);
+static void model_error(const char *p_message, unsigned int channel);
+
+/**************************************************
+* Private Data
+**************************************************/
+
+static const uintptr_t g_pages[] = { UART0_BASE, SYSCTL_BASE, UDMA_BASE };
+
+static struct uart_model_t g_uart;
+static struct udma_model_t g_udma;
+static uint32_t g_sysctl[PAGE_LEN / 4];
+static bool g_nvic[NUM_INTERRUPTS];
+static bool g_hold;
+static unsigned int g_irqs;
+static struct trap_t g_trap;
+
+/* FIFO trigger levels, [1] p837 */
+static const size_t g_fifo_levels[] = { 2, 4, 8, 12, 14 };
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+void model_init(void)
+{
+    struct sigaction action;
+
+    for (unsigned int i = 0; i < NUMELTS(g_pages); i++)
+    {
+        void *const p = mmap((void *) g_pages[i], PAGE_LEN, PROT_NONE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+        if (p != (void *) g_pages[i])
+        {
+            fprintf(stderr, "model: can't map 0x%08lx\n", (unsigned long) g_pages[i]);
+            exit(1);
+        }
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_flags = SA_SIGINFO;
+    action.sa_sigaction = on_segv;
+    sigaction(SIGSEGV, &action, NULL);
+    action.sa_sigaction = on_trap;
+    sigaction(SIGTRAP, &action, NULL);
+
+    g_uart.regs[UART_IFLS] = UART_IFLS_RESET;
+}
+
+size_t model_uart_receive(const uint8_t *p_data, size_t len)
+{
+    size_t i;
+    for (i = 0; (i < len) && (g_uart.rx_len < MODEL_FIFO_LEN); i++)
+    {
+        g_uart.rx[g_uart.rx_len++] = p_data[i];
+    }
+    return i;
+}
+
+void model_uart_rx_idle(void)
+{
+    if (g_uart.rx_len)
+    {
+        g_uart.ris |= UART_RIS_RTRIS;
+    }
+}
+
+void model_run(void)
+{
+    unsigned int passes = 0;
+    bool busy = true;
+    while (busy)
+    {
+        busy = false;
+        if (++passes > MAX_PASSES)
+        {
+            fprintf(stderr, "model: still busy after %u passes\n", MAX_PASSES);
+            abort();
+        }
+        if (g_uart.tx_len && (g_uart.regs[UART_CTL] & UART_CTL_UARTEN))
+        {
+            line_transmit();
+            busy = true;
+        }
+        busy |= udma_service(UART0_RX_CHANNEL);
+        busy |= udma_service(UART0_TX_CHANNEL);
+        if (!g_hold && g_nvic[UART0_INT] &&
+            ((uart_ris() & g_uart.regs[UART_IM]) || (g_udma.chis & UART0_CHANNELS)))
+        {
+            g_irqs++;
+            uart0_irq();
+            busy = true;
+        }
+    }
+}
+
+void model_hold_interrupts(bool hold)
+{
+    g_hold = hold;
+}
+
+const uint8_t *model_uart_sent(size_t *p_len)
+{
+    *p_len = g_uart.sent_len;
+    return g_uart.sent;
+}
+
+void model_clear_sent(void)
+{
+    g_uart.sent_len = 0;
+}
+
+size_t model_uart_rx_level(void)
+{
+    return g_uart.rx_len;
+}
+
+unsigned int model_irq_count(void)
+{
+    return g_irqs;
+}
+
+/* Stand-ins for the NVIC helpers in misc.c */
+
+void enable_interrupt(unsigned int interrupt_id)
+{
+    if (interrupt_id < NUM_INTERRUPTS)
+    {
+        g_nvic[interrupt_id] = true;
+    }
+}
+
+void disable_interrupt(unsigned int interrupt_id)
+{
+    if (interrupt_id < NUM_INTERRUPTS)
+    {
+        g_nvic[interrupt_id] = false;
+    }
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+/*
+ * A driver touched a register. Put what it should read in the page, let
+ * it at the page for one instruction, then see what it wrote.
+ */
+static void on_segv(int sig, siginfo_t *p_info, void *p_context)
+{
+    ucontext_t *const p_uc = p_context;
+    const uintptr_t addr = (uintptr_t) p_info->si_addr;
+    void *const p_page = (void *) (addr & ~(uintptr_t) (PAGE_LEN - 1));
+
+    if (!is_model_page(p_page))
+    {
+        /* A real crash - let it happen */
+        signal(SIGSEGV, SIG_DFL);
+        return;
+    }
+
+    g_trap.addr = addr;
+    g_trap.p_page = p_page;
+    g_trap.write = (p_uc->uc_mcontext.gregs[REG_ERR] & PAGE_FAULT_WRITE) != 0;
+
+    mprotect(p_page, PAGE_LEN, PROT_READ | PROT_WRITE);
+    /* A read-modify-write reads it too, but mustn't pop the FIFO */
+    *(volatile uint64_t *) addr = reg_read(addr, !g_trap.write);
+    p_uc->uc_mcontext.gregs[REG_EFL] |= EFLAGS_TF;
+}
+
+static void on_trap(int sig, siginfo_t *p_info, void *p_context)
+{
+    ucontext_t *const p_uc = p_context;
+
+    if (!g_trap.p_page)
+    {
+        signal(SIGTRAP, SIG_DFL);
+        return;
+    }
+
+    if (g_trap.write)
+    {
+        /* reg_t is wider than the registers on the host */
+        reg_write(g_trap.addr, (uint32_t) *(volatile uint64_t *) g_trap.addr);
+    }
+    mprotect(g_trap.p_page, PAGE_LEN, PROT_NONE);
+    g_trap.p_page = NULL;
+    p_uc->uc_mcontext.gregs[REG_EFL] &= ~EFLAGS_TF;
+}
+
+static bool is_model_page(const void *p_page)
+{
+    for (unsigned int i = 0; i < NUMELTS(g_pages); i++)
+    {
+        if ((uintptr_t) p_page == g_pages[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t reg_read(uintptr_t addr, bool side_effects)
+{
+    if ((addr & ~(uintptr_t) (PAGE_LEN - 1)) == UART0_BASE)
+    {
+        const size_t index = (addr - UART0_BASE) / sizeof(reg_t);
+        switch (index)
+        {
+        case UART_DR:
+            if (side_effects && g_uart.rx_len)
+            {
+                const uint8_t c = g_uart.rx[0];
+                memmove(&g_uart.rx[0], &g_uart.rx[1], --g_uart.rx_len);
+                if (g_uart.rx_len == 0)
+                {
+                    /* Emptying the FIFO clears the timeout, [1] p843 */
+                    g_uart.ris &= ~UART_RIS_RTRIS;
+                }
+                return c;
+            }
+            return 0;
+        case UART_FR:
+            return uart_fr();
+        case UART_RIS:
+            return uart_ris();
+        case UART_MIS:
+            return uart_ris() & g_uart.regs[UART_IM];
+        default:
+            return g_uart.regs[index];
+        }
+    }
+
+    if ((addr & ~(uintptr_t) (PAGE_LEN - 1)) == SYSCTL_BASE)
+    {
+        if (addr == REG_ADDR(SYSCTL_PRDMA_R))
+        {
+            /* Ready as soon as it's clocked */
+            return g_sysctl[(REG_ADDR(SYSCTL_RCGCDMA_R) - SYSCTL_BASE) / 4];
+        }
+        return g_sysctl[(addr - SYSCTL_BASE) / 4];
+    }
+
+    if ((addr == REG_ADDR(UDMA_ENASET_R)) || (addr == REG_ADDR(UDMA_ENACLR_R)))
+    {
+        return g_udma.enabled;
+    }
+    if ((addr == REG_ADDR(UDMA_ALTSET_R)) || (addr == REG_ADDR(UDMA_ALTCLR_R)))
+    {
+        return g_udma.alt;
+    }
+    if ((addr == REG_ADDR(UDMA_USEBURSTSET_R)) || (addr == REG_ADDR(UDMA_USEBURSTCLR_R)))
+    {
+        return g_udma.useburst;
+    }
+    if ((addr == REG_ADDR(UDMA_REQMASKSET_R)) || (addr == REG_ADDR(UDMA_REQMASKCLR_R)))
+    {
+        return g_udma.reqmask;
+    }
+    if (addr == REG_ADDR(UDMA_CHIS_R))
+    {
+        return g_udma.chis;
+    }
+    return g_udma.regs[(addr - UDMA_BASE) / 4];
+}
+
+static void reg_write(uintptr_t addr, uint32_t value)
+{
+    if ((addr & ~(uintptr_t) (PAGE_LEN - 1)) == UART0_BASE)
+    {
+        const size_t index = (addr - UART0_BASE) / sizeof(reg_t);
+        switch (index)
+        {
+        case UART_DR:
+            if (g_uart.tx_len < MODEL_FIFO_LEN)
+            {
+                g_uart.tx[g_uart.tx_len++] = (uint8_t) value;
+            }
+            break;
+        case UART_ICR:
+            g_uart.ris &= ~value;
+            break;
+        case UART_FR:
+        case UART_RIS:
+        case UART_MIS:
+            /* Read only */
+            break;
+        default:
+            g_uart.regs[index] = value;
+            break;
+        }
+        return;
+    }
+
+    if ((addr & ~(uintptr_t) (PAGE_LEN - 1)) == SYSCTL_BASE)
+    {
+        g_sysctl[(addr - SYSCTL_BASE) / 4] = value;
+        return;
+    }
+
+    /* Most of the uDMA's registers are write one to set or clear */
+    if (addr == REG_ADDR(UDMA_ENASET_R))
+    {
+        g_udma.enabled |= value;
+    }
+    else if (addr == REG_ADDR(UDMA_ENACLR_R))
+    {
+        g_udma.enabled &= ~value;
+    }
+    else if (addr == REG_ADDR(UDMA_ALTSET_R))
+    {
+        g_udma.alt |= value;
+    }
+    else if (addr == REG_ADDR(UDMA_ALTCLR_R))
+    {
+        g_udma.alt &= ~value;
+    }
+    else if (addr == REG_ADDR(UDMA_USEBURSTSET_R))
+    {
+        g_udma.useburst |= value;
+    }
+    else if (addr == REG_ADDR(UDMA_USEBURSTCLR_R))
+    {
+        g_udma.useburst &= ~value;
+    }
+    else if (addr == REG_ADDR(UDMA_REQMASKSET_R))
+    {
+        g_udma.reqmask |= value;
+    }
+    else if (addr == REG_ADDR(UDMA_REQMASKCLR_R))
+    {
+        g_udma.reqmask &= ~value;
+    }
+    else if (addr == REG_ADDR(UDMA_CHIS_R))
+    {
+        g_udma.chis &= ~value;
+    }
+    else if (addr != REG_ADDR(UDMA_ERRCLR_R))
+    {
+        g_udma.regs[(addr - UDMA_BASE) / 4] = value;
+    }
+}
+
+static uint32_t uart_ris(void)
+{
+    uint32_t ris = g_uart.ris;
+    if (g_uart.rx_len >= fifo_level(g_uart.regs[UART_IFLS] >> 3))
+    {
+        ris |= UART_RIS_RXRIS;
+    }
+    return ris;
+}
+
+static uint32_t uart_fr(void)
+{
+    uint32_t fr = 0;
+    fr |= (g_uart.rx_len == 0) ? UART_FR_RXFE : 0;
+    fr |= (g_uart.rx_len == MODEL_FIFO_LEN) ? UART_FR_RXFF : 0;
+    fr |= (g_uart.tx_len == 0) ? UART_FR_TXFE : UART_FR_BUSY;
+    fr |= (g_uart.tx_len == MODEL_FIFO_LEN) ? UART_FR_TXFF : 0;
+    return fr;
+}
+
+static size_t fifo_level(unsigned int field)
+{
+    field &= 0x7;
+    return (field < NUMELTS(g_fifo_levels)) ? g_fifo_levels[field] : g_fifo_levels[2];
+}
+
+/*
+ * The line is infinitely fast: the whole TX FIFO goes at once. The TX
+ * interrupt is raised as the level passes down through the trigger.
+ */
+static void line_transmit(void)
+{
+    const size_t level = fifo_level(g_uart.regs[UART_IFLS]);
+    const size_t len = MIN(g_uart.tx_len, MODEL_SENT_LEN - g_uart.sent_len);
+    memcpy(&g_uart.sent[g_uart.sent_len], g_uart.tx, len);
+    g_uart.sent_len += len;
+    if (g_uart.tx_len > level)
+    {
+        g_uart.ris |= UART_RIS_TXRIS;
+    }
+    g_uart.tx_len = 0;
+}
+
+/*
+ * One arbitration's worth of transfers on a channel, if the UART is
+ * asking for it. See [1] section 9.2.
+ *
+ * @return true if anything happened
+ */
+static bool udma_service(unsigned int channel)
+{
+    const uint32_t bit = 1UL << channel;
+    const uint32_t chmap = g_udma.regs[(REG_ADDR(UDMA_CHMAP1_R) - UDMA_BASE) / 4];
+    udma_entry_t *const p_table =
+        (udma_entry_t *) (uintptr_t) g_udma.regs[(REG_ADDR(UDMA_CTLBASE_R) - UDMA_BASE) / 4];
+    udma_entry_t *p_entry;
+    uint32_t control;
+    unsigned int mode, width;
+    size_t left, count, src_inc, dst_inc;
+
+    if (!(g_udma.regs[(REG_ADDR(UDMA_CFG_R) - UDMA_BASE) / 4] & UDMA_CFG_MASTEN)
+        || !(g_udma.enabled & bit)
+        || (g_udma.reqmask & bit)
+        || ((chmap >> ((channel % 8) * 4)) & 0xF) != 0
+        || !udma_request(channel))
+    {
+        return false;
+    }
+
+    if (((uintptr_t) p_table % 1024) != 0)
+    {
+        model_error("control table not 1024 byte aligned", channel);
+        return false;
+    }
+
+    p_entry = &p_table[(g_udma.alt & bit) ? (UDMA_NUM_CHANNELS + channel) : channel];
+    control = p_entry->control;
+    mode = control & UDMA_CHCTL_XFERMODE_M;
+    left = ((control & UDMA_CHCTL_XFERSIZE_M) >> UDMA_CHCTL_XFERSIZE_S) + 1;
+
+    if (mode == UDMA_MODE_STOP)
+    {
+        /* Nothing to do, so the channel turns itself off */
+        g_udma.enabled &= ~bit;
+        g_udma.chis |= bit;
+        return true;
+    }
+
+    if (!(g_udma.alt & bit) && (mode == UDMA_MODE_PERIPH_SG))
+    {
+        return scatter_gather_copy(channel, p_entry);
+    }
+
+    if (((control & UDMA_CHCTL_SRCSIZE_M) >> 24) != ((control & UDMA_CHCTL_DSTSIZE_M) >> 28))
+    {
+        model_error("source and destination widths differ", channel);
+        return false;
+    }
+    width = 1U << ((control & UDMA_CHCTL_SRCSIZE_M) >> 24);
+    src_inc = inc_bytes(control, 26);
+    dst_inc = inc_bytes(control, 30);
+
+    count = MIN(left, 1U << ((control & UDMA_CHCTL_ARBSIZE_M) >> 14));
+    if (channel == UART0_RX_CHANNEL)
+    {
+        count = MIN(count, g_uart.rx_len);
+    }
+    else
+    {
+        count = MIN(count, MODEL_FIFO_LEN - g_uart.tx_len);
+    }
+
+    /* The end pointers are the last item, so work back from them */
+    for (size_t i = 0; i < count; i++, left--)
+    {
+        const uint32_t src = p_entry->src_end - ((left - 1) * src_inc);
+        const uint32_t dst = p_entry->dst_end - ((left - 1) * dst_inc);
+        bus_write(dst, width, bus_read(src, width));
+    }
+
+    if (left)
+    {
+        p_entry->control = (control & ~UDMA_CHCTL_XFERSIZE_M)
+                           | ((uint32_t) (left - 1) << UDMA_CHCTL_XFERSIZE_S);
+        return true;
+    }
+
+    /* Done with this structure */
+    p_entry->control = control & ~(UDMA_CHCTL_XFERSIZE_M | UDMA_CHCTL_XFERMODE_M);
+    switch (mode)
+    {
+    case UDMA_MODE_BASIC:
+        g_udma.chis |= bit;
+        g_udma.enabled &= ~bit;
+        break;
+    case UDMA_MODE_PINGPONG:
+        g_udma.chis |= bit;
+        g_udma.alt ^= bit;
+        if ((p_table[(g_udma.alt & bit) ? (UDMA_NUM_CHANNELS + channel) : channel].control
+             & UDMA_CHCTL_XFERMODE_M) == UDMA_MODE_STOP)
+        {
+            /* The other half isn't ready, so stop */
+            g_udma.enabled &= ~bit;
+        }
+        break;
+    case UDMA_MODE_ALT_PERIPH_SG:
+        /* Back to the primary for the next task */
+        g_udma.alt &= ~bit;
+        if ((p_table[channel].control & UDMA_CHCTL_XFERMODE_M) == UDMA_MODE_STOP)
+        {
+            model_error("scatter-gather ran out of tasks without a basic one", channel);
+            g_udma.chis |= bit;
+            g_udma.enabled &= ~bit;
+        }
+        break;
+    default:
+        model_error("unexpected mode", channel);
+        g_udma.enabled &= ~bit;
+        break;
+    }
+    return true;
+}
+
+static bool udma_request(unsigned int channel)
+{
+    const uint32_t dmactl = g_uart.regs[UART_DMACTL];
+    if (channel == UART0_RX_CHANNEL)
+    {
+        if (!(dmactl & UART_DMACTL_RXDMAE) || (g_uart.rx_len == 0))
+        {
+            return false;
+        }
+        if (g_udma.useburst & (1UL << channel))
+        {
+            /* Only the trigger level's burst request counts */
+            return g_uart.rx_len >= fifo_level(g_uart.regs[UART_IFLS] >> 3);
+        }
+        return true;
+    }
+    return (dmactl & UART_DMACTL_TXDMAE) && (g_uart.tx_len < MODEL_FIFO_LEN);
+}
+
+/*
+ * Peripheral scatter-gather: the primary structure copies the next four
+ * word task in to the alternate structure, which then runs. See [1]
+ * p595.
+ */
+static bool scatter_gather_copy(unsigned int channel, udma_entry_t *p_entry)
+{
+    udma_entry_t *const p_alt =
+        &((udma_entry_t *) (uintptr_t) g_udma.regs[(REG_ADDR(UDMA_CTLBASE_R) - UDMA_BASE) / 4])
+            [UDMA_NUM_CHANNELS + channel];
+    const uint32_t control = p_entry->control;
+    const uint32_t expected = UDMA_CHCTL_DSTINC_32 | UDMA_CHCTL_DSTSIZE_32
+                              | UDMA_CHCTL_SRCINC_32 | UDMA_CHCTL_SRCSIZE_32
+                              | UDMA_CHCTL_ARBSIZE_4;
+    const uint32_t fields = UDMA_CHCTL_DSTINC_M | UDMA_CHCTL_DSTSIZE_M
+                            | UDMA_CHCTL_SRCINC_M | UDMA_CHCTL_SRCSIZE_M
+                            | UDMA_CHCTL_ARBSIZE_M;
+    size_t left = ((control & UDMA_CHCTL_XFERSIZE_M) >> UDMA_CHCTL_XFERSIZE_S) + 1;
+    const uint32_t *p_task;
+
+    if (((control & fields) != expected) || ((left % 4) != 0))
+    {
+        model_error("bad scatter-gather primary control word", channel);
+        g_udma.enabled &= ~(1UL << channel);
+        return false;
+    }
+    if (p_entry->dst_end != (uint32_t) (uintptr_t) &p_alt->unused)
+    {
+        model_error("scatter-gather must copy to the alternate structure", channel);
+        g_udma.enabled &= ~(1UL << channel);
+        return false;
+    }
+
+    p_task = (const uint32_t *) (uintptr_t) (p_entry->src_end - ((left - 1) * 4));
+    p_alt->src_end = p_task[0];
+    p_alt->dst_end = p_task[1];
+    p_alt->control = p_task[2];
+    p_alt->unused = p_task[3];
+    left -= 4;
+
+    if (left)
+    {
+        p_entry->control = (control & ~UDMA_CHCTL_XFERSIZE_M)
+                           | ((uint32_t) (left - 1) << UDMA_CHCTL_XFERSIZE_S);
+    }
+    else
+    {
+        p_entry->control = control & ~(UDMA_CHCTL_XFERSIZE_M | UDMA_CHCTL_XFERMODE_M);
+    }
+    g_udma.alt |= 1UL << channel;
+    return true;
+}
+
+static uint32_t bus_read(uint32_t addr, unsigned int width)
+{
+    uint32_t value = 0;
+    if (addr == (UART0_BASE + (UART_DR * sizeof(reg_t))))
+    {
+        return reg_read(addr, true);
+    }
+    if ((addr & ~(PAGE_LEN - 1)) == UART0_BASE)
+    {
+        model_error("DMA read from a UART register other than DR", 0);
+        return 0;
+    }
+    memcpy(&value, (const void *) (uintptr_t) addr, width);
+    return value;
+}
+
+static void bus_write(uint32_t addr, unsigned int width, uint32_t value)
+{
+    if (addr == (UART0_BASE + (UART_DR * sizeof(reg_t))))
+    {
+        reg_write(addr, value);
+        return;
+    }
+    if ((addr & ~(PAGE_LEN - 1)) == UART0_BASE)
+    {
+        model_error("DMA write to a UART register other than DR", 0);
+        return;
+    }
+    memcpy((void *) (uintptr_t) addr, &value, width);
+}
+
+static size_t inc_bytes(uint32_t control, unsigned int shift)
+{
+    const unsigned int inc = (control >> shift) & 0x3;
+    return (inc == UDMA_INC_NONE) ? 0 : (1U << inc);
+}
+
+static void model_error(const char *p_message, unsigned int channel)
+{
+    fprintf(stderr, "model: channel %u: %s\n", channel, p_message);
+    abort();
+}
+
+/**************************************************
+* End of file
+***************************************************/
@@ -0,0 +1,111 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Host model of the bits of the LM4F120 that the UART and uDMA drivers
+* touch: UART0, the uDMA controller (including its channel control table
+* in RAM) and the clock gating in SYSCTL.
+*
+* The real driver sources are built unchanged. Their registers live at
+* the real addresses, in pages mapped with no access, so every register
+* access traps. The model then behaves as the hardware would for that
+* register (a read of DR pops the RX FIFO, a write to ENASET sets bits,
+* a write to CHIS clears them, and so on) and single steps the access.
+* The test must be linked -no-pie, so the 32-bit addresses the drivers
+* put in the control table reach its static buffers.
+*
+* Nothing happens on its own. model_run() is the passage of time: it
+* moves the TX FIFO out on to the line, lets the uDMA service requests
+* and calls uart0_irq() while UART0's interrupt is enabled and pending.
+*
+*****************************************************/
+
+#ifndef TEST_LM4F120_MODEL_H
+#define TEST_LM4F120_MODEL_H
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+
+/**************************************************
+* Public Defines
+***************************************************/
+
+#define MODEL_FIFO_LEN 16
+
+/* Most bytes model_uart_sent() can hold */
+#define MODEL_SENT_LEN 16384
+
+/**************************************************
+* Public Function Prototypes
+***************************************************/
+
+/*
+ * Map the register pages and install the traps. Call first.
+ */
+void model_init(void);
+
+/*
+ * Bytes arriving on UART0's RX line. Returns how many fitted in the
+ * FIFO; the rest are lost, as an overrun would lose them.
+ */
+size_t model_uart_receive(const uint8_t *p_data, size_t len);
+
+/*
+ * The RX line has been quiet for long enough to raise the receive
+ * timeout, if there's anything in the FIFO.
+ */
+void model_uart_rx_idle(void);
+
+/*
+ * Run until nothing more happens. While interrupts are held (as if
+ * the CPU had them disabled) the DMA still runs but uart0_irq() isn't
+ * called.
+ */
+void model_run(void);
+void model_hold_interrupts(bool hold);
+
+/*
+ * Everything UART0 has transmitted so far. model_clear_sent() starts
+ * again.
+ */
+const uint8_t *model_uart_sent(size_t *p_len);
+void model_clear_sent(void);
+
+/*
+ * The number of bytes waiting in UART0's RX FIFO.
+ */
+size_t model_uart_rx_level(void);
+
+/*
+ * The number of times model_run() has called uart0_irq().
+ */
+unsigned int model_irq_count(void);
+
+#endif /* ndef TEST_LM4F120_MODEL_H */
+
+/**************************************************
+* End of file
+***************************************************/
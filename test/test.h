@@ -0,0 +1,84 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Bare bones checks for the host-built tests in this directory. Each test
+* is a program which returns non-zero if any CHECK() failed.
+*
+*****************************************************/
+
+#ifndef TEST_TEST_H
+#define TEST_TEST_H
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include <stdio.h>
+
+/**************************************************
+* Public Defines
+***************************************************/
+
+/*
+ * Counts and reports a failure, then carries on.
+ */
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) \
+        { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            test_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQUAL(a, b) \
+    do { \
+        long long _a = (long long) (a); \
+        long long _b = (long long) (b); \
+        if (_a != _b) \
+        { \
+            fprintf(stderr, "%s:%d: %s == %s failed (%lld != %lld)\n", \
+                    __FILE__, __LINE__, #a, #b, _a, _b); \
+            test_failures++; \
+        } \
+    } while (0)
+
+/*
+ * Use as the return value of main().
+ */
+#define TEST_RESULT() \
+    (printf("%s: %s\n", __FILE__, test_failures ? "FAILED" : "passed"), \
+     (test_failures != 0))
+
+/**************************************************
+* Public Data
+**************************************************/
+
+static unsigned int test_failures;
+
+#endif /* ndef TEST_TEST_H */
+
+/**************************************************
+* End of file
+***************************************************/
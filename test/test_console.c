@@ -0,0 +1,238 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*
+* Host test for console, drawing on the simulated LCD (lcd_sim.c), which
+* writes what it draws to a file. Checks that printing before
+* console_init() is harmless, that text is drawn a bit at a time and
+* that the screen scrolls.
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/util.h"
+#include "drivers/lcd/lcd.h"
+#include "font/font.h"
+#include "console/console.h"
+
+#include "test.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+#define LINE_LEN 256
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+static void test_before_init(void);
+static void test_drawing(void);
+static void test_overflow(void);
+static void test_scrolling(void);
+
+static unsigned int drain(void);
+static void mark(void);
+static unsigned int count_since_mark(const char *p_prefix);
+
+/**************************************************
+* Public Data
+**************************************************/
+
+/* Where lcd_sim.c writes what it draws */
+FILE *f;
+
+/**************************************************
+* Private Data
+**************************************************/
+
+static long g_mark;
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+int main(void)
+{
+    f = tmpfile();
+    if (!f)
+    {
+        perror("tmpfile");
+        return 1;
+    }
+
+    test_before_init();
+    console_init();
+    test_drawing();
+    test_overflow();
+    test_scrolling();
+
+    fclose(f);
+    return TEST_RESULT();
+}
+
+/* lcd_sim.c's lcd_init() waits for the panel */
+void delay_ms(uint32_t delay)
+{
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+/*
+ * printf can call console_write() before main.c gets to console_init().
+ */
+static void test_before_init(void)
+{
+    mark();
+    CHECK_EQUAL(console_write("Wait...\n", 8), 0);
+    console_service();
+    CHECK_EQUAL(count_since_mark("bitmap"), 0);
+}
+
+static void test_drawing(void)
+{
+    static const char text[] = "Hello, world!\n";
+    const size_t len = strlen(text);
+
+    CHECK_EQUAL(console_write(text, len), len);
+    mark();
+    /* A glyph per printable character */
+    drain();
+    CHECK_EQUAL(count_since_mark("bitmap"), len - 1);
+
+    /* More than one call's worth takes several calls */
+    char long_line[(3 * CONSOLE_CHARS_PER_SERVICE) + 1];
+    memset(long_line, 'x', sizeof(long_line) - 1);
+    long_line[sizeof(long_line) - 1] = '\n';
+    CHECK_EQUAL(console_write(long_line, sizeof(long_line)), sizeof(long_line));
+    CHECK(drain() >= 3);
+}
+
+/*
+ * Whatever doesn't fit is dropped, and the rest still gets drawn.
+ */
+static void test_overflow(void)
+{
+    static char text[CONSOLE_BUFFER_LEN + 100];
+    for (size_t i = 0; i < sizeof(text); i++)
+    {
+        text[i] = ((i % 40) == 39) ? '\n' : (char) ('a' + (i % 26));
+    }
+    CHECK_EQUAL(console_write(text, sizeof(text)), CONSOLE_BUFFER_LEN);
+    CHECK_EQUAL(console_write("x", 1), 0);
+    CHECK(drain() >= (CONSOLE_BUFFER_LEN / CONSOLE_CHARS_PER_SERVICE));
+    CHECK_EQUAL(console_write("x\n", 2), 2);
+    drain();
+}
+
+/*
+ * Once the screen's full, each new line scrolls it by one line, or with
+ * the LCD tall wraps round to the top.
+ */
+static void test_scrolling(void)
+{
+    unsigned int width, height;
+    font_get_size_small(&width, &height);
+    const unsigned int rows = (1 + LCD_LAST_ROW - LCD_FIRST_ROW) / height;
+
+    for (unsigned int i = 0; i < rows; i++)
+    {
+        CHECK_EQUAL(console_write("line\n", 5), 5);
+        drain();
+    }
+    mark();
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        CHECK_EQUAL(console_write("more\n", 5), 5);
+        drain();
+    }
+    /* Either way, one row is cleared per line */
+    CHECK_EQUAL(count_since_mark("box"), 3);
+#ifdef LCD_ROTATE_DISPLAY
+    CHECK_EQUAL(count_since_mark("scroll_to"), 0);
+#else
+    CHECK_EQUAL(count_since_mark("scroll_to"), 3);
+#endif
+}
+
+/*
+ * Calls console_service() until it stops drawing.
+ *
+ * @return how many calls drew something
+ */
+static unsigned int drain(void)
+{
+    unsigned int calls = 0;
+    long before = ftell(f);
+    while (1)
+    {
+        console_service();
+        if (ftell(f) == before)
+        {
+            return calls;
+        }
+        before = ftell(f);
+        calls++;
+    }
+}
+
+static void mark(void)
+{
+    fflush(f);
+    g_mark = ftell(f);
+}
+
+/*
+ * @return how many lines lcd_sim.c has written since mark() that start
+ *         with p_prefix
+ */
+static unsigned int count_since_mark(const char *p_prefix)
+{
+    char line[LINE_LEN];
+    unsigned int count = 0;
+    const long end = ftell(f);
+    fseek(f, g_mark, SEEK_SET);
+    while ((ftell(f) < end) && fgets(line, sizeof(line), f))
+    {
+        if (strncmp(line, p_prefix, strlen(p_prefix)) == 0)
+        {
+            count++;
+        }
+    }
+    fseek(f, end, SEEK_SET);
+    return count;
+}
+
+/**************************************************
+* End of file
+***************************************************/
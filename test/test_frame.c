@@ -0,0 +1,405 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*
+* Host round trip test for frame. Frames are encoded, sent through a pipe
+* (standing in for the serial link) and read back a few bytes at a time
+* in to the decoder, which must hand back exactly what was sent. Damaged
+* frames must be counted and dropped without upsetting the frames around
+* them.
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "util/util.h"
+#include "frame/frame.h"
+
+#include "test.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+#define MAX_PAYLOAD 1024
+
+/* Odd, so reads split the COBS blocks in different places */
+#define READ_CHUNK 7
+
+/* Big enough for a few frames, and less than a pipe holds */
+#define WIRE_LEN 8192
+
+#define CHANNEL 5
+
+/**************************************************
+* Data Types
+**************************************************/
+
+/* None */
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+static void test_round_trips(void);
+static void test_block_boundaries(void);
+static void test_pieces(void);
+static void test_bad_crc(void);
+static void test_truncated(void);
+static void test_too_long(void);
+
+static void send_frame(const uint8_t *p_payload, size_t len);
+static void transmit(void);
+static void check_round_trip(const uint8_t *p_payload, size_t len);
+static void fill(uint8_t *p_payload, size_t len, int pattern);
+static void on_output(const uint8_t *p_data, size_t len, void *p_context);
+static void on_frame(uint8_t channel, const uint8_t *p_payload, size_t len, void *p_context);
+
+/**************************************************
+* Private Data
+**************************************************/
+
+static int g_pipe[2];
+
+static struct frame_encoder_t g_enc;
+static struct frame_decoder_t g_dec;
+static uint8_t g_dec_buffer[MAX_PAYLOAD + FRAME_OVERHEAD];
+
+/* What the encoder has produced, waiting to go through the pipe */
+static uint8_t g_wire[WIRE_LEN];
+static size_t g_wire_len;
+
+/* The last frame the decoder gave us */
+static uint8_t g_rx[MAX_PAYLOAD];
+static size_t g_rx_len;
+static uint8_t g_rx_channel;
+static unsigned int g_rx_count;
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+int main(void)
+{
+    if (pipe(g_pipe) != 0)
+    {
+        perror("pipe");
+        return 1;
+    }
+    frame_encoder_init(&g_enc, on_output, NULL);
+    frame_decoder_init(&g_dec, g_dec_buffer, sizeof(g_dec_buffer), on_frame, NULL);
+
+    test_round_trips();
+    test_block_boundaries();
+    test_pieces();
+    test_bad_crc();
+    test_truncated();
+    test_too_long();
+
+    CHECK_EQUAL(g_dec.good, g_rx_count);
+    return TEST_RESULT();
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+/*
+ * Various lengths of all zeros, mostly zeros, no zeros at all and noise.
+ */
+static void test_round_trips(void)
+{
+    static const size_t lens[] = { 0, 1, 2, 3, 100, 252, 253, 254, 255, 256, 507, 508, 509, MAX_PAYLOAD };
+    uint8_t payload[MAX_PAYLOAD];
+    for (int pattern = 0; pattern < 4; pattern++)
+    {
+        for (size_t i = 0; i < NUMELTS(lens); i++)
+        {
+            fill(payload, lens[i], pattern);
+            send_frame(payload, lens[i]);
+            check_round_trip(payload, lens[i]);
+        }
+    }
+}
+
+/*
+ * Runs of non-zero bytes either side of COBS's 254 byte block, with and
+ * without a zero straight after them. The channel byte starts the first
+ * run, so a payload of n non-zero bytes makes a run of n + 1.
+ */
+static void test_block_boundaries(void)
+{
+    uint8_t payload[MAX_PAYLOAD];
+    for (size_t run = 250; run <= 260; run++)
+    {
+        const size_t payload_run = run - 1;
+        fill(payload, payload_run, 2);
+        send_frame(payload, payload_run);
+        check_round_trip(payload, payload_run);
+
+        payload[payload_run] = 0;
+        payload[payload_run + 1] = 0x42;
+        send_frame(payload, payload_run + 2);
+        check_round_trip(payload, payload_run + 2);
+
+        /* Two full blocks back to back, then a zero */
+        fill(payload, payload_run + FRAME_COBS_BLOCK, 2);
+        payload[payload_run + FRAME_COBS_BLOCK] = 0;
+        send_frame(payload, payload_run + FRAME_COBS_BLOCK + 1);
+        check_round_trip(payload, payload_run + FRAME_COBS_BLOCK + 1);
+    }
+}
+
+/*
+ * A payload given to the encoder in uneven pieces comes out whole.
+ */
+static void test_pieces(void)
+{
+    uint8_t payload[600];
+    fill(payload, sizeof(payload), 3);
+    frame_encoder_start(&g_enc, CHANNEL);
+    for (size_t done = 0, piece = 1; done < sizeof(payload); piece = (piece * 3) + 1)
+    {
+        const size_t len = MIN(piece, sizeof(payload) - done);
+        frame_encoder_add(&g_enc, &payload[done], len);
+        done += len;
+    }
+    frame_encoder_finish(&g_enc);
+    transmit();
+    check_round_trip(payload, sizeof(payload));
+}
+
+/*
+ * Flip a bit in each byte of a frame in turn. Whatever happens to the
+ * COBS structure, it must never get through, and the next frame must.
+ */
+static void test_bad_crc(void)
+{
+    uint8_t payload[40];
+    uint8_t good[FRAME_MAX_ENCODED(sizeof(payload))];
+    fill(payload, sizeof(payload), 1);
+
+    g_wire_len = 0;
+    frame_encoder_send(&g_enc, CHANNEL, payload, sizeof(payload));
+    const size_t good_len = g_wire_len;
+    memcpy(good, g_wire, good_len);
+
+    /* Leave the delimiter alone */
+    for (size_t i = 0; i < good_len - 1; i++)
+    {
+        const uint32_t errors = g_dec.bad_crc + g_dec.bad_frame;
+        const unsigned int count = g_rx_count;
+
+        memcpy(g_wire, good, good_len);
+        g_wire[i] ^= 0x10;
+        g_wire_len = good_len;
+        transmit();
+        CHECK_EQUAL(g_rx_count, count);
+        CHECK_EQUAL(g_dec.bad_crc + g_dec.bad_frame, errors + 1);
+
+        send_frame(payload, sizeof(payload));
+        check_round_trip(payload, sizeof(payload));
+    }
+
+    /* Payload intact, CRC wrong */
+    const uint32_t bad_crc = g_dec.bad_crc;
+    memcpy(g_wire, good, good_len);
+    g_wire[good_len - 2] ^= 0x01;
+    g_wire_len = good_len;
+    transmit();
+    CHECK_EQUAL(g_dec.bad_crc, bad_crc + 1);
+}
+
+/*
+ * Frames cut off at every length, as if the link dropped out. The next
+ * delimiter ends each one, and the frame after it is fine.
+ */
+static void test_truncated(void)
+{
+    uint8_t payload[300];
+    uint8_t good[FRAME_MAX_ENCODED(sizeof(payload))];
+    fill(payload, sizeof(payload), 1);
+
+    g_wire_len = 0;
+    frame_encoder_send(&g_enc, CHANNEL, payload, sizeof(payload));
+    const size_t good_len = g_wire_len;
+    memcpy(good, g_wire, good_len);
+
+    for (size_t cut = 1; cut < good_len - 1; cut++)
+    {
+        const uint32_t errors = g_dec.bad_crc + g_dec.bad_frame;
+        const unsigned int count = g_rx_count;
+
+        memcpy(g_wire, good, cut);
+        g_wire[cut] = FRAME_DELIMITER;
+        g_wire_len = cut + 1;
+        transmit();
+        CHECK_EQUAL(g_rx_count, count);
+        CHECK_EQUAL(g_dec.bad_crc + g_dec.bad_frame, errors + 1);
+
+        send_frame(payload, sizeof(payload));
+        check_round_trip(payload, sizeof(payload));
+    }
+
+    /* Starting mid-frame, we pick up at the next delimiter */
+    memcpy(g_wire, &good[good_len / 2], good_len - (good_len / 2));
+    g_wire_len = good_len - (good_len / 2);
+    transmit();
+    send_frame(payload, sizeof(payload));
+    check_round_trip(payload, sizeof(payload));
+}
+
+/*
+ * A frame too big for the decoder's buffer is dropped.
+ */
+static void test_too_long(void)
+{
+    static uint8_t payload[MAX_PAYLOAD + 1];
+    const uint32_t bad_frame = g_dec.bad_frame;
+    const unsigned int count = g_rx_count;
+    fill(payload, sizeof(payload), 3);
+    send_frame(payload, sizeof(payload));
+    CHECK_EQUAL(g_rx_count, count);
+    CHECK_EQUAL(g_dec.bad_frame, bad_frame + 1);
+
+    send_frame(payload, MAX_PAYLOAD);
+    check_round_trip(payload, MAX_PAYLOAD);
+}
+
+/*
+ * Encode a frame, check what's on the wire, and send it.
+ */
+static void send_frame(const uint8_t *p_payload, size_t len)
+{
+    g_wire_len = 0;
+    frame_encoder_send(&g_enc, CHANNEL, p_payload, len);
+
+    CHECK(g_wire_len <= FRAME_MAX_ENCODED(len));
+    CHECK(g_wire_len > 0);
+    CHECK_EQUAL(g_wire[g_wire_len - 1], FRAME_DELIMITER);
+    CHECK(memchr(g_wire, FRAME_DELIMITER, g_wire_len) == &g_wire[g_wire_len - 1]);
+
+    transmit();
+}
+
+/*
+ * Push g_wire through the pipe and feed the other end to the decoder.
+ */
+static void transmit(void)
+{
+    const uint8_t *p = g_wire;
+    size_t left = g_wire_len;
+    while (left)
+    {
+        const ssize_t written = write(g_pipe[1], p, left);
+        if (written <= 0)
+        {
+            perror("write");
+            exit(1);
+        }
+        p += written;
+        left -= (size_t) written;
+    }
+
+    left = g_wire_len;
+    while (left)
+    {
+        uint8_t chunk[READ_CHUNK];
+        const ssize_t got = read(g_pipe[0], chunk, MIN(left, sizeof(chunk)));
+        if (got <= 0)
+        {
+            perror("read");
+            exit(1);
+        }
+        frame_decoder_feed(&g_dec, chunk, (size_t) got);
+        left -= (size_t) got;
+    }
+    g_wire_len = 0;
+}
+
+static void check_round_trip(const uint8_t *p_payload, size_t len)
+{
+    static unsigned int expected;
+    expected++;
+    CHECK_EQUAL(g_rx_count, expected);
+    CHECK_EQUAL(g_rx_channel, CHANNEL);
+    CHECK_EQUAL(g_rx_len, len);
+    CHECK((g_rx_len == len) && (memcmp(g_rx, p_payload, len) == 0));
+    /* Carry on from here if that went wrong */
+    expected = g_rx_count;
+}
+
+/*
+ * 0: all zeros, 1: mostly zeros, 2: no zeros, 3: noise
+ */
+static void fill(uint8_t *p_payload, size_t len, int pattern)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        switch (pattern)
+        {
+        case 0:
+            p_payload[i] = 0;
+            break;
+        case 1:
+            p_payload[i] = (i % 5) ? 0 : (uint8_t) i;
+            break;
+        case 2:
+            p_payload[i] = (uint8_t) ((i % 255) + 1);
+            break;
+        default:
+            p_payload[i] = (uint8_t) rand();
+            break;
+        }
+    }
+}
+
+static void on_output(const uint8_t *p_data, size_t len, void *p_context)
+{
+    if (g_wire_len + len > sizeof(g_wire))
+    {
+        fprintf(stderr, "Frame too big for the test\n");
+        exit(1);
+    }
+    memcpy(&g_wire[g_wire_len], p_data, len);
+    g_wire_len += len;
+}
+
+static void on_frame(uint8_t channel, const uint8_t *p_payload, size_t len, void *p_context)
+{
+    g_rx_channel = channel;
+    g_rx_len = len;
+    memcpy(g_rx, p_payload, len);
+    g_rx_count++;
+}
+
+/**************************************************
+* End of file
+***************************************************/
@@ -0,0 +1,180 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Host test for the LCD driver's bus usage. lcd.c is built with
+* LCD_BUS_STATS, which counts every data bus write and WR strobe, and
+* its GPIO ports are plain memory. Checks that runs of uniform (grey)
+* pixels only put the colour on the bus once, and that anything else
+* still writes every byte.
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "util/util.h"
+#include "drivers/misc/misc.h"
+#include "drivers/gpio/gpio.h"
+#include "drivers/lcd/lcd.h"
+
+#include "test.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+#define PAGE_LEN 4096
+
+/* 8-bit bus, so three strobes a pixel */
+#define STROBES_PER_PIXEL 3
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+static void map_gpio(void);
+static void test_fill(void);
+static void test_mono(void);
+static uint32_t saved(lcd_colour_t colour, unsigned int width, unsigned int height);
+static uint32_t saved_mono(lcd_colour_t fg, uint8_t row_pattern);
+
+/**************************************************
+* Private Data
+**************************************************/
+
+/* The ports lcd.c's pins are on */
+static const uintptr_t g_pages[] = {
+    (uintptr_t) GPIO_PORTA_DATA_BITS_R,
+    (uintptr_t) GPIO_PORTB_DATA_BITS_R,
+    (uintptr_t) GPIO_PORTD_DATA_BITS_R,
+    (uintptr_t) GPIO_PORTE_DATA_BITS_R
+};
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+int main(void)
+{
+    map_gpio();
+    test_fill();
+    test_mono();
+    return TEST_RESULT();
+}
+
+/* lcd.c sets up its pins with these, which we can do without */
+void gpio_make_output(gpio_io_pin_t pin, int level)
+{
+}
+
+void gpio_make_input(gpio_io_pin_t pin)
+{
+}
+
+void gpio_set_output(gpio_io_pin_t pin, int level)
+{
+}
+
+void delay_ms(uint32_t delay)
+{
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+/*
+ * lcd.c writes straight to the GPIO data registers, so give it some
+ * memory at those addresses.
+ */
+static void map_gpio(void)
+{
+    for (unsigned int i = 0; i < NUMELTS(g_pages); i++)
+    {
+        void *const p = mmap((void *) g_pages[i], PAGE_LEN, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+        if (p != (void *) g_pages[i])
+        {
+            fprintf(stderr, "can't map 0x%08lx\n", (unsigned long) g_pages[i]);
+            exit(1);
+        }
+    }
+}
+
+static void test_fill(void)
+{
+    /* A grey fill puts the colour on the bus once, then just strobes */
+    CHECK_EQUAL(saved(LCD_WHITE, 10, 10), (100 * STROBES_PER_PIXEL) - 1);
+    CHECK_EQUAL(saved(LCD_BLACK, LCD_LAST_COLUMN + 1, LCD_LAST_ROW + 1),
+                (LCD_WIDTH * LCD_HEIGHT * STROBES_PER_PIXEL) - 1);
+    CHECK_EQUAL(saved(MAKE_COLOUR(0x40, 0x40, 0x40), 1, 1), STROBES_PER_PIXEL - 1);
+    /* Any other colour writes every byte */
+    CHECK_EQUAL(saved(LCD_RED, 10, 10), 0);
+    CHECK_EQUAL(saved(MAKE_COLOUR(0x40, 0x40, 0x41), 10, 10), 0);
+}
+
+static void test_mono(void)
+{
+    /* All background: one write for the whole glyph */
+    CHECK_EQUAL(saved_mono(LCD_WHITE, 0x00), (64 * STROBES_PER_PIXEL) - 1);
+    /* Four pixels of each colour: a write every time it changes */
+    CHECK_EQUAL(saved_mono(LCD_WHITE, 0xF0), (64 * STROBES_PER_PIXEL) - 16);
+    /* A colour that isn't grey writes every byte */
+    CHECK_EQUAL(saved_mono(LCD_RED, 0xF0), 0);
+}
+
+/*
+ * @return how many strobes didn't need a write, filling a rectangle
+ */
+static uint32_t saved(lcd_colour_t colour, unsigned int width, unsigned int height)
+{
+    struct lcd_bus_stats_t stats;
+    lcd_reset_bus_stats();
+    lcd_paint_fill_rectangle(colour, 0, width - 1, 0, height - 1);
+    lcd_get_bus_stats(&stats);
+    return stats.strobes - stats.writes;
+}
+
+/*
+ * @return how many strobes didn't need a write, painting an 8x8 glyph
+ * on black with every row the same
+ */
+static uint32_t saved_mono(lcd_colour_t fg, uint8_t row_pattern)
+{
+    struct lcd_bus_stats_t stats;
+    uint8_t pixels[8];
+    memset(pixels, row_pattern, sizeof(pixels));
+    lcd_reset_bus_stats();
+    lcd_paint_mono_rectangle(fg, LCD_BLACK, 0, 7, 0, 7, pixels);
+    lcd_get_bus_stats(&stats);
+    return stats.strobes - stats.writes;
+}
+
+/**************************************************
+* End of file
+***************************************************/
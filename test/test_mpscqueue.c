@@ -0,0 +1,252 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Host test for mpscqueue. Checks the basics from one thread, then has
+* several producer threads race through the __sync compare-and-swap path
+* (standing in for interrupts at different priorities) while the main
+* thread pops. Every element must come out exactly once, and each
+* producer's elements must come out in the order it pushed them.
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "util/util.h"
+#include "mpscqueue/mpscqueue.h"
+#include "mpscqueue/recordring.h"
+
+#include "test.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+#define PRODUCERS 4
+#define PUSHES_PER_PRODUCER 200000UL
+
+/* Give up if nothing comes out for this long - an element went missing */
+#define STALL_SECONDS 5
+
+/* Small, so the producers collide and the queue often fills */
+#define CAPACITY 16
+
+/**************************************************
+* Data Types
+**************************************************/
+
+struct elem_t
+{
+    uint32_t producer;
+    uint32_t count;
+};
+
+RECORDRING_DEFINE(elem_ring, struct elem_t, CAPACITY)
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+static void test_basics(void);
+static void test_producers(void);
+static void test_recordring(void);
+static void *producer(void *p_arg);
+
+/**************************************************
+* Private Data
+**************************************************/
+
+static struct mpscqueue_t g_queue;
+static struct elem_t g_elems[CAPACITY];
+static uint32_t g_seq[CAPACITY];
+
+/* Pushes each producer saw fail because the queue was full */
+static unsigned long g_full[PRODUCERS];
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+int main(void)
+{
+    test_basics();
+    test_producers();
+    test_recordring();
+    return TEST_RESULT();
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+static void test_basics(void)
+{
+    struct elem_t in = { 0, 0 };
+    struct elem_t out;
+
+    CHECK(!mpscqueue_init(&g_queue, g_elems, sizeof(g_elems[0]), g_seq, 12));
+    CHECK(mpscqueue_init(&g_queue, g_elems, sizeof(g_elems[0]), g_seq, CAPACITY));
+    CHECK(mpscqueue_isempty(&g_queue));
+    CHECK(!mpscqueue_pop(&g_queue, &out));
+
+    /* Fill it, then one more is dropped */
+    for (uint32_t i = 0; i < CAPACITY; i++)
+    {
+        in.count = i;
+        CHECK(mpscqueue_push(&g_queue, &in));
+    }
+    CHECK(!mpscqueue_push(&g_queue, &in));
+    CHECK_EQUAL(g_queue.dropped, 1);
+
+    /* Several laps round the slots, half full, in order */
+    for (uint32_t i = 0; i < 10 * CAPACITY; i++)
+    {
+        CHECK(mpscqueue_pop(&g_queue, &out));
+        CHECK_EQUAL(out.count, i);
+        if (i < 9 * CAPACITY)
+        {
+            in.count = i + CAPACITY;
+            CHECK(mpscqueue_push(&g_queue, &in));
+        }
+    }
+    CHECK(mpscqueue_isempty(&g_queue));
+}
+
+/*
+ * The typed wrapper, which only has to hand the right sizes down.
+ */
+static void test_recordring(void)
+{
+    static struct elem_ring_t ring;
+    struct elem_t in = { 1, 0 };
+    struct elem_t out;
+
+    CHECK(!elem_ring_isready(&ring));
+    elem_ring_init(&ring);
+    CHECK(elem_ring_isready(&ring));
+    CHECK(elem_ring_isempty(&ring));
+
+    for (uint32_t i = 0; i < CAPACITY; i++)
+    {
+        in.count = i;
+        CHECK(elem_ring_push(&ring, &in));
+    }
+    CHECK(!elem_ring_push(&ring, &in));
+    CHECK_EQUAL(ring.queue.dropped, 1);
+
+    for (uint32_t i = 0; i < CAPACITY; i++)
+    {
+        CHECK(elem_ring_pop(&ring, &out));
+        CHECK_EQUAL(out.producer, 1);
+        CHECK_EQUAL(out.count, i);
+    }
+    CHECK(!elem_ring_pop(&ring, &out));
+}
+
+static void test_producers(void)
+{
+    pthread_t threads[PRODUCERS];
+    uint32_t ids[PRODUCERS];
+    uint32_t next[PRODUCERS] = { 0 };
+    unsigned long popped = 0;
+    unsigned long full = 0;
+    time_t last_pop = time(NULL);
+
+    CHECK(mpscqueue_init(&g_queue, g_elems, sizeof(g_elems[0]), g_seq, CAPACITY));
+
+    for (uint32_t i = 0; i < PRODUCERS; i++)
+    {
+        ids[i] = i;
+        CHECK(pthread_create(&threads[i], NULL, producer, &ids[i]) == 0);
+    }
+
+    while (popped < (PRODUCERS * PUSHES_PER_PRODUCER))
+    {
+        struct elem_t out;
+        if (!mpscqueue_pop(&g_queue, &out))
+        {
+            /* Empty, or the oldest slot is reserved but not written yet */
+            sched_yield();
+            if ((time(NULL) - last_pop) > STALL_SECONDS)
+            {
+                fprintf(stderr, "stalled after %lu elements\n", popped);
+                CHECK(false);
+                /* The producers may never finish, so don't join them */
+                exit(TEST_RESULT());
+            }
+            continue;
+        }
+        last_pop = time(NULL);
+        popped++;
+        if (out.producer >= PRODUCERS)
+        {
+            CHECK(out.producer < PRODUCERS);
+            continue;
+        }
+        /* Nothing lost, duplicated or re-ordered within a producer */
+        CHECK_EQUAL(out.count, next[out.producer]);
+        next[out.producer] = out.count + 1;
+    }
+
+    for (uint32_t i = 0; i < PRODUCERS; i++)
+    {
+        pthread_join(threads[i], NULL);
+        CHECK_EQUAL(next[i], PUSHES_PER_PRODUCER);
+        full += g_full[i];
+    }
+    CHECK(mpscqueue_isempty(&g_queue));
+    /* The shared drop counter is bumped with the same CAS */
+    CHECK_EQUAL(g_queue.dropped, full);
+    printf("%lu elements from %u producers, %lu pushes found it full\n",
+           popped, PRODUCERS, full);
+}
+
+static void *producer(void *p_arg)
+{
+    const uint32_t id = *(const uint32_t *) p_arg;
+    struct elem_t elem = { id, 0 };
+    while (elem.count < PUSHES_PER_PRODUCER)
+    {
+        if (mpscqueue_push(&g_queue, &elem))
+        {
+            elem.count++;
+        }
+        else
+        {
+            g_full[id]++;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/**************************************************
+* End of file
+***************************************************/
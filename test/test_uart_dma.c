@@ -0,0 +1,355 @@
+/*****************************************************
+*
+* Stellaris Launchpad Example Project
+*
+* Copyright (c) 2014 theJPster (www.thejpster.org.uk)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+* Host test for the UART driver's DMA mode, against the register model
+* in lm4f120_model.c: ping-pong receive (including the receive timeout
+* and a late interrupt) and multi-task scatter-gather transmit.
+*
+*****************************************************/
+
+/**************************************************
+* Includes
+***************************************************/
+
+#include "util/util.h"
+#include "drivers/misc/misc.h"
+#include "drivers/uart/uart.h"
+#include "drivers/udma/udma.h"
+
+#include "lm4f120_model.h"
+#include "test.h"
+
+/**************************************************
+* Defines
+***************************************************/
+
+#define RX_HALF_LEN 32
+#define RX_CHANNEL 8
+#define TX_CHANNEL 9
+
+/* Bytes arrive at most this many at a time between model_run()s */
+#define RX_PIECE_LEN 8
+
+/**************************************************
+* Data Types
+**************************************************/
+
+struct delivery_t
+{
+    const char *p_data;
+    size_t len;
+};
+
+/**************************************************
+* Function Prototypes
+**************************************************/
+
+static void test_rx_pingpong(void);
+static void test_rx_late_interrupt(void);
+static void test_tx_scatter_gather(void);
+static void receive(size_t len);
+static void check_received(void);
+static int half_of(const char *p_data);
+static void clear_deliveries(void);
+static void on_receive(uart_id_t uart_id, const char *p_data, size_t len);
+
+/**************************************************
+* Private Data
+**************************************************/
+
+/* Static, so the DMA's 32-bit addresses reach them (see the Makefile) */
+static uint8_t g_ping[RX_HALF_LEN];
+static uint8_t g_pong[RX_HALF_LEN];
+
+static uint8_t g_sent_on_line[1024];
+static size_t g_sent_on_line_len;
+
+static uint8_t g_received[1024];
+static size_t g_received_len;
+
+static struct delivery_t g_deliveries[64];
+static size_t g_num_deliveries;
+
+static uint8_t g_tx_buffer[64];
+static uint8_t g_header[10];
+static uint8_t g_body[2500];
+static uint8_t g_trailer[1];
+
+/**************************************************
+* Public Functions
+***************************************************/
+
+int main(void)
+{
+    model_init();
+
+    CHECK_EQUAL(uart_init(UART_ID_0, 115200, UART_PARITY_NONE, UART_DATABITS_8,
+                          UART_STOPBITS_1, on_receive), UART_OK);
+    CHECK_EQUAL(uart_set_tx_buffer(UART_ID_0, g_tx_buffer, sizeof(g_tx_buffer),
+                                   UART_TX_FULL_BLOCK), UART_OK);
+
+    test_rx_pingpong();
+    test_rx_late_interrupt();
+    /* With receive still running, so both channels are in use */
+    test_tx_scatter_gather();
+
+    CHECK_EQUAL(uart_dma_rx_stop(UART_ID_0), UART_OK);
+    CHECK(!udma_channel_enabled(RX_CHANNEL));
+
+    return TEST_RESULT();
+}
+
+/**************************************************
+* Private Functions
+***************************************************/
+
+static void test_rx_pingpong(void)
+{
+    const udma_entry_t *const p_ping = udma_primary(RX_CHANNEL);
+    const udma_entry_t *const p_pong = udma_alternate(RX_CHANNEL);
+
+    CHECK_EQUAL(uart_dma_rx_start(UART_ID_0, g_ping, g_pong, RX_HALF_LEN), UART_OK);
+    CHECK(udma_channel_enabled(RX_CHANNEL));
+
+    /* Both halves armed: DR to the buffer, bytes, ping-pong */
+    CHECK_EQUAL(p_ping->src_end, 0x4000C000);
+    CHECK_EQUAL(p_ping->dst_end, (uintptr_t) &g_ping[RX_HALF_LEN - 1]);
+    CHECK_EQUAL(p_pong->dst_end, (uintptr_t) &g_pong[RX_HALF_LEN - 1]);
+    CHECK_EQUAL(p_ping->control & UDMA_CHCTL_XFERMODE_M, UDMA_MODE_PINGPONG);
+    CHECK_EQUAL(udma_remaining(p_ping), RX_HALF_LEN);
+    CHECK_EQUAL(udma_remaining(p_pong), RX_HALF_LEN);
+
+    /* Fill ping and some of pong. Only ping is handed over. */
+    receive(RX_HALF_LEN + 16);
+    CHECK_EQUAL(g_num_deliveries, 1);
+    CHECK(g_deliveries[0].p_data == (const char *) g_ping);
+    CHECK_EQUAL(g_deliveries[0].len, RX_HALF_LEN);
+    /* Ping was re-armed and pong is running */
+    CHECK_EQUAL(udma_remaining(p_ping), RX_HALF_LEN);
+    CHECK_EQUAL((UDMA_ALTSET_R >> RX_CHANNEL) & 1, 1);
+
+    /* The line goes quiet: what's in pong, then what's in the FIFO */
+    clear_deliveries();
+    model_uart_rx_idle();
+    model_run();
+    CHECK_EQUAL(model_uart_rx_level(), 0);
+    CHECK(g_num_deliveries >= 1);
+    CHECK(g_deliveries[0].p_data == (const char *) g_pong);
+    check_received();
+
+    /* Finish pong. Only the rest of it is handed over, not it all again. */
+    clear_deliveries();
+    receive(RX_HALF_LEN);
+    CHECK(g_num_deliveries >= 1);
+    CHECK(g_deliveries[0].p_data > (const char *) g_pong);
+    CHECK(g_deliveries[0].p_data < (const char *) &g_pong[RX_HALF_LEN]);
+    CHECK_EQUAL((UDMA_ALTSET_R >> RX_CHANNEL) & 1, 0);
+    model_uart_rx_idle();
+    model_run();
+    check_received();
+
+    /*
+     * A message which is a whole number of DMA bursts must still time
+     * out, or it sits in the buffer until more arrives.
+     */
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        receive(RX_PIECE_LEN);
+        model_uart_rx_idle();
+        model_run();
+        check_received();
+    }
+}
+
+static void test_rx_late_interrupt(void)
+{
+    /* The half that's filling now is the older one */
+    const int older = (int) ((UDMA_ALTSET_R >> RX_CHANNEL) & 1);
+
+    /*
+     * The interrupt is held off (as if interrupts were disabled) while
+     * both halves fill, so the DMA stops with bytes still in the FIFO.
+     */
+    clear_deliveries();
+    model_hold_interrupts(true);
+    receive(3 * RX_HALF_LEN);
+    CHECK(!udma_channel_enabled(RX_CHANNEL));
+    CHECK_EQUAL(g_num_deliveries, 0);
+
+    model_hold_interrupts(false);
+    model_uart_rx_idle();
+    model_run();
+    CHECK(udma_channel_enabled(RX_CHANNEL));
+
+    /* Older half, newer half, then the FIFO */
+    CHECK(g_num_deliveries >= 3);
+    CHECK_EQUAL(half_of(g_deliveries[0].p_data), older);
+    CHECK_EQUAL(half_of(g_deliveries[1].p_data), !older);
+    CHECK_EQUAL(g_deliveries[1].len, RX_HALF_LEN);
+    CHECK_EQUAL(half_of(g_deliveries[2].p_data), -1);
+    check_received();
+}
+
+static void test_tx_scatter_gather(void)
+{
+    const uart_dma_segment_t segments[] = {
+        { g_header, sizeof(g_header) },
+        { g_body, sizeof(g_body) },
+        { g_trailer, sizeof(g_trailer) }
+    };
+    static uint8_t too_big[UART_DMA_MAX_TASKS * UDMA_MAX_TRANSFER + 1];
+    const uart_dma_segment_t too_many[] = { { too_big, sizeof(too_big) } };
+    const udma_entry_t *const p_primary = udma_primary(TX_CHANNEL);
+    const uint8_t *p_sent;
+    size_t sent_len;
+
+    for (size_t i = 0; i < sizeof(g_header); i++)
+    {
+        g_header[i] = 'h';
+    }
+    for (size_t i = 0; i < sizeof(g_body); i++)
+    {
+        g_body[i] = (uint8_t) i;
+    }
+    g_trailer[0] = 't';
+
+    CHECK_EQUAL(uart_dma_write(UART_ID_0, too_many, NUMELTS(too_many)), UART_ERROR_INVALID_BUFFER);
+
+    model_clear_sent();
+    CHECK_EQUAL(uart_dma_write(UART_ID_0, segments, NUMELTS(segments)), UART_OK);
+    CHECK(uart_dma_write_busy(UART_ID_0));
+    CHECK(udma_channel_enabled(RX_CHANNEL));
+    CHECK(udma_channel_enabled(TX_CHANNEL));
+
+    /* 10 + 2500 + 1 bytes is five tasks (the body split at 1024) */
+    CHECK_EQUAL(p_primary->control & UDMA_CHCTL_XFERMODE_M, UDMA_MODE_PERIPH_SG);
+    CHECK_EQUAL(udma_remaining(p_primary), 5 * 4);
+
+    /* Anything written meanwhile waits for the DMA to finish */
+    CHECK_EQUAL(uart_dma_write(UART_ID_0, segments, NUMELTS(segments)), UART_ERROR_BUSY);
+    CHECK_EQUAL(uart_write(UART_ID_0, "after", 5), UART_OK);
+
+    model_run();
+
+    CHECK(!uart_dma_write_busy(UART_ID_0));
+    CHECK(!udma_channel_enabled(TX_CHANNEL));
+    CHECK(udma_channel_enabled(RX_CHANNEL));
+    CHECK(!udma_channel_done(TX_CHANNEL));
+
+    p_sent = model_uart_sent(&sent_len);
+    CHECK_EQUAL(sent_len, sizeof(g_header) + sizeof(g_body) + sizeof(g_trailer) + 5);
+    if (sent_len == sizeof(g_header) + sizeof(g_body) + sizeof(g_trailer) + 5)
+    {
+        CHECK(memcmp(p_sent, g_header, sizeof(g_header)) == 0);
+        p_sent += sizeof(g_header);
+        CHECK(memcmp(p_sent, g_body, sizeof(g_body)) == 0);
+        p_sent += sizeof(g_body);
+        CHECK_EQUAL(p_sent[0], 't');
+        CHECK(memcmp(p_sent + 1, "after", 5) == 0);
+    }
+
+    /* And it can go again */
+    model_clear_sent();
+    CHECK_EQUAL(uart_dma_write(UART_ID_0, segments, 1), UART_OK);
+    model_run();
+    p_sent = model_uart_sent(&sent_len);
+    CHECK_EQUAL(sent_len, sizeof(g_header));
+}
+
+/*
+ * Put len more bytes on the RX line, a few at a time, running the model
+ * in between. Bytes which overrun the FIFO are lost, as they would be.
+ */
+static void receive(size_t len)
+{
+    while (len)
+    {
+        uint8_t piece[RX_PIECE_LEN];
+        const size_t piece_len = MIN(len, sizeof(piece));
+        size_t accepted;
+        for (size_t i = 0; i < piece_len; i++)
+        {
+            piece[i] = (uint8_t) ('0' + ((g_sent_on_line_len + i) % 64));
+        }
+        accepted = model_uart_receive(piece, piece_len);
+        if (g_sent_on_line_len + accepted <= sizeof(g_sent_on_line))
+        {
+            memcpy(&g_sent_on_line[g_sent_on_line_len], piece, accepted);
+            g_sent_on_line_len += accepted;
+        }
+        len -= piece_len;
+        model_run();
+    }
+}
+
+/*
+ * Everything that made it in to the FIFO has been delivered, once, in
+ * order.
+ */
+static void check_received(void)
+{
+    CHECK_EQUAL(g_received_len, g_sent_on_line_len);
+    CHECK(memcmp(g_received, g_sent_on_line, MIN(g_received_len, g_sent_on_line_len)) == 0);
+}
+
+/*
+ * @return 0 for ping, 1 for pong, -1 for neither (i.e. from the FIFO)
+ */
+static int half_of(const char *p_data)
+{
+    const uint8_t *const p = (const uint8_t *) p_data;
+    if ((p >= g_ping) && (p < &g_ping[RX_HALF_LEN]))
+    {
+        return 0;
+    }
+    if ((p >= g_pong) && (p < &g_pong[RX_HALF_LEN]))
+    {
+        return 1;
+    }
+    return -1;
+}
+
+static void clear_deliveries(void)
+{
+    g_num_deliveries = 0;
+}
+
+static void on_receive(uart_id_t uart_id, const char *p_data, size_t len)
+{
+    if (g_num_deliveries < NUMELTS(g_deliveries))
+    {
+        g_deliveries[g_num_deliveries].p_data = p_data;
+        g_deliveries[g_num_deliveries].len = len;
+        g_num_deliveries++;
+    }
+    if (g_received_len + len <= sizeof(g_received))
+    {
+        memcpy(&g_received[g_received_len], p_data, len);
+        g_received_len += len;
+    }
+}
+
+/**************************************************
+* End of file
+***************************************************/